@@ -4,10 +4,20 @@
 #include "MiniSynthApp.h"
 
 #include "MiniSynthMidi.h"
+#include "MiniSynthMidiIn.h"
+#include "MiniSynthDsp.h"
 #include "MiniSynthOscillator.h"
 #include "MiniSynthVoice.h"
+#include "MiniSynthFilter.h"
+#include "MiniSynthNoteTable.h"
+#include "MiniSynthParam.h"
+#include "MiniSynthPots.h"
+#include "MiniSynthKeys.h"
+#include "MiniSynthPatch.h"
 #include "MiniSynthCpuLoad.h"
+#include "MiniSynthProfiler.h"
 #include "MiniSynthScope.h"
+#include "MiniSynthSpectrum.h"
 #include "MiniSynthDisplay.h"
 
 namespace mini_synth {
@@ -17,181 +27,760 @@ namespace {
  */
 SynthState g_state;
 
+// ---- オーディオ側だけが書き込む状態（コントロール側からは kParam イベントで変更する） ----
+// 現在レンダリング中の波形
+OscWaveform g_waveform = OscWaveform::kSine;
 // グローバル SVF 状態（GLOBAL_SVF が有効な場合に使用）
-float g_filter_low = 0.0f;
-float g_filter_band = 0.0f;
-float g_global_f = 0.0f; // 正規化周波数
-float g_global_q = 0.0f; // レゾナンス（0..1）
-// audio-rate smoothing state
-float g_global_f_smooth = 0.0f;
-float g_global_q_smooth = 0.0f;
-
-/**
- * @brief エンベロープとポルタメントを更新するユーティリティ。
- * @param attackStep アタック時の増分。
- * @param releaseStep リリース時の減分。
- */
-void updateActiveVoices(const int16_t attackStep, const int16_t releaseStep) {
-  for (auto &voice : g_state.voices) {
-    if (!voice.active) {
-      continue;
-    }
+SvfValue g_filter_low = 0;
+SvfValue g_filter_band = 0;
+// kParam で変更されるパラメータ（Q15）。ブロックごとの直線ランプで目標値へ追従する。
+ParamRamp g_cutoff;    // SVF の正規化周波数係数 f
+ParamRamp g_resonance; // SVF のレゾナンス（0..1）
+// ユニゾンのデチューン幅（Q15、0 でユニゾン解除）
+uint16_t g_unisonSpread = 0U;
+// マスターボリューム（0x8000 = 0dB）。音量変化は指数ランプで追従する。
+ParamRamp g_volume = {kQ15One << kParamRampShift, kQ15One << kParamRampShift, 0U, kControlPeriod, RampShape::kExponential};
+
+// ---- コントロール側だけが書き込む状態 ----
+// 最後に送信したパラメータ値（変化したときだけイベントを投入する）
+int32_t g_sentCutoff = -1;
+int32_t g_sentResonance = -1;
+// 最後に呼び出したパッチ（保持中のポットはこの値を使う）
+SynthPatch g_patch;
+// 別スロットの保存が予備バンクの消去待ちのため書き込めなかった保存（CC119 受信時の音色。消去の後に書き込む）
+SynthPatch g_deferredStore;
+uint8_t g_deferredStoreProgram = 0U;
+bool g_storeDeferred = false;
+// 発音・MIDI・鍵盤操作のない連続ティック数（kPatchEraseIdleTicks で飽和）。
+uint16_t g_idleTicks = 0U;
+// 呼び出した値を保持中のポット（PotId のビット）と、呼び出し時のポット位置
+uint8_t g_potHeldMask = 0U;
+uint16_t g_potAnchor[kPotCount] = {0U};
+// 呼び出し後にまだ送れていないパラメータ（SynthParam のビット。キュー満杯なら次のティックで再送）
+uint8_t g_recallPending = 0U;
+// キュー満杯で kVoiceUpdate を送れなかったボイス（次のティックで値が変わらなくても送り直す）
+VoiceMask g_voiceUpdatePending = 0U;
+
+// ブロックレンダリング用の作業バッファ
+int32_t g_mixBuffer[kAudioBlockSize];
+// generateAudio() が 1 サンプルずつ払い出すブロック
+int16_t g_outputBlock[kAudioBlockSize];
+size_t g_outputIndex = kAudioBlockSize;
+
+// 起動時のレンダリング余裕度の自己診断結果
+RenderHeadroom g_headroom;
+
+/**
+ * @brief エンベロープとポルタメントを更新し、変化をオーディオ側へ送るユーティリティ。
+ */
+void updateActiveVoices() {
+  VoiceBank &bank = g_state.voices;
+  // 割り当て中のボイスのみを走査する（更新中にマスクが変わってもコピーを使う）。
+  for (VoiceMask mask = bank.allocatedMask; mask != 0U; mask &= mask - 1U) {
+    const uint8_t index = lowestVoiceIndex(mask);
+    const VoiceControl &control = bank.control[index];
+    const int16_t envelope = control.envelope;
+    const uint32_t increment = control.increment;
     // エンベロープ更新とポルタメント適用をそれぞれ実行。
-    updateEnvelope(voice, attackStep, releaseStep);
-    updatePortamento(voice);
+    updateEnvelope(bank, index, g_state.envelope);
+    updatePortamento(bank, index);
+
+    VoiceEvent event;
+    event.voice = index;
+    if ((bank.allocatedMask & voiceBit(index)) == 0U) {
+      // リリースが完了したボイスを停止する（キュー満杯なら postEvent() が保留して次のティックで送る）。
+      event.type = VoiceEventType::kNoteOff;
+      postEvent(g_state, event);
+      g_voiceUpdatePending &= ~voiceBit(index);
+    } else if (control.envelope != envelope || control.increment != increment ||
+               (g_voiceUpdatePending & voiceBit(index)) != 0U) {
+      event.type = VoiceEventType::kVoiceUpdate;
+      event.envelope = control.envelope;
+      event.value = control.increment;
+      if (postEvent(g_state, event)) {
+        g_voiceUpdatePending &= ~voiceBit(index);
+      } else {
+        g_voiceUpdatePending |= voiceBit(index);
+      }
+    }
   }
 }
-}  // namespace
 
-AudioOutput generateAudio() {
-  int32_t mix = 0;
-  for (auto &voice : g_state.voices) {
-    if (!voice.active) {
-      continue;
+/**
+ * @brief 発音中の最低音が約 kScopePeriods 周期収まるスコープの間引き数を求める（無音時は既定値）。
+ */
+uint16_t scopeTimebaseForVoices() {
+  constexpr uint32_t kScopePeriods = 4U;
+  constexpr uint32_t kMaxDecimation = 64U;
+  const VoiceBank &bank = g_state.voices;
+  uint32_t lowest = 0U;
+  for (VoiceMask mask = bank.allocatedMask; mask != 0U; mask &= mask - 1U) {
+    const uint32_t increment = bank.control[lowestVoiceIndex(mask)].increment;
+    if (lowest == 0U || (increment != 0U && increment < lowest)) {
+      lowest = increment;
+    }
+  }
+  if (lowest == 0U) {
+    return SCOPE_DECIMATION;
+  }
+  // 1 周期 = 2^32 / increment サンプル。
+  const uint32_t window = static_cast<uint32_t>((static_cast<uint64_t>(kScopePeriods) << 32U) / lowest);
+  const uint32_t decimation = (window + SCOPE_FRAME_POINTS - 1U) / SCOPE_FRAME_POINTS;
+  return static_cast<uint16_t>((decimation > kMaxDecimation) ? kMaxDecimation : ((decimation == 0U) ? 1U : decimation));
+}
+
+/**
+ * @brief MIDI 受信時刻のクロック（受信割り込みから呼ばれる）。
+ */
+uint32_t midiReceiveClock() {
+  return audioSampleClock(g_state);
+}
+
+/**
+ * @brief 受信リングの MIDI バイトを解析し、受信時刻に合わせてイベントを投入する。
+ *
+ * 各メッセージは最後のバイトの受信時刻 + kEventLatency に適用します。前回のティック以降に受信したバイトは
+ * 遅くとも 1 コントロール周期前の時刻を持つため、この時刻はまだレンダリングされておらず、
+ * ティックへの量子化（最大 1 周期の揺れ）なしに一定のレイテンシで発音できます。
+ * キューの先頭から順に適用されるよう、時刻は直前に投入した時刻以上、tickTime 以下に収めます。
+ * @param tickTime このティックで投入するイベントの時刻。
+ * @return チャンネルメッセージ（ノート・CC・プログラムチェンジ等）を受信した場合 true（クロック等のリアルタイムメッセージは除く）。
+ */
+bool handleMidiInput(const uint32_t tickTime) {
+  MidiRxByte rx;
+  MidiEvent event;
+  bool activity = false;
+  do {
+    while (midiInRead(rx)) {
+      if (!parseMidiByte(g_state.midi, rx.data, event)) {
+        continue;
+      }
+      const uint32_t time = rx.time + kEventLatency;
+      if (static_cast<int32_t>(time - tickTime) > 0) {
+        g_state.eventTime = tickTime;
+      } else if (static_cast<int32_t>(time - g_state.eventTime) > 0) {
+        g_state.eventTime = time;
+      }
+      event.time = rx.time;
+      handleMidiEvent(g_state, event);
+      activity = activity || (static_cast<uint8_t>(event.type) < 0xF0U);
+    }
+    // ポーリング版では FIFO の残り（リング満杯で移せなかった分）を続けて取り込む。
+  } while (midiInPoll() != 0U);
+  return activity;
+}
+
+/**
+ * @brief 値が変化した場合だけパラメータ変更イベントを投入する。
+ * @param param 対象パラメータ。
+ * @param value 新しい値。
+ * @param sent 最後に送信した値（更新される）。
+ */
+void postParamIfChanged(const SynthParam param, const int32_t value, int32_t &sent) {
+  if (value == sent) {
+    return;
+  }
+  VoiceEvent event;
+  event.type = VoiceEventType::kParam;
+  event.voice = static_cast<uint8_t>(param);
+  event.value = static_cast<uint32_t>(value);
+  if (postEvent(g_state, event)) {
+    sent = value;
+  }
+}
+
+/**
+ * @brief 保持を解除するのに必要なポットの移動量（10bit スケール）。ヒステリシスより十分大きくする。
+ */
+constexpr int32_t kPotPickupDistance = 24;
+
+/**
+ * @brief ポットが呼び出したパッチの値を保持中かどうか（呼び出し時の位置から動かされたら保持を解除する）。
+ * @param pot 対象ポット。
+ * @return 保持中なら true（ポットの代わりに g_patch の値を使う）。
+ */
+bool potHeld(const PotId pot) {
+  const uint8_t index = static_cast<uint8_t>(pot);
+  const uint8_t bit = static_cast<uint8_t>(1U << index);
+  if ((g_potHeldMask & bit) == 0U) {
+    return false;
+  }
+  const int32_t moved = static_cast<int32_t>(readPot(pot)) - static_cast<int32_t>(g_potAnchor[index]);
+  if (moved > kPotPickupDistance || moved < -kPotPickupDistance) {
+    g_potHeldMask &= static_cast<uint8_t>(~bit);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief ポットの実効値を返す（保持中はパッチの値、波形選択は常に実際の位置）。
+ * @param pot 対象ポット。
+ * @return 0..kAdcMax の値。
+ */
+uint16_t effectivePot(const PotId pot) {
+  if (!potHeld(pot)) {
+    return readPot(pot);
+  }
+  switch (pot) {
+    case PotId::kAttack:
+      return g_patch.attackPot;
+    case PotId::kRelease:
+      return g_patch.releasePot;
+    case PotId::kFilter:
+      return g_patch.cutoffPot;
+    case PotId::kResonance:
+      return g_patch.resonancePot;
+    default:
+      return readPot(pot);
+  }
+}
+
+/**
+ * @brief Program Change で選ばれたパッチを呼び出す。
+ *
+ * フラッシュからは RAM の索引で数語を読むだけで、復元と検証は作業用のパッチで行い、
+ * 成功した場合だけ現在の音色へ切り替えます（未保存や壊れたパッチでは音色を変えない）。
+ * コントロール側の値はこのティックで置き換え、オーディオ側へはいつもどおり kParam イベントで送るため、
+ * カットオフ・レゾナンス・音量はランプで移り、オーディオ割り込みを止めることはありません。
+ * @param program プログラム番号。
+ */
+void recallPatch(const uint8_t program) {
+  SynthPatch patch;
+  if (!loadPatch(program, patch)) {
+    return;
+  }
+  g_patch = patch;
+  g_state.envelope.decayRate = patch.decayRate;
+  g_state.envelope.sustainLevel = patch.sustainLevel;
+  g_state.volume = patch.volume;
+  g_state.unisonSpread = patch.unisonSpread;
+  g_recallPending = static_cast<uint8_t>((1U << static_cast<uint8_t>(SynthParam::kVolume)) | (1U << static_cast<uint8_t>(SynthParam::kUnisonSpread)));
+  // 波形・エンベロープ・フィルタのポットは、動かされるまでパッチの値を使う。
+  g_potHeldMask = static_cast<uint8_t>((1U << kPotCount) - 1U);
+  for (uint8_t pot = 0; pot < kPotCount; ++pot) {
+    g_potAnchor[pot] = readPot(static_cast<PotId>(pot));
+  }
+}
+
+/**
+ * @brief 呼び出したパッチのうち MIDI CC 由来のパラメータを送る（送れなかったものは次のティックで再送）。
+ */
+void postRecalledParams() {
+  for (uint8_t pending = g_recallPending; pending != 0U; pending &= static_cast<uint8_t>(pending - 1U)) {
+    const SynthParam param = static_cast<SynthParam>(__builtin_ctz(pending));
+    VoiceEvent event;
+    event.type = VoiceEventType::kParam;
+    event.voice = static_cast<uint8_t>(param);
+    event.value = (param == SynthParam::kVolume) ? g_state.volume : g_state.unisonSpread;
+    if (postEvent(g_state, event)) {
+      g_recallPending &= static_cast<uint8_t>(~(1U << static_cast<uint8_t>(param)));
     }
-    // 選択された波形を生成。
-    const int16_t osc = renderWave(voice, g_state.waveform);
-    // エンベロープ値を適用して振幅を調整。
-    const int32_t sample = (static_cast<int32_t>(osc) * voice.envelope) >> 15;
-#if VOICE_SVF
-    // per-voice SVF が有効な場合はボイスごとにフィルタ処理を行う。
-    float s = static_cast<float>(sample);
-  // キー追従のため、プリコンピュートしたテーブルを参照
-  const uint8_t noteIdx = (voice.note <= 127) ? voice.note : 127;
-  const float f = kNoteFTable[noteIdx];
-    const float q = g_global_q; // レゾナンスはグローバルノブで共有
-    s = processVoiceSVF(voice, s, f, q);
-    mix += static_cast<int32_t>(s);
+  }
+}
+
+/**
+ * @brief 現在の音色（ポットの実効値と MIDI CC の最終値）を最後に受信したプログラム番号へ保存する。
+ */
+void storePatch() {
+  SynthPatch patch;
+  patch.waveform = g_state.waveform;
+  patch.attackPot = effectivePot(PotId::kAttack);
+  patch.releasePot = effectivePot(PotId::kRelease);
+  patch.cutoffPot = effectivePot(PotId::kFilter);
+  patch.resonancePot = effectivePot(PotId::kResonance);
+  patch.decayRate = static_cast<uint16_t>(g_state.envelope.decayRate);
+  patch.sustainLevel = g_state.envelope.sustainLevel;
+  patch.volume = g_state.volume;
+  patch.unisonSpread = g_state.unisonSpread;
+  if (savePatch(g_state.program, patch)) {
+    g_patch = patch;
+    return;
+  }
+  // 別スロットの保存が消去待ちで断られた場合は、この時点の音色を保持して patchStoreService() の後に書き込む
+  // （保持できるのは 1 件。同じプログラムへの保存は新しい音色で置き換える）。
+  if (patchStoreWritePending() && (!g_storeDeferred || g_deferredStoreProgram == g_state.program)) {
+    g_deferredStore = patch;
+    g_deferredStoreProgram = g_state.program;
+    g_storeDeferred = true;
+    g_patch = patch;
+  } else {
+    ++g_state.droppedStores;
+  }
+}
+
+/**
+ * @brief 予備バンクの消去を始めるまでに必要な無操作ティック数（PATCH_ERASE_IDLE_MS を切り上げ）。
+ */
+constexpr uint16_t kPatchEraseIdleTicks = static_cast<uint16_t>((static_cast<uint32_t>(PATCH_ERASE_IDLE_MS) * kControlRate + 999U) / 1000U);
+
+/**
+ * @brief 予備バンクの消去（と消去待ちだった保存の書き込み）を行い、保持していた保存を書き込む。
+ */
+void servicePatchStore() {
+  if (!patchStoreService() || !g_storeDeferred) {
+    return;
+  }
+  // 消去待ちの保存は書き終えているので、次の保存は受け付けられる（書き込み失敗のときだけ破棄）。
+  g_storeDeferred = false;
+  if (!savePatch(g_deferredStoreProgram, g_deferredStore)) {
+    ++g_state.droppedStores;
+  }
+}
+
+/**
+ * @brief パラメータ変更イベントをオーディオ側の状態に適用する。
+ * @param event kParam イベント。
+ */
+void applyParamEvent(const VoiceEvent &event) {
+  switch (static_cast<SynthParam>(event.voice)) {
+    case SynthParam::kWaveform:
+      g_waveform = static_cast<OscWaveform>(event.value);
+      break;
+    case SynthParam::kCutoff:
+      g_cutoff.setTarget(static_cast<int32_t>(event.value));
+      break;
+    case SynthParam::kResonance:
+      g_resonance.setTarget(static_cast<int32_t>(event.value));
+      break;
+    case SynthParam::kVolume:
+      g_volume.setTarget(static_cast<int32_t>(event.value));
+      break;
+    case SynthParam::kUnisonSpread:
+      g_unisonSpread = static_cast<uint16_t>(event.value);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief 時刻 now までに到来したイベントをキューからすべて取り出して適用する。
+ * @param now 現在のサンプル時刻。
+ */
+void applyDueEvents(const uint32_t now) {
+  while (const VoiceEvent *event = g_state.events.peek()) {
+    // 時刻はラップアラウンドするため差分の符号で比較する（遅れて届いたものは即時適用）。
+    if (static_cast<int32_t>(event->time - now) > 0) {
+      break;
+    }
+    if (event->type == VoiceEventType::kParam) {
+      applyParamEvent(*event);
+    } else {
+      applyVoiceEvent(g_state.voices, *event);
+    }
+    g_state.events.pop();
+  }
+}
+
+/**
+ * @brief 次のイベントまでのフレーム数を求める。
+ * @param now 現在のサンプル時刻。
+ * @param limit 上限フレーム数。
+ * @return limit 以下のフレーム数（applyDueEvents() の直後なら 1 以上）。
+ */
+size_t framesUntilNextEvent(const uint32_t now, const size_t limit) {
+  const VoiceEvent *event = g_state.events.peek();
+  if (event == nullptr) {
+    return limit;
+  }
+  const int32_t delta = static_cast<int32_t>(event->time - now);
+  return (delta > 0 && static_cast<size_t>(delta) < limit) ? static_cast<size_t>(delta) : limit;
+}
+
+/**
+ * @brief kAudioBlockSize 以下のフレーム数を 1 ブロックとしてレンダリングする。
+ * @param out 出力先バッファ。
+ * @param frames 生成するフレーム数（kAudioBlockSize 以下）。
+ */
+void renderChunk(int16_t *out, const size_t frames) {
+  VoiceBank &bank = g_state.voices;
+  // 波形とアクティブボイス集合はブロック先頭で確定させる（イベントはブロック境界でのみ適用される）。
+  const OscWaveform waveform = g_waveform;
+  const VoiceMask activeMask = bank.activeMask;
+
+  uint32_t zone = profileBegin();
+  for (size_t i = 0; i < frames; ++i) {
+    g_mixBuffer[i] = 0;
+  }
+  profileEnd(ProfileZone::kMixClip, zone);
+  // 波形に特殊化されたカーネルをブロックごとに 1 回だけ選択する。
+  const VoiceKernel kernel = selectVoiceKernel(waveform, g_unisonSpread != 0U);
+  VoiceKernelParams params;
+  params.unisonSpread = g_unisonSpread;
+  // レゾナンスはグローバルノブで共有（ボイス毎 SVF ではブロック先頭の値で一定）。
+  // ランプはフィルタ構成によらずブロックごとに 1 回だけ進める。
+  const int32_t qStart = g_resonance.value;
+  const int32_t qRampStep = g_resonance.beginBlock(frames);
+#if SVF_FIXED_POINT
+  params.resonance = qStart >> kParamRampShift;
 #else
-    mix += sample;
+  params.resonance = static_cast<float>(qStart) * kParamRampToFloat;
 #endif
-    // 次回サンプル用に位相を進める。
-    voice.phase += voice.increment;
-  }
-  // 出力レンジに収める。
-  mix = constrain(mix, -32768, 32767);
-  // グローバル SVF が有効な場合はミックス後に SVF を適用する
-#if GLOBAL_SVF
-  // 入力を float に正規化
-  float in = static_cast<float>(mix);
-  // audio-rate smoothing (simple 1-pole)
-  const float alpha = 0.2f; // smoothing factor (tuneable)
-  g_global_f_smooth += alpha * (g_global_f - g_global_f_smooth);
-  g_global_q_smooth += alpha * (g_global_q - g_global_q_smooth);
-  const float f = g_global_f_smooth;
-  const float q = g_global_q_smooth;
-  // 高域 (hp) を計算
-  float hp = in - g_filter_low - q * g_filter_band;
-  g_filter_band += f * hp;
-  g_filter_low += f * g_filter_band;
-  float out = g_filter_low; // ローパス出力
-  // クリップして戻す
-  // soft clip (tanh-like) to avoid harsh clipping and tame oscillation
-  const float clipA = 1.0f / 32768.0f;
-  float x = out * clipA;
-  // simple soft clip: x / (1 + |x|)
-  float y = x / (1.0f + fabsf(x));
-  out = y / clipA;
-  out = constrain(out, -32768.0f, 32767.0f);
-  return {static_cast<int16_t>(out)};
+#if VOICE_PAIR_MIX
+  const VoicePairKernel pairKernel = selectVoicePairKernel(waveform, g_unisonSpread != 0U);
 #else
-  return {static_cast<int16_t>(mix)};
+  const VoicePairKernel pairKernel = nullptr;
 #endif
+  zone = profileBegin();
+  VoiceMask mask = activeMask;
+  if (pairKernel != nullptr) {
+    // 2 ボイスずつまとめて処理する（端数の 1 ボイスは下のループで処理）。
+    while ((mask & (mask - 1U)) != 0U) {
+      const uint8_t a = lowestVoiceIndex(mask);
+      mask &= mask - 1U;
+      const uint8_t b = lowestVoiceIndex(mask);
+      mask &= mask - 1U;
+      pairKernel(bank, a, b, params, g_mixBuffer, frames);
+    }
+  }
+  for (; mask != 0U; mask &= mask - 1U) {
+    kernel(bank, lowestVoiceIndex(mask), params, g_mixBuffer, frames);
+  }
+  profileEnd(ProfileZone::kOscillator, zone);
+
+  zone = profileBegin();
+
+#if GLOBAL_SVF && SVF_FIXED_POINT
+  // ミックス後にグローバル SVF を固定小数点で適用する。
+  // 係数は ParamRamp がブロックごとに求めた増分で直線補間する。
+  int32_t f = g_cutoff.value;
+  int32_t q = qStart;
+  const int32_t fStep = g_cutoff.beginBlock(frames);
+  const int32_t qStep = qRampStep;
+  int32_t low = g_filter_low;
+  int32_t band = g_filter_band;
+  for (size_t i = 0; i < frames; ++i) {
+    f += fStep;
+    q += qStep;
+    // 出力レンジに収めてからフィルタへ入力
+    const int32_t in = saturate16(g_mixBuffer[i]);
+    out[i] = softClipQ15(processSvfQ15(low, band, in, f >> kParamRampShift, q >> kParamRampShift));
+  }
+  g_filter_low = low;
+  g_filter_band = band;
+  profileEnd(ProfileZone::kFilter, zone);
+#elif GLOBAL_SVF
+  // ミックス後にグローバル SVF を適用する。
+  // 係数はブロック先頭の値と増分だけを浮動小数点に変換して直線補間する。
+  float f = static_cast<float>(g_cutoff.value) * kParamRampToFloat;
+  float q = static_cast<float>(qStart) * kParamRampToFloat;
+  const float fStep = static_cast<float>(g_cutoff.beginBlock(frames)) * kParamRampToFloat;
+  const float qStep = static_cast<float>(qRampStep) * kParamRampToFloat;
+  float low = g_filter_low;
+  float band = g_filter_band;
+  for (size_t i = 0; i < frames; ++i) {
+    f += fStep;
+    q += qStep;
+    // 出力レンジに収めてから float に正規化
+    const float in = static_cast<float>(saturate16(g_mixBuffer[i]));
+    processSvfFloat(low, band, in, f, q);
+    // soft clip (tanh-like) to avoid harsh clipping and tame oscillation
+    out[i] = softClipFloat(low);
+  }
+  g_filter_low = low;
+  g_filter_band = band;
+  profileEnd(ProfileZone::kFilter, zone);
+#else
+  // ボイス毎 SVF のみの構成ではブロック内の増分は使わない（ブロック先頭の値で一定）。
+  (void)qRampStep;
+  for (size_t i = 0; i < frames; ++i) {
+    // 出力レンジに収める。
+    out[i] = saturate16(g_mixBuffer[i]);
+  }
+  profileEnd(ProfileZone::kMixClip, zone);
+#endif
+
+  // マスターボリューム（0dB で一定のときは素通し）。
+  if (!g_volume.settled() || g_volume.q15() != kQ15One) {
+    int32_t volume = g_volume.value;
+    const int32_t volumeStep = g_volume.beginBlock(frames);
+    for (size_t i = 0; i < frames; ++i) {
+      volume += volumeStep;
+      out[i] = static_cast<int16_t>((static_cast<int32_t>(out[i]) * (volume >> kParamRampShift)) >> 15);
+    }
+  }
+}
+}  // namespace
+
+void renderBlock(int16_t *out, size_t frames) {
+  const uint32_t start = profileBegin();
+  const uint32_t total = static_cast<uint32_t>(frames);
+  uint32_t now = g_state.sampleClock;
+  // 作業バッファに収まる単位、かつ次のイベント時刻で分割してレンダリングする。
+  // これによりイベントはタイムスタンプ通りのサンプル位置で反映される。
+  while (frames > 0U) {
+    applyDueEvents(now);
+    const size_t limit = (frames < kAudioBlockSize) ? frames : kAudioBlockSize;
+    const size_t chunk = framesUntilNextEvent(now, limit);
+    renderChunk(out, chunk);
+    out += chunk;
+    frames -= chunk;
+    now += static_cast<uint32_t>(chunk);
+    __atomic_store_n(&g_state.sampleClock, now, __ATOMIC_RELEASE);
+  }
+  // ブロック全体の所要時間を記録し、frames サンプル分の締め切りと比較する。
+  profileEndBlock(start, total);
+}
+
+AudioOutput generateAudio() {
+  // ブロックを使い切ったら次のブロックをまとめて生成する。
+  if (g_outputIndex >= kAudioBlockSize) {
+    renderBlock(g_outputBlock, kAudioBlockSize);
+    g_outputIndex = 0U;
+  }
+  return {g_outputBlock[g_outputIndex++]};
 }
 
 void handleControl() {
-  // 波形選択ポットの値を読み取り、波形を更新。
-  g_state.waveform = analogToWaveform(analogRead(kOscSelectPin));
-  // エンベロープパラメータを計算。
-  const int16_t attackStep = static_cast<int16_t>(map(analogRead(kAttackPin), 0, kAdcMax, 256, 4096));
-  const int16_t releaseStep = static_cast<int16_t>(map(analogRead(kReleasePin), 0, kAdcMax, 128, 2048));
+  const uint32_t tickStart = profileBegin();
+  // このティックで投入するイベントは、現在のサンプル時刻から一定レイテンシ後に適用する。
+  const uint32_t tickTime = audioSampleClock(g_state) + kEventLatency;
+  // 前のティックでキュー満杯のため保留したノートオン・ノートオフ・横取りを先に送る。
+  flushDeferredEvents(g_state);
+  // MIDI を最初に処理し、受信時刻に基づく（このティックより前の）時刻でイベントを投入する。
+  const bool midiActivity = handleMidiInput(tickTime);
+  g_state.eventTime = tickTime;
+  // ポットの変換結果を取り込む（変換待ちなし、平均 + ヒステリシス済み）。
+  potsUpdate();
+  // パッチの呼び出し（Program Change）はポットの処理より前に行い、同じティックで新しい値を送る。
+  if (g_state.recallRequested) {
+    g_state.recallRequested = false;
+    recallPatch(g_state.program);
+  }
+  postRecalledParams();
+  // 波形選択ポットの値を読み取り、変化していれば波形を更新。
+  const OscWaveform waveform = potHeld(PotId::kOscSelect) ? g_patch.waveform : analogToWaveform(readPot(PotId::kOscSelect));
+  if (waveform != g_state.waveform) {
+    VoiceEvent event;
+    event.type = VoiceEventType::kParam;
+    event.voice = static_cast<uint8_t>(SynthParam::kWaveform);
+    event.value = static_cast<uint32_t>(waveform);
+    if (postEvent(g_state, event)) {
+      g_state.waveform = waveform;
+    }
+  }
+  // エンベロープのアタック/リリース速度をポットから読む（ディケイ/サステインは MIDI CC で設定）。
+  // 1 周期あたりのセグメント進み幅: アタック 8..128 周期、リリース 16..256 周期（右に回すほど速い）。
+  g_state.envelope.attackRate = static_cast<uint32_t>(map(effectivePot(PotId::kAttack), 0, kAdcMax, 512, 8192));
+  g_state.envelope.releaseRate = static_cast<uint32_t>(map(effectivePot(PotId::kRelease), 0, kAdcMax, 256, 4096));
   // フィルタ関連を読み取る
-  const uint16_t rawCut = analogRead(kFilterPin);
-  const uint16_t rawRes = analogRead(kResonancePin);
-  // カットオフは指数マップで自然な応答にする（80Hz..6000Hz を例）
-  const float fc = 80.0f * powf(6000.0f / 80.0f, static_cast<float>(rawCut) / static_cast<float>(kAdcMax));
-  // 正規化 f を簡易計算（f = 2 * sin(pi * fc / fs) 相当のスケール）
-  g_global_f = 2.0f * sinf(M_PI * fc / static_cast<float>(kAudioRate));
-  // レゾナンスは 0..0.95 程度でクリップ
-  g_global_q = constrain(static_cast<float>(rawRes) / static_cast<float>(kAdcMax), 0.0f, 0.95f);
-  updateActiveVoices(attackStep, releaseStep);
-  // MIDI データを読み出し、必要なイベントを処理。
-  while (midiSerial().available() > 0) {
-    const uint8_t data = static_cast<uint8_t>(midiSerial().read());
-    handleMidiByte(g_state, data);
-  }
-
-  // 簡易鍵盤スキャン（ポーリング）。押している間ノートを保持し、離すとノートオフ。
-  // 現在は 5 鍵の直接 GPIO 実装。
-  const uint8_t keyPins[5] = {kKeyPin0, kKeyPin1, kKeyPin2, kKeyPin3, kKeyPin4};
-  for (uint8_t i = 0; i < 5; ++i) {
-    const bool pressed = (digitalRead(keyPins[i]) == LOW); // pullup 想定
-    // 探して既に鳴いているボイスをチェック
-    Voice *v = findVoiceByNote(g_state, kKeyNotes[i]);
-    if (pressed) {
-      if (v == nullptr) {
-        // ノートオン
-        noteOn(g_state, 0, kKeyNotes[i], 127);
-      }
+  // アフタータッチはカットオフを開く方向へ加算する（最大でポット半分相当）。
+  const uint32_t pressedCut = effectivePot(PotId::kFilter) + (static_cast<uint32_t>(g_state.pressure) << 2U);
+  const uint16_t rawCut = static_cast<uint16_t>((pressedCut > kAdcMax) ? kAdcMax : pressedCut);
+  const uint16_t rawRes = effectivePot(PotId::kResonance);
+  // カットオフは指数マップで自然な応答にする（80Hz..6000Hz、f = 2 * sin(pi * fc / fs) をテーブル化）
+  postParamIfChanged(SynthParam::kCutoff, cutoffCurveQ15(rawCut), g_sentCutoff);
+  // レゾナンスは 0..0.95 程度でクリップ（Q15 で送り、浮動小数点版は受信側で変換）
+  const int32_t resonanceQ15 = constrain(static_cast<int32_t>((static_cast<uint32_t>(rawRes) * kQ15One) / kAdcMax), 0, (kQ15One * 95) / 100);
+  postParamIfChanged(SynthParam::kResonance, resonanceQ15, g_sentResonance);
+  // 保存（CC119）はフラッシュへ 1 レコード（数語）を書き込む。
+  if (g_state.storeRequested) {
+    g_state.storeRequested = false;
+    storePatch();
+  }
+  // 予備バンクの消去は CPU と割り込みを止め、その間の MIDI 受信と鍵盤の押下は遅れるか失われる。
+  // そのため発音がなく、MIDI のチャンネルメッセージも鍵盤操作もない状態が PATCH_ERASE_IDLE_MS 続いたときだけ行う
+  // （消去待ちの保存もここで書き込まれる）。
+  if (midiActivity || g_state.voices.allocatedMask != 0U) {
+    g_idleTicks = 0U;
+  } else if (g_idleTicks < kPatchEraseIdleTicks) {
+    ++g_idleTicks;
+  }
+  if (g_idleTicks >= kPatchEraseIdleTicks) {
+    servicePatchStore();
+  }
+  const uint32_t envelopeStart = profileBegin();
+  updateActiveVoices();
+  profileEnd(ProfileZone::kEnvelope, envelopeStart);
+  // 鍵盤: スキャン結果（デバウンス済み）の押下/離鍵イベントだけを処理する。
+  keysUpdate();
+  KeyEvent keyEvent;
+  while (keysPollEvent(keyEvent)) {
+    g_idleTicks = 0U;
+    const uint8_t note = keyNote(keyEvent.key);
+    if (keyEvent.pressed) {
+      noteOn(g_state, 0, note, 127);
     } else {
-      if (v != nullptr) {
-        // ノートオフ
-        noteOff(g_state, 0, kKeyNotes[i]);
-      }
+      noteOff(g_state, 0, note);
     }
   }
 
   // control-rate で CPU 使用率をサンプリングしてリセット
   // Mozzi の control rate は kControlRate (定義は MiniSynthMozziConfig.h)
-  float cpuPct = cpuLoadSampleAndReset(kAudioRate);
 #if defined(CPU_LOAD_DEBUG)
+  const float cpuPct = cpuLoadSampleAndReset(kAudioRate);
   // ユーザーがデバッグを有効にした場合はシリアルに出す（Serial.begin は initializeSynth で必要）
   Serial.print("CPU %: ");
   Serial.println(cpuPct, 1);
+#else
+  cpuLoadSampleAndReset(kAudioRate);
+#endif
+
+#if ENABLE_SPECTRUM
+  // スペクトラム解析はコントロールレートより遅い周期で実行する。
+  const size_t snapN = SPECTRUM_FFT_SIZE;
+  static_assert(SPECTRUM_FFT_SIZE <= SCOPE_BUFFER_SIZE / 2, "scope buffer too small for spectrum analysis");
+  static int16_t snap[snapN];
+  static uint8_t spectrumTick = 0U;
+  if (++spectrumTick >= SPECTRUM_DIVIDER) {
+    spectrumTick = 0U;
+    scopeSnapshot(snap, snapN);
+    spectrumProcess(snap);
+  }
 #endif
 
-  // Waveform / Spectrum display: take a snapshot of recent samples
-  const size_t dispN = 128; // number of samples to display / analyze
-  static int16_t snap[dispN];
-  scopeSnapshot(snap, dispN);
-  // update waveform on display (stubbed if display not enabled)
-  displayUpdateWaveform(snap, dispN);
-
-  // very small DFT (real-input) to compute magnitudes for low bins
-  const size_t bins = 32; // display bins
-  static float mag[bins];
-  for (size_t k = 0; k < bins; ++k) {
-    float real = 0.0f, imag = 0.0f;
-    for (size_t n = 0; n < dispN; ++n) {
-      const float angle = -2.0f * M_PI * static_cast<float>(k) * static_cast<float>(n) / static_cast<float>(dispN);
-      const float s = static_cast<float>(snap[n]) / 32768.0f;
-      real += s * cosf(angle);
-      imag += s * sinf(angle);
+  // 表示は DISPLAY_FPS の予算内でだけ合成する（転送は非同期、前回の転送中は見送り）。
+  if (displayBeginFrame(audioSampleClock(g_state))) {
+    const uint32_t displayStart = profileBegin();
+    // 波形はトリガ済みのキャプチャフレーム（min/max 対）を描く。時間軸は最低音の約 4 周期に合わせる。
+    scopeSetTimebase(scopeTimebaseForVoices());
+    if (const ScopeFrame *frame = scopeAcquireFrame()) {
+      displayDrawWaveform(frame->min, frame->max, SCOPE_FRAME_POINTS);
     }
-    mag[k] = sqrtf(real * real + imag * imag);
+    displayDrawSpectrum(spectrumBands(), spectrumPeaks(), SPECTRUM_BANDS);
+    uint16_t potValues[kPotCount];
+    for (uint8_t pot = 0; pot < kPotCount; ++pot) {
+      potValues[pot] = effectivePot(static_cast<PotId>(pot));
+    }
+    displayDrawParams(potValues, kPotCount, kAdcMax);
+    displayEndFrame();
+    profileEnd(ProfileZone::kDisplay, displayStart);
+  }
+  profileEnd(ProfileZone::kControlTick, tickStart);
+}
+
+SynthState &synthState() {
+  return g_state;
+}
+
+void resetSynth() {
+  // 自己診断で決めた同時発音数の上限はリセット後も維持する。
+  const VoiceMask voiceMask = g_state.voiceMask;
+  g_state = SynthState();
+  g_state.voiceMask = voiceMask;
+  g_waveform = OscWaveform::kSine;
+  g_filter_low = 0;
+  g_filter_band = 0;
+  g_cutoff.jumpTo(0);
+  g_resonance.jumpTo(0);
+  g_volume.jumpTo(kQ15One);
+  g_unisonSpread = 0U;
+  g_sentCutoff = -1;
+  g_sentResonance = -1;
+  g_patch = SynthPatch();
+  g_storeDeferred = false;
+  g_idleTicks = 0U;
+  g_potHeldMask = 0U;
+  g_recallPending = 0U;
+  g_voiceUpdatePending = 0U;
+  g_outputIndex = kAudioBlockSize;
+}
+
+namespace {
+/**
+ * @brief 自己診断で 1 条件あたりに計測するブロック数（最悪値を採用する）。
+ */
+constexpr uint8_t kHeadroomBlocks = 8U;
+
+/**
+ * @brief 最悪条件（帯域制限ノコギリ波、最大ユニゾン、レゾナンス付きフィルタ）で voices 音を発音させ、
+ *        1 ブロック（kAudioBlockSize フレーム）のレンダリングにかかるサイクル数を計測する。
+ * @param voices 発音させるボイス数。
+ * @return kHeadroomBlocks 回のうち最大のサイクル数。
+ */
+uint32_t measureRenderBlock(const uint8_t voices) {
+  resetSynth();
+  VoiceEvent event;
+  event.type = VoiceEventType::kParam;
+  event.voice = static_cast<uint8_t>(SynthParam::kWaveform);
+  event.value = static_cast<uint32_t>(OscWaveform::kSawBL);
+  postEvent(g_state, event);
+  event.voice = static_cast<uint8_t>(SynthParam::kUnisonSpread);
+  event.value = kQ15One;
+  postEvent(g_state, event);
+  event.voice = static_cast<uint8_t>(SynthParam::kCutoff);
+  event.value = static_cast<uint32_t>(cutoffCurveQ15(kAdcMax / 2U));
+  postEvent(g_state, event);
+  event.voice = static_cast<uint8_t>(SynthParam::kResonance);
+  event.value = static_cast<uint32_t>(kQ15One / 2);
+  postEvent(g_state, event);
+  for (uint8_t v = 0; v < voices; ++v) {
+    const uint8_t index = allocateVoice(g_state);
+    initVoice(g_state, index, static_cast<uint8_t>(48U + v * 7U), 127U);
+    // エンベロープがランプし続ける状態（サンプルごとの加算あり）で計測する。
+    event.type = VoiceEventType::kVoiceUpdate;
+    event.voice = index;
+    event.envelope = static_cast<int16_t>(32767 / kMaxVoices);
+    event.value = g_state.voices.control[index].increment;
+    postEvent(g_state, event);
+    event.type = VoiceEventType::kParam;
+    // キューが溢れないよう 1 ボイスごとにイベントを適用しておく。
+    renderBlock(g_outputBlock, 1U);
   }
-  displayUpdateSpectrum(mag, bins);
+  // 残りのイベントを適用し、キャッシュ等を温めるための空回し。
+  renderBlock(g_outputBlock, kAudioBlockSize);
+  uint32_t worst = 0U;
+  for (uint8_t n = 0; n < kHeadroomBlocks; ++n) {
+    const uint32_t start = cycleCounterRead();
+    renderBlock(g_outputBlock, kAudioBlockSize);
+    const uint32_t cycles = cycleCounterRead() - start;
+    worst = (cycles > worst) ? cycles : worst;
+  }
+  return worst;
+}
+
+/**
+ * @brief 全ボイス発音時のレンダリングが締め切りに収まるか計測し、収まらなければ同時発音数を制限する。
+ *
+ * profileInit() の後、オーディオ処理の開始前に呼び出してください。終了時にシンセ状態と
+ * プロファイラの統計はリセットされます。
+ */
+void checkRenderHeadroom() {
+  RenderHeadroom result;
+  result.budgetCycles = static_cast<uint32_t>(static_cast<uint64_t>(profileCyclesPerSample()) * kAudioBlockSize * RENDER_BUDGET_PERCENT / 100U);
+  g_state.voiceMask = kAllVoicesMask;
+  result.idleCycles = measureRenderBlock(0U);
+  result.fullCycles = measureRenderBlock(kMaxVoices);
+  result.meetsDeadline = (result.budgetCycles == 0U) || (result.fullCycles <= result.budgetCycles);
+  if (!result.meetsDeadline) {
+    // ボイス数に対して線形とみなし、予算に収まるボイス数を求める（少なくとも 1 音は残す）。
+    const uint32_t added = (result.fullCycles > result.idleCycles) ? result.fullCycles - result.idleCycles : 0U;
+    const uint32_t perVoice = (added + kMaxVoices - 1U) / kMaxVoices;
+    const uint32_t spare = (result.budgetCycles > result.idleCycles) ? result.budgetCycles - result.idleCycles : 0U;
+    const uint32_t fit = (perVoice != 0U) ? spare / perVoice : 0U;
+    result.voiceLimit = static_cast<uint8_t>((fit < 1U) ? 1U : ((fit >= kMaxVoices) ? kMaxVoices - 1U : fit));
+  }
+  g_headroom = result;
+  g_state.voiceMask = (result.voiceLimit >= kMaxVoices) ? kAllVoicesMask : voiceBit(result.voiceLimit) - 1U;
+  resetSynth();
+  profileReset();
+}
+}  // namespace
+
+const RenderHeadroom &renderHeadroom() {
+  return g_headroom;
 }
 
 void initializeSynth() {
-  // アナログ入力ピンの初期化。
-  pinMode(kOscSelectPin, INPUT);
-  pinMode(kAttackPin, INPUT);
-  pinMode(kReleasePin, INPUT);
-  pinMode(kFilterPin, INPUT);
-  pinMode(kResonancePin, INPUT);
-  // デジタル鍵盤ピンをプルアップで初期化
-  pinMode(kKeyPin0, INPUT_PULLUP);
-  pinMode(kKeyPin1, INPUT_PULLUP);
-  pinMode(kKeyPin2, INPUT_PULLUP);
-  pinMode(kKeyPin3, INPUT_PULLUP);
-  pinMode(kKeyPin4, INPUT_PULLUP);
-  // MIDI シリアルを初期化。
-  midiSerial().begin(31250);
+  // ポットの取り込みを開始（USE_ADC_DMA 時は DMA による連続スキャン）。
+  potsInit();
+  // 鍵盤（直結またはマトリクス）のピンを初期化し、スキャンを開始
+  keysInit();
+  // MIDI 入力を初期化（受信時刻はオーディオのサンプルクロックで記録）。
+  midiInInit(midiReceiveClock);
+  // パッチ用フラッシュを走査して索引を作る（中断された書き込みはここで読み飛ばす。未使用なら初期化）
+  patchStoreInit();
+  // スペクトラム解析テーブル（窓関数・回転因子・帯域境界）を構築
+  spectrumInit();
+  // サイクルカウンタを開始し、1 サンプルあたりのサイクル予算を求める（CPU 負荷・締め切り判定に使用）
+  profileInit(kAudioRate);
+  // 最悪条件で 1 ブロックを計測し、締め切りに収まらなければ同時発音数を制限する
+  checkRenderHeadroom();
   // Mozzi のオーディオ処理を開始。
   startMozzi(kControlRate);
-  // display init (stub if disabled)
-  displayInit();
+  // 表示を初期化（無効時はスタブ）。フレーム予算はサンプルクロックで管理する。
+  displayInit(kAudioRate);
 }
 
 }  // namespace mini_synth
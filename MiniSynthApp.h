@@ -8,21 +8,63 @@
 
 namespace mini_synth {
 
+/**
+ * @brief 起動時のレンダリング余裕度の自己診断結果（サイクル数は profileCyclesPerSample() と同じ単位）。
+ */
+struct RenderHeadroom {
+  uint32_t budgetCycles = 0U;   //!< 1 ブロック（kAudioBlockSize フレーム）に使ってよいサイクル数（RENDER_BUDGET_PERCENT 適用後）。
+  uint32_t idleCycles = 0U;     //!< 発音なしで 1 ブロックをレンダリングしたサイクル数。
+  uint32_t fullCycles = 0U;     //!< 最悪条件で kMaxVoices 音を 1 ブロックレンダリングしたサイクル数。
+  uint8_t voiceLimit = kMaxVoices; //!< 割り当てに使うボイス数（予算に収まらない場合は kMaxVoices 未満）。
+  bool meetsDeadline = true;    //!< kMaxVoices 音で予算に収まったか。
+};
+
 /**
  * @brief シンセサイザーの初期化処理を実行する。
+ *
+ * Mozzi の開始前にレンダリング余裕度の自己診断（renderHeadroom()）を行い、
+ * 最悪条件で全ボイスが予算に収まらない場合は同時発音数を収まる数に制限します。
  */
 void initializeSynth();
 
+/**
+ * @brief 起動時の自己診断結果を取得する。
+ * @return initializeSynth() で計測した結果（計測前は既定値）。
+ */
+const RenderHeadroom &renderHeadroom();
+
 /**
  * @brief コントロール更新処理を行う。
  */
 void handleControl();
 
+/**
+ * @brief 指定フレーム数のオーディオをブロック単位で生成する。
+ * @param out 出力先バッファ（frames 要素）。
+ * @param frames 生成するフレーム数。kAudioBlockSize を超える場合は内部で分割する。
+ */
+void renderBlock(int16_t *out, size_t frames);
+
 /**
  * @brief 現在の状態からオーディオサンプルを生成する。
+ *
+ * renderBlock() で生成したブロックから 1 サンプルずつ払い出す薄いラッパです。
  * @return モノラルオーディオ出力。
  */
 AudioOutput generateAudio();
 
+/**
+ * @brief シンセ状態への参照を取得する（ベンチマーク/ホストツール用）。
+ * @return 内部のシンセ状態。
+ */
+SynthState &synthState();
+
+/**
+ * @brief ボイス・イベントキュー・フィルタ状態を起動直後の状態に戻す。
+ *
+ * オーディオ処理が動いていないとき（Mozzi 開始前など）にのみ呼び出してください。
+ */
+void resetSynth();
+
 }  // namespace mini_synth
 
@@ -0,0 +1,729 @@
+#include "MiniSynthBench.h"
+
+#if defined(SYNTH_BENCHMARK)
+
+#include <stdio.h>
+
+#include "MiniSynthApp.h"
+#include "MiniSynthCycles.h"
+#include "MiniSynthDsp.h"
+#include "MiniSynthFilter.h"
+#include "MiniSynthMidi.h"
+#include "MiniSynthNoteTable.h"
+#include "MiniSynthOscillator.h"
+#include "MiniSynthScope.h"
+#include "MiniSynthVoice.h"
+
+namespace mini_synth {
+namespace {
+/**
+ * @brief 計測に使うブロック数（ブロックあたり kAudioBlockSize フレーム）。
+ */
+constexpr uint16_t kBenchBlocks = 64U;
+
+/**
+ * @brief 計測の繰り返し回数（最小値を採用して割り込みやキャッシュの外乱を除く）。
+ */
+constexpr uint8_t kBenchRepeats = 5U;
+
+/**
+ * @brief 1 回の計測で処理するサンプル数。
+ */
+constexpr float kBenchSamples = static_cast<float>(kBenchBlocks) * static_cast<float>(kAudioBlockSize);
+
+constexpr const char *kCyclesPerSample = "cycles/sample";
+constexpr const char *kCyclesPerCall = "cycles/call";
+constexpr const char *kMismatches = "mismatches";
+
+/**
+ * @brief ソフトクリップの許容誤差 [LSB]（厳密な x / (1 + |x|) との差）。
+ */
+constexpr int32_t kSoftClipTolerance = 2;
+
+/**
+ * @brief Q15 SVF の許容誤差 [LSB]（同じ入力・係数での浮動小数点 SVF との差）。
+ *
+ * グローバル SVF はソフトクリップ後の出力、ボイス毎 SVF はキー追従テーブルの係数でのフィルタ出力で比べます
+ * （ボイス毎 SVF は係数テーブルの丸めによる周波数差を含む）。
+ */
+constexpr int32_t kSvfGlobalTolerance = 5;
+constexpr int32_t kSvfVoiceTolerance = 34;
+
+/**
+ * @brief 割り当てベンチマークで 1 バッチに発行するノートオン数（横取り時は 2 イベント/回でキューに収まる数）。
+ */
+constexpr uint8_t kAllocBatch = (kEventQueueSize >= 64U) ? 16U : static_cast<uint8_t>(kEventQueueSize / 4U);
+static_assert(kAllocBatch * 2U < kEventQueueSize, "allocation batch must fit in the event queue");
+
+const char *const kWaveformNames[kOscWaveformCount] = {
+    "sine", "triangle", "saw", "pulse", "square", "sawBL", "pulseBL", "squareBL",
+};
+
+int32_t g_benchMix[kAudioBlockSize];
+int16_t g_benchOut[kAudioBlockSize];
+
+/**
+ * @brief fn を kBenchRepeats 回実行し、最小のサイクル数を返す。
+ */
+template <typename Fn>
+uint32_t measureBest(Fn fn) {
+  uint32_t best = UINT32_MAX;
+  for (uint8_t repeat = 0; repeat < kBenchRepeats; ++repeat) {
+    const uint32_t start = cycleCounterRead();
+    fn();
+    const uint32_t elapsed = cycleCounterRead() - start;
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief 出力バッファへの書き込みを最適化で消されないようにするコンパイラバリア。
+ */
+inline void benchKeepOutput() {
+  __asm__ __volatile__("" : : "r"(g_benchOut) : "memory");
+}
+
+/**
+ * @brief 計算結果を最適化で消されないようにするコンパイラバリア。
+ */
+inline void benchKeepValue(const uint32_t value) {
+  __asm__ __volatile__("" : : "r"(value));
+}
+
+/**
+ * @brief フィルタ入力用に、ミックスバッファへ飽和気味のノコギリ波を書き込む。
+ */
+void fillBenchMix() {
+  for (size_t i = 0; i < kAudioBlockSize; ++i) {
+    g_benchMix[i] = static_cast<int32_t>(i * 1024U) - 40000;
+  }
+}
+
+/**
+ * @brief SVF 比較用の入力（周期の異なる 3 つのノコギリ波の和、ピークはほぼフルスケール）を返す。
+ */
+int32_t svfTestInput(const uint32_t n) {
+  const int32_t a = static_cast<int32_t>((n * 149U) & 0x3FFFU) - 0x2000;
+  const int32_t b = static_cast<int32_t>((n * 223U) & 0x3FFFU) - 0x2000;
+  const int32_t c = static_cast<int32_t>((n * 331U) & 0x3FFFU) - 0x2000;
+  return a + b + c;
+}
+
+/**
+ * @brief 浮動小数点 SVF と Q15 SVF に同じ入力を通し、出力差の最大値を返す。
+ * @param fFloat 浮動小数点側の周波数係数。
+ * @param fQ15 Q15 側の周波数係数。
+ * @param qQ15 Q15 のレゾナンス係数（浮動小数点側は 1/32768 倍して使う）。
+ * @param clip true ならグローバル SVF と同じくソフトクリップ後の出力を比べる。
+ * @param tolerance 許容値 [LSB]。
+ * @param over 差が許容値を超えたサンプル数に加算する。
+ */
+int32_t compareSvf(const float fFloat, const int32_t fQ15, const int32_t qQ15, const bool clip, const int32_t tolerance,
+                   uint32_t &over) {
+  const float qFloat = static_cast<float>(qQ15) / static_cast<float>(kQ15One);
+  float lowFloat = 0.0f;
+  float bandFloat = 0.0f;
+  int32_t lowQ15 = 0;
+  int32_t bandQ15 = 0;
+  int32_t worst = 0;
+  for (uint32_t n = 0; n < static_cast<uint32_t>(kBenchBlocks) * kAudioBlockSize; ++n) {
+    const int32_t in = svfTestInput(n);
+    const float yFloat = processSvfFloat(lowFloat, bandFloat, static_cast<float>(in), fFloat, qFloat);
+    const int32_t yQ15 = processSvfQ15(lowQ15, bandQ15, in, fQ15, qQ15);
+    const int32_t a = clip ? softClipFloat(yFloat) : static_cast<int32_t>(yFloat);
+    const int32_t b = clip ? softClipQ15(yQ15) : yQ15;
+    const int32_t error = abs(a - b);
+    over += (error > tolerance) ? 1U : 0U;
+    worst = (error > worst) ? error : worst;
+  }
+  return worst;
+}
+
+/**
+ * @brief 計測用に 1 ボイスだけ有効なボイスバンクを用意する（A4、エンベロープ最大）。
+ */
+void prepareBenchBank(VoiceBank &bank) {
+  bank = VoiceBank();
+  bank.phase[0] = 0U;
+  bank.increment[0] = 115343360UL;
+  bank.envelopeLevel[0] = static_cast<int32_t>(32767) << kEnvelopeLevelShift;
+  bank.envelopeTarget[0] = bank.envelopeLevel[0];
+  initVoiceSVF(bank, 0U, 69U);
+  bank.activeMask = voiceBit(0);
+}
+
+/**
+ * @brief 従来の汎用パス: サンプルごとに renderWave() の switch を評価する。
+ */
+uint32_t runGenericPath(VoiceBank &bank, const OscWaveform waveform) {
+  const uint32_t start = cycleCounterRead();
+  for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+    for (size_t i = 0; i < kAudioBlockSize; ++i) {
+      const int16_t osc = renderWave(bank.phase[0], bank.increment[0], waveform);
+      g_benchMix[i] += (static_cast<int32_t>(osc) * (bank.envelopeLevel[0] >> kEnvelopeLevelShift)) >> 15;
+      bank.phase[0] += bank.increment[0];
+    }
+  }
+  return cycleCounterRead() - start;
+}
+
+/**
+ * @brief 特殊化パス: ブロックごとに 1 回カーネルを選択して呼び出す。
+ */
+uint32_t runKernelPath(VoiceBank &bank, const OscWaveform waveform) {
+  const VoiceKernelParams params;
+  const uint32_t start = cycleCounterRead();
+  for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+    const VoiceKernel kernel = selectVoiceKernel(waveform);
+    kernel(bank, 0U, params, g_benchMix, kAudioBlockSize);
+  }
+  return cycleCounterRead() - start;
+}
+}  // namespace
+
+void benchOscillatorKernels(const BenchReport report) {
+  char name[32];
+  VoiceBank bank;
+  for (uint8_t w = 0; w < kOscWaveformCount; ++w) {
+    const OscWaveform waveform = static_cast<OscWaveform>(w);
+    prepareBenchBank(bank);
+    const uint32_t generic = runGenericPath(bank, waveform);
+    prepareBenchBank(bank);
+    const uint32_t kernel = runKernelPath(bank, waveform);
+    snprintf(name, sizeof(name), "osc/%s/generic", kWaveformNames[w]);
+    report(name, static_cast<float>(generic) / kBenchSamples, kCyclesPerSample);
+    snprintf(name, sizeof(name), "osc/%s/kernel", kWaveformNames[w]);
+    report(name, static_cast<float>(kernel) / kBenchSamples, kCyclesPerSample);
+  }
+}
+
+void benchFilters(const BenchReport report) {
+  fillBenchMix();
+  // カットオフ約 2kHz、レゾナンス 0.5 相当の係数。
+  const float fFloat = 2.0f * sinf(static_cast<float>(M_PI) * 2000.0f / static_cast<float>(kAudioRate));
+  const int32_t fQ15 = static_cast<int32_t>(fFloat * static_cast<float>(kQ15One));
+  const int32_t qQ15 = kQ15One / 2;
+
+  float lowFloat = 0.0f;
+  float bandFloat = 0.0f;
+  const uint32_t svfFloat = measureBest([&]() {
+    for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+      for (size_t i = 0; i < kAudioBlockSize; ++i) {
+        const float in = static_cast<float>(constrain(g_benchMix[i], -32768, 32767));
+        g_benchOut[i] = static_cast<int16_t>(processSvfFloat(lowFloat, bandFloat, in, fFloat, 0.5f));
+      }
+      benchKeepOutput();
+    }
+  });
+  report("filter/svf_float", static_cast<float>(svfFloat) / kBenchSamples, kCyclesPerSample);
+
+  int32_t lowQ15 = 0;
+  int32_t bandQ15 = 0;
+  const uint32_t svfQ15 = measureBest([&]() {
+    for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+      for (size_t i = 0; i < kAudioBlockSize; ++i) {
+        const int32_t in = constrain(g_benchMix[i], -32768, 32767);
+        g_benchOut[i] = static_cast<int16_t>(processSvfQ15(lowQ15, bandQ15, in, fQ15, qQ15));
+      }
+      benchKeepOutput();
+    }
+  });
+  report("filter/svf_q15", static_cast<float>(svfQ15) / kBenchSamples, kCyclesPerSample);
+
+  const uint32_t clipFloat = measureBest([&]() {
+    for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+      for (size_t i = 0; i < kAudioBlockSize; ++i) {
+        g_benchOut[i] = softClipFloat(static_cast<float>(g_benchMix[i]));
+      }
+      benchKeepOutput();
+    }
+  });
+  report("filter/softclip_float", static_cast<float>(clipFloat) / kBenchSamples, kCyclesPerSample);
+
+  const uint32_t clipQ15 = measureBest([&]() {
+    for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+      for (size_t i = 0; i < kAudioBlockSize; ++i) {
+        g_benchOut[i] = softClipQ15(g_benchMix[i]);
+      }
+      benchKeepOutput();
+    }
+  });
+  report("filter/softclip_q15", static_cast<float>(clipQ15) / kBenchSamples, kCyclesPerSample);
+
+  // Q15 SVF（SVF_FIXED_POINT=1）を浮動小数点 SVF と同じ入力で比べる（ビルド設定によらず両方を実行）。
+  // グローバル SVF はカットオフポット 0..3/4 で、ソフトクリップ後の出力を比べる。ボイス毎 SVF は C1..C7 の
+  // キー追従係数（浮動小数点版と Q15 版のテーブル）で比べる。レゾナンス係数は 1/8 / 0.5 / 0.95。
+  // q < 1/8 はほとんど減衰せず、Q15 版は状態の飽和（+24dB）で発散を止め、テーブルの丸めによる周波数差で
+  // 位相もずれ続けるため比較しない。ポットの上端は q が大きいと Chamberlin SVF の安定域
+  // （f < sqrt(q^2 + 4) - q）を外れ、どちらも発散するため含めない。
+  const int32_t qCases[] = {kQ15One / 8, kQ15One / 2, (kQ15One * 95) / 100};
+  uint32_t globalOver = 0U;
+  int32_t globalWorst = 0;
+  uint32_t voiceOver = 0U;
+  int32_t voiceWorst = 0;
+  for (const int32_t q : qCases) {
+    for (uint16_t pot = 0; pot <= (kAdcMax * 3U) / 4U; pot = static_cast<uint16_t>(pot + kAdcMax / 8U)) {
+      const int32_t fQ15 = cutoffCurveQ15(pot);
+      const float fFloat = static_cast<float>(fQ15) / static_cast<float>(kQ15One);
+      const int32_t worst = compareSvf(fFloat, fQ15, q, true, kSvfGlobalTolerance, globalOver);
+      globalWorst = (worst > globalWorst) ? worst : globalWorst;
+    }
+    for (uint8_t note = 24U; note <= 96U; note = static_cast<uint8_t>(note + 12U)) {
+      const int32_t worst = compareSvf(kNoteFTable[note], kNoteFQ15Table[note], q, false, kSvfVoiceTolerance, voiceOver);
+      voiceWorst = (worst > voiceWorst) ? worst : voiceWorst;
+    }
+  }
+  report("filter/svf_q15_mismatches", static_cast<float>(globalOver), kMismatches);
+  report("filter/svf_q15_max_error", static_cast<float>(globalWorst), "lsb");
+  report("filter/voice_svf_q15_mismatches", static_cast<float>(voiceOver), kMismatches);
+  report("filter/voice_svf_q15_max_error", static_cast<float>(voiceWorst), "lsb");
+
+#if VOICE_SVF
+  // ボイス毎 SVF（ビルド設定の精度で、係数はキー追従テーブルの値）。
+  VoiceBank bank;
+  prepareBenchBank(bank);
+#if SVF_FIXED_POINT
+  const SvfValue q = qQ15;
+#else
+  const SvfValue q = 0.5f;
+#endif
+  const uint32_t voiceSvf = measureBest([&]() {
+    for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+      for (size_t i = 0; i < kAudioBlockSize; ++i) {
+        const SvfValue in = static_cast<SvfValue>(constrain(g_benchMix[i], -32768, 32767));
+        g_benchOut[i] = static_cast<int16_t>(processVoiceSVF(bank, 0U, in, bank.svfF[0], q));
+      }
+      benchKeepOutput();
+    }
+  });
+  report("filter/voice_svf", static_cast<float>(voiceSvf) / kBenchSamples, kCyclesPerSample);
+#endif
+}
+
+void benchControlUpdates(const BenchReport report) {
+  // 1 ボイスあたりの呼び出しコストを、1 コントロール周期のサンプル数で按分する。
+  constexpr float kCalls = static_cast<float>(kBenchBlocks) * static_cast<float>(kAudioBlockSize);
+  constexpr float kPerSample = 1.0f / (kCalls * static_cast<float>(kControlPeriod));
+  VoiceBank bank;
+
+  prepareBenchBank(bank);
+  // 計測中にサステインへ到達しないよう、最小の進み幅でアタック段の先頭から進める（カーブ補間を含む経路）。
+  EnvelopeParams params;
+  params.attackRate = 1U;
+  const uint32_t envelope = measureBest([&]() {
+    bank.control[0].stage = EnvelopeStage::kAttack;
+    bank.control[0].envelopePosition = 0U;
+    for (uint16_t call = 0; call < kBenchBlocks * kAudioBlockSize; ++call) {
+      updateEnvelope(bank, 0U, params);
+    }
+  });
+  report("control/envelope", static_cast<float>(envelope) * kPerSample, kCyclesPerSample);
+
+  prepareBenchBank(bank);
+  const uint32_t portamento = measureBest([&]() {
+    bank.control[0].increment = midiNoteToIncrement(48U);
+    bank.control[0].targetIncrement = midiNoteToIncrement(72U);
+    for (uint16_t call = 0; call < kBenchBlocks * kAudioBlockSize; ++call) {
+      updatePortamento(bank, 0U);
+    }
+  });
+  report("control/portamento", static_cast<float>(portamento) * kPerSample, kCyclesPerSample);
+}
+
+namespace {
+/**
+ * @brief コントロール→オーディオのイベントキューを空にする（計測対象外）。
+ */
+void drainEvents(SynthState &state) {
+  while (state.events.peek() != nullptr) {
+    state.events.pop();
+  }
+}
+
+/**
+ * @brief 全ボイスを割り当て済み（発音中）にする。
+ */
+void fillAllVoices(SynthState &state) {
+  for (uint8_t v = 0; v < kMaxVoices; ++v) {
+    noteOn(state, 0U, static_cast<uint8_t>(24U + v), 100U);
+    drainEvents(state);
+  }
+}
+}  // namespace
+
+void benchVoiceAllocation(const BenchReport report) {
+  constexpr float kBatch = static_cast<float>(kAllocBatch);
+  SynthState &state = synthState();
+
+  // 空きボイスへの割り当て（ノートオン→即ノートオフ完了でボイスを空ける）。
+  resetSynth();
+  const uint32_t freeAlloc = measureBest([&]() {
+    for (uint8_t n = 0; n < kAllocBatch; ++n) {
+      const uint8_t index = allocateVoice(state);
+      initVoice(state, index, static_cast<uint8_t>(60U + n), 100U);
+      state.voices.allocatedMask &= ~voiceBit(index);
+    }
+  });
+  drainEvents(state);
+  report("voice/alloc_free", static_cast<float>(freeAlloc) / kBatch, kCyclesPerCall);
+
+  // 全ボイス使用中の横取り（リリース中の候補なし = 全ボイスを走査する最悪ケース）。
+  uint8_t note = 60U;
+  uint32_t steal = UINT32_MAX;
+  resetSynth();
+  fillAllVoices(state);
+  for (uint8_t repeat = 0; repeat < kBenchRepeats; ++repeat) {
+    const uint32_t start = cycleCounterRead();
+    for (uint8_t n = 0; n < kAllocBatch; ++n) {
+      noteOn(state, 0U, note, 100U);
+      note = static_cast<uint8_t>((note >= 100U) ? 60U : note + 1U);
+    }
+    const uint32_t elapsed = cycleCounterRead() - start;
+    steal = (elapsed < steal) ? elapsed : steal;
+    drainEvents(state);
+  }
+  report("voice/alloc_steal", static_cast<float>(steal) / kBatch, kCyclesPerCall);
+
+  // ノート→ボイス検索（鍵盤スキャンは毎ティック鍵数分呼ぶ）。
+  uint8_t found = 0U;
+  const uint32_t find = measureBest([&]() {
+    for (uint16_t n = 0; n < kMidiNoteCount; ++n) {
+      found += findVoiceByNote(state, static_cast<uint8_t>(n));
+    }
+  });
+  benchKeepValue(found);
+  report("voice/find", static_cast<float>(find) / static_cast<float>(kMidiNoteCount), kCyclesPerCall);
+  resetSynth();
+}
+
+void benchFullRender(const BenchReport report) {
+  // ブロック境界をまたぐよう、計測は generateAudio() の 1 サンプル呼び出しで行う。
+  const uint32_t samples = static_cast<uint32_t>(kBenchBlocks) * kAudioBlockSize;
+  float cost[kMaxVoices + 1U];
+  char name[32];
+  for (uint8_t voices = 0; voices <= kMaxVoices; ++voices) {
+    resetSynth();
+    SynthState &state = synthState();
+    VoiceEvent event;
+    event.type = VoiceEventType::kParam;
+    event.voice = static_cast<uint8_t>(SynthParam::kWaveform);
+    event.value = static_cast<uint32_t>(OscWaveform::kSawBL);
+    postEvent(state, event);
+    event.voice = static_cast<uint8_t>(SynthParam::kCutoff);
+    event.value = static_cast<uint32_t>(cutoffCurveQ15(kAdcMax / 2U));
+    postEvent(state, event);
+    event.voice = static_cast<uint8_t>(SynthParam::kResonance);
+    event.value = static_cast<uint32_t>(kQ15One / 2);
+    postEvent(state, event);
+    for (uint8_t v = 0; v < voices; ++v) {
+      const uint8_t index = allocateVoice(state);
+      initVoice(state, index, static_cast<uint8_t>(48U + v * 7U), 127U);
+      // サステイン相当の音量で発音させる。
+      event.type = VoiceEventType::kVoiceUpdate;
+      event.voice = index;
+      event.envelope = static_cast<int16_t>(32767 / kMaxVoices);
+      event.value = state.voices.control[index].increment;
+      postEvent(state, event);
+      event.type = VoiceEventType::kParam;
+      // ボイス数が多いとキューが溢れるため、1 ボイスごとにイベントを適用しておく。
+      renderBlock(g_benchOut, 1U);
+    }
+    // イベントを適用するための空回し。
+    for (size_t i = 0; i < kAudioBlockSize; ++i) {
+      (void)generateAudio();
+    }
+    const uint32_t cycles = measureBest([&]() {
+      for (uint32_t i = 0; i < samples; ++i) {
+        g_benchOut[i % kAudioBlockSize] = generateAudio().output;
+      }
+    });
+    cost[voices] = static_cast<float>(cycles) / static_cast<float>(samples);
+    snprintf(name, sizeof(name), "render/voices=%u", static_cast<unsigned>(voices));
+    report(name, cost[voices], kCyclesPerSample);
+  }
+  resetSynth();
+
+  const float budget = cycleCounterFrequency() / static_cast<float>(kAudioRate);
+  const float perVoice = (cost[kMaxVoices] - cost[0]) / static_cast<float>(kMaxVoices);
+  report("render/budget", budget, kCyclesPerSample);
+  report("render/per_voice", perVoice, kCyclesPerSample);
+  const float maxVoices = (perVoice > 0.0f) ? (budget - cost[0]) / perVoice : 0.0f;
+  report("render/max_voices", (maxVoices > 0.0f) ? floorf(maxVoices) : 0.0f, "voices");
+}
+
+#if UNISON_VOICES
+namespace {
+/**
+ * @brief ユニゾンカーネルの参照実装: サブオシレータを 1 つずつスカラー演算で生成する（パック演算を使わない）。
+ *
+ * エンベロープは一定（ランプなし）の場合だけを扱います。
+ */
+void renderUnisonReference(VoiceBank &bank, const VoiceKernelParams &params, int32_t *mix, const size_t frames) {
+  const uint32_t increment = bank.increment[0];
+  const int32_t envelope = bank.envelopeLevel[0] >> kEnvelopeLevelShift;
+  uint32_t increments[kUnisonVoices];
+  for (uint8_t k = 0; k < kUnisonVoices; ++k) {
+    increments[k] = unisonIncrement(increment, params.unisonSpread, k);
+  }
+  for (size_t i = 0; i < frames; ++i) {
+    int32_t acc = static_cast<int32_t>(renderWave(bank.phase[0], increment, OscWaveform::kSawBL)) * kUnisonCenterGain;
+    bank.phase[0] += increment;
+    for (uint8_t k = 0; k < kUnisonVoices; ++k) {
+      acc += (static_cast<int32_t>(bank.unisonPhase[0][k] >> 16U) - 32768) * kUnisonSideGain;
+      bank.unisonPhase[0][k] += increments[k];
+    }
+    int32_t sample = ((acc >> 15) * envelope) >> 15;
+#if VOICE_SVF
+    sample = static_cast<int32_t>(processVoiceSVF(bank, 0U, static_cast<SvfValue>(sample), bank.svfF[0], params.resonance));
+#endif
+    mix[i] += sample;
+  }
+}
+}  // namespace
+#endif
+
+void benchUnison(const BenchReport report) {
+#if UNISON_VOICES
+  // 低音〜高音とデチューン幅の組み合わせで、カーネルと参照実装の出力をブロック単位で比較する。
+  const uint8_t kNotes[] = {24U, 57U, 96U};
+  const uint16_t kSpreads[] = {1U, 8192U, 32767U};
+  VoiceKernelParams params;
+#if SVF_FIXED_POINT
+  params.resonance = kQ15One / 2;
+#else
+  params.resonance = 0.5f;
+#endif
+  const VoiceKernel kernel = selectVoiceKernel(OscWaveform::kSawBL, true);
+  VoiceBank bank;
+  VoiceBank reference;
+  int32_t referenceMix[kAudioBlockSize];
+  uint32_t mismatches = 0U;
+  for (const uint8_t note : kNotes) {
+    for (const uint16_t spread : kSpreads) {
+      params.unisonSpread = spread;
+      prepareBenchBank(bank);
+      bank.increment[0] = midiNoteToIncrement(note);
+      initUnisonPhases(bank, 0U);
+      reference = bank;
+      for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+        for (size_t i = 0; i < kAudioBlockSize; ++i) {
+          g_benchMix[i] = 0;
+          referenceMix[i] = 0;
+        }
+        kernel(bank, 0U, params, g_benchMix, kAudioBlockSize);
+        renderUnisonReference(reference, params, referenceMix, kAudioBlockSize);
+        for (size_t i = 0; i < kAudioBlockSize; ++i) {
+          mismatches += (g_benchMix[i] != referenceMix[i]) ? 1U : 0U;
+        }
+      }
+    }
+  }
+  report("unison/mismatches", static_cast<float>(mismatches), kMismatches);
+
+  // 1 ボイスのユニゾンと、同じ数のオシレータをフルボイスで重ねた場合のコスト。
+  params.unisonSpread = 16384U;
+  prepareBenchBank(bank);
+  initUnisonPhases(bank, 0U);
+  const uint32_t unison = measureBest([&]() {
+    for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+      kernel(bank, 0U, params, g_benchMix, kAudioBlockSize);
+    }
+  });
+  const VoiceKernel plain = selectVoiceKernel(OscWaveform::kSawBL);
+  prepareBenchBank(bank);
+  const uint32_t stacked = measureBest([&]() {
+    for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+      for (uint8_t k = 0; k <= kUnisonVoices; ++k) {
+        plain(bank, 0U, params, g_benchMix, kAudioBlockSize);
+      }
+    }
+  });
+  char name[32];
+  snprintf(name, sizeof(name), "unison/kernel_x%u", static_cast<unsigned>(kUnisonVoices + 1U));
+  report(name, static_cast<float>(unison) / kBenchSamples, kCyclesPerSample);
+  snprintf(name, sizeof(name), "unison/full_voices_x%u", static_cast<unsigned>(kUnisonVoices + 1U));
+  report(name, static_cast<float>(stacked) / kBenchSamples, kCyclesPerSample);
+#else
+  (void)report;
+#endif
+}
+
+#if !VOICE_SVF
+namespace {
+/**
+ * @brief ペアカーネルの参照実装: ボイスごとに波形とエンベロープ列を求め、2 ボイスの積和を 64bit で計算する。
+ *
+ * エンベロープのランプは renderVoiceBlock() と同じ規則（増分を加えてから使い、ランプ終端で目標値に揃える）です。
+ */
+void renderPairReference(VoiceBank &bank, const uint8_t a, const uint8_t b, const OscWaveform waveform, int32_t *mix, const size_t frames) {
+  int16_t osc[2][kAudioBlockSize];
+  int32_t envelope[2][kAudioBlockSize];
+  const uint8_t voices[2] = {a, b};
+  for (uint8_t v = 0; v < 2U; ++v) {
+    const uint8_t index = voices[v];
+    renderWaveBlock(bank.phase[index], bank.increment[index], waveform, osc[v], frames);
+    const size_t ramp = (bank.envelopeRamp[index] < frames) ? bank.envelopeRamp[index] : frames;
+    int32_t level = bank.envelopeLevel[index];
+    for (size_t i = 0; i < frames; ++i) {
+      if (i < ramp) {
+        level += bank.envelopeStep[index];
+      } else if (i == ramp && ramp != 0U && bank.envelopeRamp[index] == ramp) {
+        level = bank.envelopeTarget[index];
+      }
+      envelope[v][i] = level >> kEnvelopeLevelShift;
+    }
+    bank.envelopeRamp[index] = static_cast<uint16_t>(bank.envelopeRamp[index] - ramp);
+    if (ramp != 0U && bank.envelopeRamp[index] == 0U) {
+      level = bank.envelopeTarget[index];
+    }
+    bank.envelopeLevel[index] = level;
+  }
+  for (size_t i = 0; i < frames; ++i) {
+    const int64_t sum = static_cast<int64_t>(osc[0][i]) * envelope[0][i] + static_cast<int64_t>(osc[1][i]) * envelope[1][i];
+    mix[i] += static_cast<int32_t>(sum >> 15);
+  }
+}
+
+/**
+ * @brief 2 ボイスを別々の音程・エンベロープランプ長で発音中にする。
+ */
+void preparePairBank(VoiceBank &bank) {
+  prepareBenchBank(bank);
+  bank.increment[1] = midiNoteToIncrement(50U);
+  bank.phase[1] = 0x12345678UL;
+  // ボイス 0 はブロックをまたぐ上昇ランプ、ボイス 1 はブロック途中で終わる下降ランプ。
+  bank.envelopeLevel[0] = 0;
+  bank.envelopeTarget[0] = static_cast<int32_t>(30000) << kEnvelopeLevelShift;
+  bank.envelopeStep[0] = bank.envelopeTarget[0] / static_cast<int32_t>(kControlPeriod);
+  bank.envelopeRamp[0] = kControlPeriod;
+  bank.envelopeLevel[1] = static_cast<int32_t>(32767) << kEnvelopeLevelShift;
+  bank.envelopeTarget[1] = static_cast<int32_t>(5000) << kEnvelopeLevelShift;
+  bank.envelopeStep[1] = (bank.envelopeTarget[1] - bank.envelopeLevel[1]) / 37;
+  bank.envelopeRamp[1] = 37U;
+  initVoiceSVF(bank, 1U, 50U);
+  bank.activeMask = voiceBit(0) | voiceBit(1);
+}
+}  // namespace
+#endif
+
+void benchMixStage(const BenchReport report) {
+#if !VOICE_SVF
+  // ペアカーネル（実機は SMUAD/PKHBT/PKHTB、ホストはスカラー実装）と参照実装を全波形で比較する。
+  const VoiceKernelParams params;
+  VoiceBank bank;
+  VoiceBank reference;
+  int32_t referenceMix[kAudioBlockSize];
+  uint32_t mismatches = 0U;
+  for (uint8_t w = 0; w < kOscWaveformCount; ++w) {
+    const OscWaveform waveform = static_cast<OscWaveform>(w);
+    const VoicePairKernel pair = selectVoicePairKernel(waveform);
+    preparePairBank(bank);
+    reference = bank;
+    for (uint16_t block = 0; block < 8U; ++block) {
+      for (size_t i = 0; i < kAudioBlockSize; ++i) {
+        g_benchMix[i] = 0;
+        referenceMix[i] = 0;
+      }
+      pair(bank, 0U, 1U, params, g_benchMix, kAudioBlockSize);
+      renderPairReference(reference, 0U, 1U, waveform, referenceMix, kAudioBlockSize);
+      for (size_t i = 0; i < kAudioBlockSize; ++i) {
+        mismatches += (g_benchMix[i] != referenceMix[i]) ? 1U : 0U;
+      }
+    }
+  }
+  report("mix/pair_mismatches", static_cast<float>(mismatches), kMismatches);
+
+  // 2 ボイス（帯域制限ノコギリ波、サステイン中）をペアカーネル 1 回と単独カーネル 2 回で処理するコスト。
+  const VoicePairKernel pair = selectVoicePairKernel(OscWaveform::kSawBL);
+  const VoiceKernel single = selectVoiceKernel(OscWaveform::kSawBL);
+  preparePairBank(bank);
+  bank.envelopeRamp[0] = 0U;
+  bank.envelopeRamp[1] = 0U;
+  const uint32_t paired = measureBest([&]() {
+    for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+      pair(bank, 0U, 1U, params, g_benchMix, kAudioBlockSize);
+    }
+  });
+  const uint32_t separate = measureBest([&]() {
+    for (uint16_t block = 0; block < kBenchBlocks; ++block) {
+      single(bank, 0U, params, g_benchMix, kAudioBlockSize);
+      single(bank, 1U, params, g_benchMix, kAudioBlockSize);
+    }
+  });
+  report("mix/2voices_pair", static_cast<float>(paired) / kBenchSamples, kCyclesPerSample);
+  report("mix/2voices_single", static_cast<float>(separate) / kBenchSamples, kCyclesPerSample);
+#endif
+
+  // ソフトクリップ: 厳密な曲線との差（SVF_FIXED_POINT の状態範囲は全点、その先は 61 刻み）。
+  uint32_t clipMismatches = 0U;
+  int32_t worst = 0;
+  auto checkClip = [&](const int32_t value) {
+    const double x = static_cast<double>(value);
+    const double exact = x * 32768.0 / (32768.0 + fabs(x));
+    const int32_t expected = static_cast<int32_t>(exact + ((exact < 0.0) ? -0.5 : 0.5));
+    const int32_t error = abs(static_cast<int32_t>(softClipQ15(value)) - expected);
+    worst = (error > worst) ? error : worst;
+    clipMismatches += (error > kSoftClipTolerance) ? 1U : 0U;
+  };
+  for (int32_t value = -kSvfStateLimit; value <= kSvfStateLimit; ++value) {
+    checkClip(value);
+  }
+  for (int32_t value = kSvfStateLimit; value <= kSoftClipInputLimit; value += 61) {
+    checkClip(value);
+    checkClip(-value);
+  }
+  report("mix/softclip_mismatches", static_cast<float>(clipMismatches), kMismatches);
+  report("mix/softclip_max_error", static_cast<float>(worst), "lsb");
+}
+
+void benchScope(const BenchReport report) {
+#if ENABLE_SCOPE
+  // ノコギリ波（トリガが毎周期かかる）で、間引き 1 と 64 の平均コストと 1 呼び出しの最悪値を測る。
+  const uint16_t kDecimations[] = {1U, 64U};
+  const size_t samples = static_cast<size_t>(kBenchSamples);
+  for (const uint16_t decimation : kDecimations) {
+    scopeSetTimebase(decimation);
+    scopeSetTrigger(ScopeTrigger::kRising, 0, 512);
+    const uint32_t average = measureBest([&]() {
+      for (size_t i = 0; i < samples; ++i) {
+        scopePushSample(static_cast<int16_t>(i * 512U));
+      }
+    });
+    uint32_t worst = 0U;
+    for (size_t i = 0; i < samples; ++i) {
+      const uint32_t start = cycleCounterRead();
+      scopePushSample(static_cast<int16_t>(i * 512U));
+      const uint32_t elapsed = cycleCounterRead() - start;
+      worst = (elapsed > worst) ? elapsed : worst;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "scope/push_d%u", static_cast<unsigned>(decimation));
+    report(name, static_cast<float>(average) / kBenchSamples, kCyclesPerSample);
+    snprintf(name, sizeof(name), "scope/push_d%u_max", static_cast<unsigned>(decimation));
+    report(name, static_cast<float>(worst), kCyclesPerCall);
+  }
+  scopeSetTimebase(SCOPE_DECIMATION);
+  scopeSetTrigger(ScopeTrigger::kRising, 0, 512);
+#else
+  (void)report;
+#endif
+}
+
+void benchRunAll(const BenchReport report) {
+  cycleCounterInit();
+  benchOscillatorKernels(report);
+  benchUnison(report);
+  benchMixStage(report);
+  benchFilters(report);
+  benchControlUpdates(report);
+  benchVoiceAllocation(report);
+  benchScope(report);
+  benchFullRender(report);
+}
+
+}  // namespace mini_synth
+
+#endif  // SYNTH_BENCHMARK
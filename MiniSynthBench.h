@@ -0,0 +1,98 @@
+#pragma once
+
+#include "MiniSynthTypes.h"
+
+// 処理段ごとのマイクロベンチマーク（-DSYNTH_BENCHMARK=1 で有効化）。
+// 実機では setup() の先頭（Mozzi 開始前）で benchRunAll() を呼び、DWT サイクルカウンタで計測します。
+// ホストでは host/synth_bench が同じ関数を呼び出します（TSC 基準）。
+
+namespace mini_synth {
+
+/**
+ * @brief ベンチマーク結果を受け取るコールバック。
+ * @param name 計測項目名（"osc/saw/kernel" のように段/項目で区切る）。
+ * @param value 計測値。
+ * @param unit 値の単位（"cycles/sample"、"cycles/call"、"voices"、"lsb" または "mismatches"）。
+ *             "mismatches" は検証項目で、0 以外は失敗を表します。
+ */
+using BenchReport = void (*)(const char *name, float value, const char *unit);
+
+/**
+ * @brief 各波形について、従来の汎用パス（サンプル毎の switch）と特殊化カーネルを計測する。
+ * @param report 結果の出力先。
+ */
+void benchOscillatorKernels(BenchReport report);
+
+/**
+ * @brief SVF（浮動小数点/Q15、VOICE_SVF 有効時はボイス毎 SVF）とソフトクリップを計測する。
+ *
+ * あわせて Q15 SVF を同じ入力の浮動小数点 SVF と比べ、許容誤差を超えたサンプル数を
+ * "filter/svf_q15_mismatches"（グローバル SVF）と "filter/voice_svf_q15_mismatches"（ボイス毎 SVF）として報告します。
+ * @param report 結果の出力先。
+ */
+void benchFilters(BenchReport report);
+
+/**
+ * @brief updateEnvelope() と updatePortamento() を計測する。
+ *
+ * コントロールレートの処理なので、1 ボイスあたりの呼び出しコストを
+ * 1 コントロール周期（kControlPeriod サンプル）で割った値を報告します。
+ * @param report 結果の出力先。
+ */
+void benchControlUpdates(BenchReport report);
+
+/**
+ * @brief ボイス割り当て（空きあり/横取り）と findVoiceByNote() の 1 呼び出しあたりのコストを計測する。
+ *
+ * MAX_VOICES を変えてビルドした結果を比べると、ボイス数に対するスケーリングを確認できます。
+ * @param report 結果の出力先。
+ */
+void benchVoiceAllocation(BenchReport report);
+
+/**
+ * @brief scopePushSample()（オーディオ割り込みから呼ぶ）の平均コストと 1 呼び出しの最悪値を計測する。
+ *
+ * 間引き 1 と 64 の両方を計測し、時間軸によらずコストが一定であることを確認します。
+ * 最悪値にはサイクルカウンタの読み出し 2 回分が含まれます（ENABLE_SCOPE=0 では何もしない）。
+ * @param report 結果の出力先。
+ */
+void benchScope(BenchReport report);
+
+/**
+ * @brief ユニゾンカーネルを検証・計測する（UNISON_VOICES=0 では何もしない）。
+ *
+ * パック演算（実機は SMLAD/PKHTB、ホストはスカラー実装）のカーネル出力を、サブオシレータを
+ * 1 つずつ生成する参照実装と比較し、一致しないサンプル数を "unison/mismatches" として報告します。
+ * あわせて 1 ボイスあたりのコストを、帯域制限ノコギリ波のカーネルを kUnisonVoices + 1 回呼ぶ場合と比べます。
+ * @param report 結果の出力先。
+ */
+void benchUnison(BenchReport report);
+
+/**
+ * @brief ボイス加算段（ペアカーネル）とソフトクリップを検証・計測する。
+ *
+ * ペアカーネル（実機は SMUAD、ホストはスカラー実装）の出力を、ボイスごとに波形とエンベロープ列を求めて
+ * 64bit で積和する参照実装と全波形で比較し、一致しないサンプル数を "mix/pair_mismatches" として報告します
+ * （VOICE_SVF 有効時はペアカーネルを使わないため省略）。ソフトクリップは厳密な x / (1 + |x|) との差が
+ * 許容誤差を超えた入力数と最大誤差を報告します。
+ * @param report 結果の出力先。
+ */
+void benchMixStage(BenchReport report);
+
+/**
+ * @brief 0..kMaxVoices 音を発音させた状態で generateAudio() を計測し、最大同時発音数を見積もる。
+ *
+ * ボイス数に対する増分から 1 ボイスのコストを求め、kAudioRate でサイクル予算に収まる
+ * ボイス数を "render/max_voices" として報告します（kMaxVoices を超える値は外挿です）。
+ * 計測後はシンセ状態を resetSynth() で初期化します。
+ * @param report 結果の出力先。
+ */
+void benchFullRender(BenchReport report);
+
+/**
+ * @brief すべてのベンチマークを実行する。
+ * @param report 結果の出力先。
+ */
+void benchRunAll(BenchReport report);
+
+}  // namespace mini_synth
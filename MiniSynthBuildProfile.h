@@ -0,0 +1,85 @@
+#pragma once
+
+// ビルドプロファイル: ターゲットごとの機能スイッチの既定値をここで一括して決めます。
+//
+// -DBUILD_PROFILE=BUILD_PROFILE_MINIMAL  (1) : STM32F103 向け。FPU/DSP 拡張なし・RAM 20KB・フラッシュ 64KB を想定し、
+//                                              固定小数点 SVF、ユニゾン・スコープ・スペクトラム・プロファイラなし、
+//                                              パッチは 32 個（2KB のフラッシュバンクに収める）
+// -DBUILD_PROFILE=BUILD_PROFILE_STANDARD (2) : STM32F411 向けの既定構成（従来と同じ）
+// -DBUILD_PROFILE=BUILD_PROFILE_FULL     (3) : F411 で全機能（ボイス毎 SVF、8 ボイス、8 サブオシレータのユニゾン）
+//
+// プロファイルは既定値を与えるだけで、個別のスイッチ（-DMAX_VOICES=6 など）を指定すればそちらが優先されます。
+// 外部ハードウェアが必要なスイッチ（USE_I2S、ENABLE_DISPLAY、USE_ADC_DMA、USE_MIDI_UART_IRQ、KEY_MATRIX、USE_PATCH_FLASH）は
+// プロファイルによらず明示的に指定してください。
+//
+// 無効にした機能は状態（RAM）とコード（フラッシュ）ごと取り除かれます。サブシステムごとの使用量は
+// host/footprint でリンクマップから集計できます（readme 参照）。
+
+#define BUILD_PROFILE_MINIMAL 1
+#define BUILD_PROFILE_STANDARD 2
+#define BUILD_PROFILE_FULL 3
+
+#ifndef BUILD_PROFILE
+#define BUILD_PROFILE BUILD_PROFILE_STANDARD
+#endif
+
+#if BUILD_PROFILE == BUILD_PROFILE_MINIMAL
+
+#ifndef SVF_FIXED_POINT
+#define SVF_FIXED_POINT 1
+#endif
+#ifndef VOICE_SVF
+#define VOICE_SVF 0
+#endif
+#ifndef UNISON_VOICES
+#define UNISON_VOICES 0
+#endif
+#ifndef EVENT_QUEUE_SIZE
+#define EVENT_QUEUE_SIZE 32
+#endif
+#ifndef MIDI_RX_BUFFER_SIZE
+#define MIDI_RX_BUFFER_SIZE 128
+#endif
+#ifndef ENABLE_SCOPE
+#define ENABLE_SCOPE 0
+#endif
+#ifndef SYNTH_PROFILE
+#define SYNTH_PROFILE 0
+#endif
+#ifndef PATCH_SLOTS
+#define PATCH_SLOTS 32
+#endif
+
+#elif BUILD_PROFILE == BUILD_PROFILE_STANDARD
+
+// 各ヘッダの既定値をそのまま使う。
+
+#elif BUILD_PROFILE == BUILD_PROFILE_FULL
+
+#ifndef MAX_VOICES
+#define MAX_VOICES 8
+#endif
+#ifndef VOICE_SVF
+#define VOICE_SVF 1
+#endif
+#ifndef UNISON_VOICES
+#define UNISON_VOICES 8
+#endif
+
+#else
+#error "BUILD_PROFILE must be BUILD_PROFILE_MINIMAL, BUILD_PROFILE_STANDARD or BUILD_PROFILE_FULL"
+#endif
+
+// -DENABLE_SCOPE=0 : オシロスコープのキャプチャ（生サンプルのリングと min/max フレーム）を取り除く
+#ifndef ENABLE_SCOPE
+#define ENABLE_SCOPE 1
+#endif
+
+// -DENABLE_SPECTRUM=0 : スペクトラム解析（FFT テーブルと帯域レベル）を取り除く（既定はスコープと同じ）
+#ifndef ENABLE_SPECTRUM
+#define ENABLE_SPECTRUM ENABLE_SCOPE
+#endif
+
+#if ENABLE_SPECTRUM && !ENABLE_SCOPE
+#error "ENABLE_SPECTRUM requires ENABLE_SCOPE (the analyzer reads scope snapshots)"
+#endif
@@ -5,9 +5,13 @@
 /**
  * Lightweight CPU load measurement for Mozzi audio callback.
  *
+ * Time is taken from the cycle counter (MiniSynthCycles.h), converted with the
+ * counter rate found by profileInit(); per-stage worst cases are in MiniSynthProfiler.h.
+ *
  * Usage:
  *  - Call cpuLoadEnter() at start of audio callback (ISR).
- *  - Call cpuLoadExit() at end of audio callback (ISR).
+ *  - Call cpuLoadExit() at end of audio callback (ISR). Block callbacks pass the
+ *    number of frames they produced so the load is still relative to the frame period.
  *  - Periodically (control rate) call cpuLoadSampleAndReset(kAudioRate) to
  *    compute the percent CPU load since the last sample and reset accumulators.
  *
@@ -24,7 +28,7 @@
 #endif
 
 void cpuLoadEnter();
-void cpuLoadExit();
+void cpuLoadExit(uint32_t frames = 1);
 
 /**
  * Compute CPU load percent since last sample (and reset accumulators).
@@ -0,0 +1,62 @@
+// MiniSynthCycles.h
+#pragma once
+#include <Arduino.h>
+
+/**
+ * Cycle counter helpers for benchmarking and profiling.
+ *
+ *  - Cortex-M3/M4/M7: DWT CYCCNT (core clock cycles, wraps every 2^32 cycles)
+ *  - Host x86: TSC via __rdtsc()
+ *  - Other hosts: steady_clock nanoseconds (reported as "cycles" at 1 GHz)
+ *
+ * Differences of two cycleCounterRead() values are valid across a single wrap.
+ * cycleCounterFrequency() gives the counter rate, used to turn cycle counts into
+ * a budget per audio sample.
+ */
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define MINI_SYNTH_HAS_DWT 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+inline void cycleCounterInit() {
+#if defined(MINI_SYNTH_HAS_DWT)
+  volatile uint32_t *const demcr = reinterpret_cast<volatile uint32_t *>(0xE000EDFCUL);
+  volatile uint32_t *const dwtCtrl = reinterpret_cast<volatile uint32_t *>(0xE0001000UL);
+  volatile uint32_t *const dwtCyccnt = reinterpret_cast<volatile uint32_t *>(0xE0001004UL);
+  *demcr |= (1UL << 24);  // TRCENA
+  *dwtCyccnt = 0;
+  *dwtCtrl |= 1UL;        // CYCCNTENA
+#endif
+}
+
+inline uint32_t cycleCounterRead() {
+#if defined(MINI_SYNTH_HAS_DWT)
+  return *reinterpret_cast<volatile uint32_t *>(0xE0001004UL);
+#elif defined(__x86_64__) || defined(__i386__)
+  return static_cast<uint32_t>(__rdtsc());
+#else
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+inline float cycleCounterFrequency() {
+#if defined(MINI_SYNTH_HAS_DWT) && defined(F_CPU)
+  return static_cast<float>(F_CPU);
+#elif defined(MINI_SYNTH_HAS_DWT) || defined(__x86_64__) || defined(__i386__)
+  // Calibrate against micros() over ~20 ms (call before the audio interrupt starts).
+  const uint32_t startUs = micros();
+  const uint32_t startCycles = cycleCounterRead();
+  while (micros() - startUs < 20000UL) {
+  }
+  const uint32_t cycles = cycleCounterRead() - startCycles;
+  const uint32_t elapsedUs = micros() - startUs;
+  return static_cast<float>(cycles) * (1000000.0f / static_cast<float>(elapsedUs));
+#else
+  return 1.0e9f;
+#endif
+}
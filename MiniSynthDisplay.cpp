@@ -1,59 +1,409 @@
 #include "MiniSynthDisplay.h"
 
-#if defined(ENABLE_DISPLAY)
+#include <string.h>
+
+#if defined(ENABLE_DISPLAY) || defined(DISPLAY_HOST_SIM)
+
+namespace {
+
+// Views (pixel rectangles) of the composited frame.
+constexpr uint8_t kWaveHeight = 31U;    // rows 0..30
+constexpr uint8_t kLowerTop = 32U;      // spectrum and parameters: rows 32..63
+constexpr uint8_t kLowerHeight = kDisplayHeight - kLowerTop;
+constexpr uint8_t kSpectrumWidth = 96U; // columns 0..95
+constexpr uint8_t kParamsLeft = 98U;    // columns 98..127
+
+uint8_t g_frame[kDisplayPages][kDisplayWidth];
+// What the panel shows (tiles are copied here when their transfer is queued).
+uint8_t g_sent[kDisplayPages][kDisplayWidth];
+// Tiles still to be transferred, one bit per tile and page.
+uint16_t g_pending[kDisplayPages];
+uint8_t g_pendingPage = 0U;
+volatile bool g_busy = false;
+bool g_forceFull = true;
+
+uint32_t g_frameInterval = 1U;
+uint32_t g_nextFrame = 0U;
+bool g_started = false;
+DisplayStats g_stats;
+
+inline void setPixel(int x, int y) {
+  g_frame[y >> 3][x] |= static_cast<uint8_t>(1U << (y & 7));
+}
+
+// Vertical span y0..y1 (any order) in column x.
+void drawVSpan(int x, int y0, int y1) {
+  if (y0 > y1) {
+    const int t = y0;
+    y0 = y1;
+    y1 = t;
+  }
+  for (int y = y0; y <= y1; ++y) {
+    setPixel(x, y);
+  }
+}
+
+int levelToHeight(float level, int height) {
+  int h = static_cast<int>(level * static_cast<float>(height) + 0.5f);
+  return (h < 0) ? 0 : ((h > height) ? height : h);
+}
+
+/**
+ * Pop the next run of dirty tiles (consecutive tiles of one page).
+ * @return false when nothing is left.
+ */
+bool nextRun(uint8_t *page, uint8_t *tile, uint8_t *count) {
+  while (g_pendingPage < kDisplayPages && g_pending[g_pendingPage] == 0U) {
+    ++g_pendingPage;
+  }
+  if (g_pendingPage >= kDisplayPages) {
+    return false;
+  }
+  const uint16_t mask = g_pending[g_pendingPage];
+  const uint8_t first = static_cast<uint8_t>(__builtin_ctz(mask));
+  uint8_t n = 0U;
+  while (first + n < kDisplayTilesPerPage && (mask & (1U << (first + n))) != 0U) {
+    ++n;
+  }
+  g_pending[g_pendingPage] = static_cast<uint16_t>(mask & ~(((1U << n) - 1U) << first));
+  *page = g_pendingPage;
+  *tile = first;
+  *count = n;
+  g_stats.tilesSent += n;
+  return true;
+}
+
+void beginTransfer();
+
+}  // namespace
+
+#if defined(ENABLE_DISPLAY) && defined(DISPLAY_I2C_DMA)
+
+// ---------------------------------------------------------------------------
+// SSD1306 over STM32 HAL I2C DMA.
+// This code assumes I2C1 was generated with CubeMX (fast mode, TX DMA stream
+// with its interrupt enabled) and that MX_I2C1_Init() has been called so the
+// handle (hi2c1) exists. Each run is a command transfer (column/page window)
+// followed by a data transfer; the next one is started from the completion
+// interrupt, so the control context never waits for the bus.
+// ---------------------------------------------------------------------------
+
+#include "stm32f4xx_hal.h"
+
+extern I2C_HandleTypeDef hi2c1; // provided by CubeMX: I2C1 handle
+
+namespace {
+
+constexpr uint16_t kI2cAddress = DISPLAY_I2C_ADDRESS << 1;
+
+// Staging buffers read by DMA: control byte + payload.
+uint8_t g_command[7];
+uint8_t g_data[1 + kDisplayWidth];
+uint16_t g_dataLength = 0U;
+bool g_dataPhase = false;
+
+const uint8_t kInitSequence[] = {
+    0x00,       // control byte: command stream
+    0xAE,       // display off
+    0xD5, 0x80, // clock divide
+    0xA8, 0x3F, // multiplex 64
+    0xD3, 0x00, // display offset
+    0x40,       // start line 0
+    0x8D, 0x14, // charge pump on
+    0x20, 0x00, // horizontal addressing (windows set by 0x21/0x22)
+    0xA1, 0xC8, // segment remap, COM scan direction
+    0xDA, 0x12, // COM pins
+    0x81, 0xCF, // contrast
+    0xD9, 0xF1, // pre-charge
+    0xDB, 0x40, // VCOMH
+    0xA4, 0xA6, // resume RAM display, normal polarity
+    0xAF,       // display on
+};
+
+void sendNextSegment() {
+  if (g_dataPhase) {
+    g_dataPhase = false;
+    if (HAL_I2C_Master_Transmit_DMA(&hi2c1, kI2cAddress, g_data, g_dataLength) != HAL_OK) {
+      ++g_stats.transferErrors;
+      g_forceFull = true;
+      g_busy = false;
+    }
+    return;
+  }
+  uint8_t page;
+  uint8_t tile;
+  uint8_t count;
+  if (!nextRun(&page, &tile, &count)) {
+    g_busy = false;
+    return;
+  }
+  const uint8_t column = static_cast<uint8_t>(tile * 8U);
+  const uint8_t bytes = static_cast<uint8_t>(count * 8U);
+  g_command[0] = 0x00;
+  g_command[1] = 0x21;
+  g_command[2] = column;
+  g_command[3] = static_cast<uint8_t>(column + bytes - 1U);
+  g_command[4] = 0x22;
+  g_command[5] = page;
+  g_command[6] = page;
+  g_data[0] = 0x40;
+  memcpy(&g_data[1], &g_sent[page][column], bytes);
+  g_dataLength = static_cast<uint16_t>(1U + bytes);
+  g_stats.bytesSent += sizeof(g_command) + 1U + bytes;
+  g_dataPhase = true;
+  if (HAL_I2C_Master_Transmit_DMA(&hi2c1, kI2cAddress, g_command, sizeof(g_command)) != HAL_OK) {
+    ++g_stats.transferErrors;
+    g_forceFull = true;
+    g_busy = false;
+  }
+}
+
+void beginTransfer() {
+  sendNextSegment();
+}
+
+void initPanel() {
+  HAL_I2C_Master_Transmit(&hi2c1, kI2cAddress, const_cast<uint8_t *>(kInitSequence), sizeof(kInitSequence), 100);
+}
+
+}  // namespace
+
+extern "C" void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+  if (hi2c == &hi2c1 && g_busy) {
+    sendNextSegment();
+  }
+}
+
+extern "C" void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+  if (hi2c == &hi2c1) {
+    // Abandon the frame; the panel content is unknown, so the next one is sent in full.
+    ++g_stats.transferErrors;
+    g_forceFull = true;
+    g_busy = false;
+  }
+}
+
+void displayService() {}
+
+#elif defined(ENABLE_DISPLAY)
+
+// ---------------------------------------------------------------------------
+// U8g2 backend. Only the tile transport of U8g2 is used: dirty runs are copied
+// into its buffer and sent with updateDisplayArea(), one run (at most one
+// page) per displayService() call, which bounds the time loop() is blocked.
+// ---------------------------------------------------------------------------
+
 #include <U8g2lib.h>
 
-// Example: SSD1309 SPI constructor (user must adjust pins)
-// U8G2_SSD1309_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0);
+// Example: SSD1309 I2C constructor (user must adjust the constructor and pins).
+// A full-buffer (_F_) constructor is required.
+// U8G2_SSD1309_128X64_NONAME0_F_HW_I2C u8g2(U8G2_R0);
 U8G2 u8g2(U8G2_R0);
 
-void displayInit() {
-  // Initialize U8g2 (user must set correct constructor)
+namespace {
+
+void initPanel() {
   u8g2.begin();
 }
 
-void displayUpdateWaveform(const int16_t *samples, size_t n) {
-  if (!n) return;
-  u8g2.clearBuffer();
-  const int w = u8g2.getDisplayWidth();
-  const int h = u8g2.getDisplayHeight();
-  // draw waveform scaled to display
-  for (size_t i = 0; i < n - 1; ++i) {
-    int x1 = (i * w) / n;
-    int x2 = (((i + 1) * w) / n);
-    int y1 = h/2 - ((samples[i] * (h/2)) / 32768);
-    int y2 = h/2 - ((samples[i+1] * (h/2)) / 32768);
-    u8g2.drawLine(x1, y1, x2, y2);
+void beginTransfer() {}
+
+}  // namespace
+
+void displayService() {
+  if (!g_busy) {
+    return;
+  }
+  uint8_t page;
+  uint8_t tile;
+  uint8_t count;
+  if (!nextRun(&page, &tile, &count)) {
+    g_busy = false;
+    return;
   }
-  u8g2.sendBuffer();
+  const uint8_t column = static_cast<uint8_t>(tile * 8U);
+  memcpy(u8g2.getBufferPtr() + page * kDisplayWidth + column, &g_sent[page][column], count * 8U);
+  u8g2.updateDisplayArea(tile, page, count, 1);
+  g_stats.bytesSent += count * 8U;
 }
 
-// Very small FFT magnitude display (caller computes mag)
-void displayUpdateSpectrum(const float *mag, size_t n) {
-  if (!n) return;
-  u8g2.clearBuffer();
-  const int w = u8g2.getDisplayWidth();
-  const int h = u8g2.getDisplayHeight();
-  const size_t bins = n;
-  for (size_t i = 0; i < bins; ++i) {
-    int x = (i * w) / bins;
-    int hbar = (int)(mag[i] * (float)h);
-    if (hbar > h) hbar = h;
-    u8g2.drawVLine(x, h - hbar, 1);
+#else
+
+// ---------------------------------------------------------------------------
+// Host simulation: the transfer completes as soon as it starts.
+// ---------------------------------------------------------------------------
+
+namespace {
+
+void initPanel() {}
+
+void beginTransfer() {
+  uint8_t page;
+  uint8_t tile;
+  uint8_t count;
+  while (nextRun(&page, &tile, &count)) {
+    // Same bus cost as the DMA backend: window command + data.
+    g_stats.bytesSent += 7U + 1U + count * 8U;
   }
-  u8g2.sendBuffer();
+  g_busy = false;
+}
+
+}  // namespace
+
+void displayService() {}
+
+#endif
+
+void displayInit(uint32_t clockRate) {
+  g_frameInterval = clockRate / DISPLAY_FPS;
+  if (g_frameInterval == 0U) {
+    g_frameInterval = 1U;
+  }
+  g_started = false;
+  g_forceFull = true;
+  memset(g_sent, 0, sizeof(g_sent));
+  initPanel();
+}
+
+bool displayBeginFrame(uint32_t now) {
+  if (g_started && static_cast<int32_t>(now - g_nextFrame) < 0) {
+    return false;
+  }
+  if (g_busy) {
+    ++g_stats.busySkips;
+    return false;
+  }
+  // Keep the cadence, but do not try to catch up on frames that were skipped.
+  g_nextFrame = (g_started && static_cast<int32_t>(now - g_nextFrame) < static_cast<int32_t>(g_frameInterval))
+                    ? g_nextFrame + g_frameInterval
+                    : now + g_frameInterval;
+  g_started = true;
+  memset(g_frame, 0, sizeof(g_frame));
+  return true;
+}
+
+namespace {
+int sampleToRow(int16_t sample) {
+  const int mid = kWaveHeight / 2;
+  const int y = mid - ((static_cast<int32_t>(sample) * (mid + 1)) >> 15);
+  return (y < 0) ? 0 : ((y >= kWaveHeight) ? kWaveHeight - 1 : y);
+}
+}  // namespace
+
+void displayDrawWaveform(const int16_t *mins, const int16_t *maxs, size_t n) {
+  if (n == 0U) {
+    return;
+  }
+  int previousTop = -1;
+  int previousBottom = -1;
+  for (int x = 0; x < kDisplayWidth; ++x) {
+    const size_t i = (static_cast<size_t>(x) * n) / kDisplayWidth;
+    int top = sampleToRow(maxs[i]);
+    int bottom = sampleToRow(mins[i]);
+    // Join to the previous column so steep edges stay continuous.
+    if (previousTop >= 0) {
+      top = (previousBottom < top) ? previousBottom : top;
+      bottom = (previousTop > bottom) ? previousTop : bottom;
+    }
+    drawVSpan(x, top, bottom);
+    previousTop = sampleToRow(maxs[i]);
+    previousBottom = sampleToRow(mins[i]);
+  }
+}
+
+void displayDrawSpectrum(const float *bands, const float *peaks, size_t n) {
+  if (n == 0U || n > kSpectrumWidth) {
+    return;
+  }
+  const int pitch = kSpectrumWidth / static_cast<int>(n);
+  const int barWidth = (pitch > 1) ? pitch - 1 : 1;
+  const int bottom = kDisplayHeight - 1;
+  for (size_t band = 0; band < n; ++band) {
+    const int x0 = static_cast<int>(band) * pitch;
+    const int h = levelToHeight(bands[band], kLowerHeight);
+    for (int x = x0; x < x0 + barWidth; ++x) {
+      if (h > 0) {
+        drawVSpan(x, bottom - h + 1, bottom);
+      }
+      if (peaks != NULL) {
+        const int ph = levelToHeight(peaks[band], kLowerHeight);
+        if (ph > 0) {
+          setPixel(x, bottom - ph + 1);
+        }
+      }
+    }
+  }
+}
+
+void displayDrawParams(const uint16_t *values, size_t n, uint16_t fullScale) {
+  const int width = kDisplayWidth - kParamsLeft;
+  if (n == 0U || fullScale == 0U || n > static_cast<size_t>(width / 2)) {
+    return;
+  }
+  const int pitch = width / static_cast<int>(n);
+  const int barWidth = (pitch > 2) ? pitch - 2 : 1;
+  const int bottom = kDisplayHeight - 1;
+  for (size_t i = 0; i < n; ++i) {
+    const int x0 = kParamsLeft + static_cast<int>(i) * pitch;
+    const uint32_t value = (values[i] > fullScale) ? fullScale : values[i];
+    // Baseline plus a bar of 1..kLowerHeight-1 rows.
+    const int h = 1 + static_cast<int>((value * (kLowerHeight - 2U)) / fullScale);
+    for (int x = x0; x < x0 + barWidth; ++x) {
+      drawVSpan(x, bottom - h + 1, bottom);
+    }
+  }
+}
+
+void displayEndFrame() {
+  ++g_stats.frames;
+  bool any = false;
+  for (uint8_t page = 0; page < kDisplayPages; ++page) {
+    uint16_t mask = 0U;
+    for (uint8_t tile = 0; tile < kDisplayTilesPerPage; ++tile) {
+      uint8_t *sent = &g_sent[page][tile * 8U];
+      const uint8_t *drawn = &g_frame[page][tile * 8U];
+      if (g_forceFull || memcmp(sent, drawn, 8U) != 0) {
+        memcpy(sent, drawn, 8U);
+        mask = static_cast<uint16_t>(mask | (1U << tile));
+      }
+    }
+    g_pending[page] = mask;
+    any = any || mask != 0U;
+  }
+  g_forceFull = false;
+  g_pendingPage = 0U;
+  if (any) {
+    g_busy = true;
+    beginTransfer();
+  }
+}
+
+void displayGetStats(DisplayStats *stats) {
+  *stats = g_stats;
 }
 
 #else
 
-void displayInit() {
-  // stub
+void displayInit(uint32_t clockRate) {
+  (void)clockRate;
+}
+bool displayBeginFrame(uint32_t now) {
+  (void)now;
+  return false;
+}
+void displayDrawWaveform(const int16_t *mins, const int16_t *maxs, size_t n) {
+  (void)mins; (void)maxs; (void)n;
+}
+void displayDrawSpectrum(const float *bands, const float *peaks, size_t n) {
+  (void)bands; (void)peaks; (void)n;
 }
-void displayUpdateWaveform(const int16_t *samples, size_t n) {
-  (void)samples; (void)n;
+void displayDrawParams(const uint16_t *values, size_t n, uint16_t fullScale) {
+  (void)values; (void)n; (void)fullScale;
 }
-void displayUpdateSpectrum(const float *mag, size_t n) {
-  (void)mag; (void)n;
+void displayEndFrame() {}
+void displayService() {}
+void displayGetStats(DisplayStats *stats) {
+  memset(stats, 0, sizeof(*stats));
 }
 
 #endif
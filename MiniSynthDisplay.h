@@ -1,9 +1,93 @@
 #pragma once
 #include <Arduino.h>
 
-// Define ENABLE_DISPLAY to include display support (requires U8g2)
-// #define ENABLE_DISPLAY 1
+// Rate-limited 128x64 monochrome display with dirty-tile updates.
+//
+// The waveform (top half), spectrum (bottom left) and parameter bars (bottom
+// right) are composited into one page-ordered frame buffer (SSD1306 layout:
+// 8 pages of 128 column bytes). A frame is drawn at most DISPLAY_FPS times per
+// second of audio; it is then compared with the frame last sent, and only the
+// 8x8 tiles that changed are transferred, as one run per page.
+//
+// Usage (control context):
+//   if (displayBeginFrame(now)) { displayDraw...(); displayEndFrame(); }
+// and call displayService() from loop() to advance a polled transfer.
+//
+// Build switches:
+//  - ENABLE_DISPLAY                   : U8g2 (full-buffer SSD1306/SSD1309 constructor, adjust in the .cpp);
+//                                       displayService() sends one dirty run per call with updateDisplayArea().
+//  - ENABLE_DISPLAY + DISPLAY_I2C_DMA : SSD1306 over STM32 HAL I2C DMA (hi2c1 generated by CubeMX), without
+//                                       U8g2; runs are chained from the transfer-complete interrupt.
+//  - DISPLAY_HOST_SIM                 : host-side simulation: the transfer completes instantly (no hardware).
+// Without any of them, the functions below are no-op stubs and displayBeginFrame() returns false.
 
-void displayInit();
-void displayUpdateWaveform(const int16_t *samples, size_t n);
-void displayUpdateSpectrum(const float *mag, size_t n);
+// Frame-rate budget in frames per second of audio.
+#ifndef DISPLAY_FPS
+#define DISPLAY_FPS 20
+#endif
+
+// 7-bit I2C address of the controller (DISPLAY_I2C_DMA).
+#ifndef DISPLAY_I2C_ADDRESS
+#define DISPLAY_I2C_ADDRESS 0x3C
+#endif
+
+constexpr uint8_t kDisplayWidth = 128U;
+constexpr uint8_t kDisplayHeight = 64U;
+constexpr uint8_t kDisplayPages = kDisplayHeight / 8U;
+constexpr uint8_t kDisplayTilesPerPage = kDisplayWidth / 8U;
+
+/**
+ * @brief Display pipeline counters.
+ */
+struct DisplayStats {
+  uint32_t frames;         //!< Frames composed.
+  uint32_t busySkips;      //!< Due frames skipped because the previous transfer was still running.
+  uint32_t tilesSent;      //!< 8x8 tiles transferred.
+  uint32_t bytesSent;      //!< Bytes put on the bus (commands and data).
+  uint32_t transferErrors; //!< Aborted transfers (the next frame is then sent in full).
+};
+
+/**
+ * @brief Initialize the display and the frame-rate budget.
+ * @param clockRate Rate of the clock passed to displayBeginFrame() (e.g. kAudioRate for the sample clock).
+ */
+void displayInit(uint32_t clockRate);
+
+/**
+ * @brief Start a frame if one is due and the previous transfer has finished.
+ * @param now Current time in clockRate units (wraps).
+ * @return true if the caller should draw and call displayEndFrame(); the frame buffer is cleared.
+ */
+bool displayBeginFrame(uint32_t now);
+
+/**
+ * @brief Draw the waveform view (top half) from n min/max pairs, oldest..newest (one span per point).
+ */
+void displayDrawWaveform(const int16_t *mins, const int16_t *maxs, size_t n);
+
+/**
+ * @brief Draw the spectrum view (bottom left): band bars with peak markers (0..1 per band).
+ * @param peaks Peak-hold levels, or NULL.
+ */
+void displayDrawSpectrum(const float *bands, const float *peaks, size_t n);
+
+/**
+ * @brief Draw the parameter view (bottom right): one vertical bar per value.
+ * @param fullScale Value drawn as a full bar.
+ */
+void displayDrawParams(const uint16_t *values, size_t n, uint16_t fullScale);
+
+/**
+ * @brief Finish the frame: find the changed tiles and start transferring them.
+ */
+void displayEndFrame();
+
+/**
+ * @brief Advance a polled transfer (U8g2 backend); call from loop(). No-op otherwise.
+ */
+void displayService();
+
+/**
+ * @brief Copy the pipeline counters.
+ */
+void displayGetStats(DisplayStats *stats);
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Cortex-M4 の DSP 拡張（16bit x 2 のパック演算）のラッパー。
+// __ARM_FEATURE_DSP が定義されたターゲットでは CMSIS の組み込み関数（1 命令）を使い、
+// それ以外（ホストや Cortex-M3/M0）では同じ結果を返すスカラー実装を使います。
+// スカラー実装は命令の定義どおりにビット単位で一致させてあり、ホストで検証した結果が実機にもそのまま当てはまります。
+//
+// -DDSP_SIMD=0      : DSP 拡張のあるターゲットでもスカラー実装を使う（実機での比較用）
+// -DVOICE_PAIR_MIX=n : 発音中のボイスを 2 つずつ SMUAD でまとめて加算する（既定は DSP 拡張がある場合のみ 1。
+//                      スカラー実装では命令数が増えるため、ホスト等ではボイスごとのカーネルを使う）
+
+#ifndef DSP_SIMD
+#define DSP_SIMD 1
+#endif
+
+#if DSP_SIMD && defined(__ARM_FEATURE_DSP)
+#define MINI_SYNTH_DSP_SIMD 1
+#else
+#define MINI_SYNTH_DSP_SIMD 0
+#endif
+
+#ifndef VOICE_PAIR_MIX
+#define VOICE_PAIR_MIX MINI_SYNTH_DSP_SIMD
+#endif
+
+namespace mini_synth {
+
+/**
+ * @brief 2 つの 32bit 値の上位 16bit を 1 語に詰める（PKHTB a, b, ASR #16）。
+ * @param high 結果の上位ハーフワードになる値（上位 16bit を使う）。
+ * @param low 結果の下位ハーフワードになる値（上位 16bit を使う）。
+ * @return (high & 0xFFFF0000) | (low >> 16)。
+ */
+inline uint32_t packHigh16(const uint32_t high, const uint32_t low) {
+#if MINI_SYNTH_DSP_SIMD
+  return __PKHTB(high, low, 16);
+#else
+  return (high & 0xFFFF0000UL) | (low >> 16U);
+#endif
+}
+
+/**
+ * @brief 2 つの符号付き 16bit 値を 1 語に詰める（PKHBT low, high, LSL #16）。
+ * @param high 結果の上位ハーフワードになる値（下位 16bit を使う）。
+ * @param low 結果の下位ハーフワードになる値（下位 16bit を使う）。
+ * @return (high << 16) | (low & 0xFFFF)。
+ */
+inline uint32_t packLow16(const int32_t high, const int32_t low) {
+#if MINI_SYNTH_DSP_SIMD
+  return __PKHBT(static_cast<uint32_t>(low), static_cast<uint32_t>(high), 16);
+#else
+  return (static_cast<uint32_t>(high) << 16U) | (static_cast<uint32_t>(low) & 0xFFFFUL);
+#endif
+}
+
+/**
+ * @brief 符号付き 16bit の積を 2 組求めて足し合わせる（SMUAD）。
+ *
+ * 2 つの積がともに -32768 * -32768 の場合だけ 32bit を超えます（命令は Q フラグを立ててラップします）。
+ * @param x 16bit x 2 の値。
+ * @param y 16bit x 2 の係数。
+ * @return x.lo * y.lo + x.hi * y.hi。
+ */
+inline int32_t smuad(const uint32_t x, const uint32_t y) {
+#if MINI_SYNTH_DSP_SIMD
+  return static_cast<int32_t>(__SMUAD(x, y));
+#else
+  const int32_t lo = static_cast<int32_t>(static_cast<int16_t>(x)) * static_cast<int16_t>(y);
+  const int32_t hi = static_cast<int32_t>(static_cast<int16_t>(x >> 16U)) * static_cast<int16_t>(y >> 16U);
+  return static_cast<int32_t>(static_cast<uint32_t>(lo) + static_cast<uint32_t>(hi));
+#endif
+}
+
+/**
+ * @brief 符号付き 16bit の積和を 2 組まとめて累算する（SMLAD）。
+ *
+ * 累算は 32bit のラップアラウンド加算です（命令は Q フラグを立てるだけで飽和しません）。
+ * @param x 16bit x 2 の値。
+ * @param y 16bit x 2 の係数。
+ * @param acc 累算値。
+ * @return acc + x.lo * y.lo + x.hi * y.hi。
+ */
+inline int32_t smlad(const uint32_t x, const uint32_t y, const int32_t acc) {
+#if MINI_SYNTH_DSP_SIMD
+  return static_cast<int32_t>(__SMLAD(x, y, static_cast<uint32_t>(acc)));
+#else
+  const int32_t lo = static_cast<int32_t>(static_cast<int16_t>(x)) * static_cast<int16_t>(y);
+  const int32_t hi = static_cast<int32_t>(static_cast<int16_t>(x >> 16U)) * static_cast<int16_t>(y >> 16U);
+  return static_cast<int32_t>(static_cast<uint32_t>(acc) + static_cast<uint32_t>(lo) + static_cast<uint32_t>(hi));
+#endif
+}
+
+/**
+ * @brief 32bit 値を符号付き 16bit に飽和させる（SSAT #16）。
+ * @param value 飽和前の値。
+ * @return -32768..32767 に収めた値。
+ */
+inline int16_t saturate16(const int32_t value) {
+#if MINI_SYNTH_DSP_SIMD
+  return static_cast<int16_t>(__SSAT(value, 16));
+#else
+  return static_cast<int16_t>((value > 32767) ? 32767 : ((value < -32768) ? -32768 : value));
+#endif
+}
+
+/**
+ * @brief 2 つの符号付き 16bit 値を 1 語に詰める（smlad() の係数用）。
+ */
+constexpr uint32_t packInt16(const int16_t high, const int16_t low) {
+  return (static_cast<uint32_t>(static_cast<uint16_t>(high)) << 16U) | static_cast<uint16_t>(low);
+}
+
+}  // namespace mini_synth
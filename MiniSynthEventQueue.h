@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mini_synth {
+
+/**
+ * @brief 単一プロデューサ/単一コンシューマの wait-free リングバッファ。
+ *
+ * コントロール側（プロデューサ）が push() し、オーディオ側（コンシューマ）が peek()/pop() します。
+ * head はプロデューサのみ、tail はコンシューマのみが書き込み、acquire/release で受け渡すため
+ * 割り込み禁止やロックは不要です。
+ * @tparam T 要素型。
+ * @tparam N 容量（2 の冪）。
+ */
+template <typename T, size_t N>
+struct SpscQueue {
+  static_assert(N >= 2U && (N & (N - 1U)) == 0U, "SpscQueue capacity must be a power of two");
+
+  T buffer[N];       //!< 要素格納領域。
+  uint32_t head = 0U; //!< 次に書き込む位置（プロデューサのみ更新）。
+  uint32_t tail = 0U; //!< 次に読み出す位置（コンシューマのみ更新）。
+
+  /**
+   * @brief 要素を追加する（プロデューサ側）。
+   * @param item 追加する要素。
+   * @return 満杯で追加できなかった場合は false。
+   */
+  bool push(const T &item) {
+    const uint32_t h = head;
+    if (h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= N) {
+      return false;
+    }
+    buffer[h & (N - 1U)] = item;
+    __atomic_store_n(&head, h + 1U, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  /**
+   * @brief 先頭要素を参照する（コンシューマ側）。
+   * @return 先頭要素へのポインタ、空の場合は nullptr。
+   */
+  const T *peek() const {
+    const uint32_t t = tail;
+    if (__atomic_load_n(&head, __ATOMIC_ACQUIRE) == t) {
+      return nullptr;
+    }
+    return &buffer[t & (N - 1U)];
+  }
+
+  /**
+   * @brief peek() で参照した先頭要素を取り除く（コンシューマ側）。
+   */
+  void pop() {
+    __atomic_store_n(&tail, tail + 1U, __ATOMIC_RELEASE);
+  }
+};
+
+}  // namespace mini_synth
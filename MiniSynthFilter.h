@@ -0,0 +1,131 @@
+#pragma once
+
+#include "MiniSynthTypes.h"
+#include "MiniSynthNoteTable.h"
+
+namespace mini_synth {
+
+/**
+ * @brief 固定小数点 SVF の出力（サンプル単位）の上限値。
+ *
+ * 16bit 入力に対して約 24dB のヘッドルームを確保し、高レゾナンス時の発散を抑えます。
+ */
+constexpr int32_t kSvfStateLimit = (static_cast<int32_t>(1) << 19) - 1;
+
+/**
+ * @brief 固定小数点 SVF の状態に持たせる小数部のビット数。
+ *
+ * 状態をサンプル単位で持つと、カットオフが低いとき積分の増分（band * f）が切り捨てで 0 になり、
+ * 約 32768 / f LSB の不感帯が残ります（80Hz で 30 LSB 超）。小数部 6 bit でこれを 1 LSB 未満に抑えます。
+ */
+constexpr uint8_t kSvfStateFracBits = 6U;
+
+/**
+ * @brief 小数部を含めた状態の飽和上限（出力に換算すると kSvfStateLimit）。
+ */
+constexpr int32_t kSvfStateLimitFrac = ((kSvfStateLimit + 1) << kSvfStateFracBits) - 1;
+
+/**
+ * @brief Q15 係数の 1.0 に相当する値。
+ */
+constexpr int32_t kQ15One = static_cast<int32_t>(1) << 15;
+
+/**
+ * @brief SVF の状態値を ±kSvfStateLimitFrac に飽和させる。
+ * @param value 飽和前の値。
+ * @return 飽和後の値。
+ */
+inline int32_t svfSaturate(const int32_t value) {
+  if (value > kSvfStateLimitFrac) {
+    return kSvfStateLimitFrac;
+  }
+  if (value < -kSvfStateLimitFrac) {
+    return -kSvfStateLimitFrac;
+  }
+  return value;
+}
+
+/**
+ * @brief 値に Q15 係数を乗算する（32x32→64bit 積、Cortex-M では SMULL 1 命令）。
+ * @param value 乗算対象。
+ * @param coeff Q15 係数。
+ * @return value * coeff / 32768。
+ */
+inline int32_t mulQ15(const int32_t value, const int32_t coeff) {
+  return static_cast<int32_t>((static_cast<int64_t>(value) * coeff) >> 15);
+}
+
+/**
+ * @brief 固定小数点 Chamberlin SVF を 1 サンプル処理する。
+ * @param low ロー出力状態（サンプル単位の 2^kSvfStateFracBits 倍）。
+ * @param band バンド出力状態（サンプル単位の 2^kSvfStateFracBits 倍）。
+ * @param input 入力サンプル（-32768..32767）。
+ * @param f Q15 の正規化周波数係数（0..2.0 相当）。
+ * @param q Q15 のレゾナンス係数。
+ * @return ローパス出力（サンプル単位、±kSvfStateLimit）。
+ */
+inline int32_t processSvfQ15(int32_t &low, int32_t &band, const int32_t input, const int32_t f, const int32_t q) {
+  // hp = input - low - q * band
+  const int32_t hp = svfSaturate((input << kSvfStateFracBits) - low - mulQ15(band, q));
+  band = svfSaturate(band + mulQ15(hp, f));
+  low = svfSaturate(low + mulQ15(band, f));
+  return low >> kSvfStateFracBits;
+}
+
+/**
+ * @brief 浮動小数点 Chamberlin SVF を 1 サンプル処理する。
+ * @param low ロー出力状態。
+ * @param band バンド出力状態。
+ * @param input 入力サンプル（-32768..32767）。
+ * @param f 正規化周波数係数。
+ * @param q レゾナンス係数。
+ * @return ローパス出力。
+ */
+inline float processSvfFloat(float &low, float &band, const float input, const float f, const float q) {
+  // hp = input - low - q * band
+  const float hp = input - low - q * band;
+  band += f * hp;
+  low += f * band;
+  return low;
+}
+
+/**
+ * @brief ソフトクリップの入力上限（これを超える大きさは上限値として扱う）。
+ */
+constexpr int32_t kSoftClipInputLimit = (static_cast<int32_t>(1) << kSoftClipInputBits) - 1;
+
+/**
+ * @brief 固定小数点のソフトクリップ（x / (1 + |x|) 相当、32768 を 1.0 とみなす）。
+ *
+ * 除算を使わず、先頭ビット位置（CLZ）で選んだオクターブ区間のテーブルを線形補間します（誤差 2 LSB 以内）。
+ * @param value 入力（±kSoftClipInputLimit を超える値は飽和）。
+ * @return クリップ後の 16bit サンプル。
+ */
+inline int16_t softClipQ15(const int32_t value) {
+  uint32_t magnitude = (value < 0) ? (0U - static_cast<uint32_t>(value)) : static_cast<uint32_t>(value);
+  if (magnitude > static_cast<uint32_t>(kSoftClipInputLimit)) {
+    magnitude = kSoftClipInputLimit;
+  }
+  // 2^10 未満は 2^10..2^11 と同じ 32 刻みの区間で引く。
+  const uint32_t octave = 31U - static_cast<uint32_t>(__builtin_clz(magnitude | 1U));
+  const uint32_t top = (octave < 10U) ? 10U : octave;
+  const uint32_t shift = top - 5U;
+  const uint32_t index = (top - 10U) * kSoftClipSegmentPoints + (magnitude >> shift);
+  const int32_t frac = static_cast<int32_t>(magnitude & ((1UL << shift) - 1U));
+  const int32_t a = kSoftClipTable[index];
+  const int32_t b = kSoftClipTable[index + 1U];
+  const int32_t y = a + (((b - a) * frac) >> shift);
+  return static_cast<int16_t>((value < 0) ? -y : y);
+}
+
+/**
+ * @brief 浮動小数点入力のソフトクリップ（softClipQ15() と同じ曲線、32768 を 1.0 とみなす）。
+ * @param value 入力。
+ * @return クリップ後の 16bit サンプル。
+ */
+inline int16_t softClipFloat(const float value) {
+  const float limit = static_cast<float>(kSoftClipInputLimit);
+  return softClipQ15(static_cast<int32_t>(constrain(value, -limit, limit)));
+}
+
+}  // namespace mini_synth
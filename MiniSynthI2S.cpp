@@ -1,27 +1,121 @@
 #include "MiniSynthI2S.h"
 
-#ifndef USE_I2S
+#if !defined(USE_I2S) && !defined(I2S_HOST_SIM)
 
-// Stub implementation when I2S is not enabled. Always return false for pushes.
-void initI2SOutput(uint32_t sampleRate) {
+// Stub implementation when I2S is not enabled.
+void initI2SOutput(uint32_t sampleRate, I2sRenderCallback render) {
   (void)sampleRate;
-}
-
-bool i2sPushSample(int16_t sample) {
-  (void)sample;
-  return false;
+  (void)render;
 }
 
 void i2sStart(void) {}
 void i2sStop(void) {}
 
+bool i2sTakeFrameCredit(void) {
+  return false;
+}
+
+void i2sGetStats(struct I2sStats *stats) {
+  *stats = I2sStats();
+}
 
 #else
 
-// NUCLEO-F411RE HAL-based I2S + DMA template implementation.
-// This code assumes you generated I2S3 (SPI3 in I2S mode) and associated DMA
-// with CubeMX and that MX_I2S3_Init() and the I2S handle (hi2s3) exist.
-// You must integrate the generated initialization in your project (or adapt names below).
+// ---------------------------------------------------------------------------
+// Portable ping-pong core (shared by the HAL backend and the host simulation)
+// ---------------------------------------------------------------------------
+
+// Interleaved 16-bit L/R words per half-buffer and for the whole DMA buffer.
+static const size_t kI2sHalfWords = static_cast<size_t>(I2S_HALF_FRAMES) * 2U;
+static const size_t kI2sDmaWords = kI2sHalfWords * 2U;
+
+static int16_t g_i2sDmaBuf[kI2sDmaWords] __attribute__((aligned(4)));
+static I2sRenderCallback g_i2sRender = nullptr;
+static I2sStats g_i2sStats = {};
+// Half filled by the previous callback (0/1); 2 = nothing filled since start.
+static uint8_t g_i2sLastHalf = 2U;
+// Frame credits: produced only by the DMA ISR, consumed only by the control loop.
+static uint32_t g_i2sFramesProduced = 0U;
+static uint32_t g_i2sFramesConsumed = 0U;
+
+// Backend hook: index of the half the DMA controller is reading right now.
+static uint8_t i2sDmaReadingHalf();
+
+// Render one half-buffer in place.
+// The renderer writes mono frames into the upper half of the region, which is
+// then expanded forwards into L/R pairs (frame i reads slot F + i and writes
+// slots 2i and 2i + 1, which never overtakes an unread slot).
+static void i2sRenderHalf(const uint8_t half) {
+  int16_t *region = g_i2sDmaBuf + half * kI2sHalfWords;
+  int16_t *mono = region + I2S_HALF_FRAMES;
+  if (g_i2sRender != nullptr) {
+    g_i2sRender(mono, I2S_HALF_FRAMES);
+  } else {
+    for (size_t i = 0; i < I2S_HALF_FRAMES; ++i) {
+      mono[i] = 0;
+    }
+    ++g_i2sStats.silentFills;
+  }
+  for (size_t i = 0; i < I2S_HALF_FRAMES; ++i) {
+    const int16_t sample = mono[i];
+    region[2U * i] = sample;
+    region[2U * i + 1U] = sample;
+  }
+  __atomic_store_n(&g_i2sFramesProduced, g_i2sFramesProduced + I2S_HALF_FRAMES, __ATOMIC_RELEASE);
+  ++g_i2sStats.fills;
+}
+
+// DMA finished sending `half`; refill it while the other half plays.
+static void i2sOnHalfDone(const uint8_t half) {
+  // Halves must alternate. Seeing the same half twice means a callback was lost
+  // and the other half has been replayed with stale audio.
+  if (half == g_i2sLastHalf) {
+    ++g_i2sStats.missedCallbacks;
+  }
+  i2sRenderHalf(half);
+  // If the DMA has already wrapped around into the half we just wrote, part of
+  // it went out before the render finished.
+  if (i2sDmaReadingHalf() == half) {
+    ++g_i2sStats.lateFills;
+  }
+  g_i2sLastHalf = half;
+}
+
+static void i2sResetPipeline(const I2sRenderCallback render) {
+  g_i2sRender = render;
+  g_i2sStats = I2sStats();
+  g_i2sLastHalf = 2U;
+  g_i2sFramesProduced = 0U;
+  g_i2sFramesConsumed = 0U;
+}
+
+// Pre-fill both halves so the first DMA pass plays audio rather than garbage.
+static void i2sPrimeBuffers() {
+  i2sRenderHalf(0U);
+  i2sRenderHalf(1U);
+  g_i2sLastHalf = 1U;
+}
+
+bool i2sTakeFrameCredit(void) {
+  if (__atomic_load_n(&g_i2sFramesProduced, __ATOMIC_ACQUIRE) == g_i2sFramesConsumed) {
+    return false;
+  }
+  ++g_i2sFramesConsumed;
+  return true;
+}
+
+void i2sGetStats(struct I2sStats *stats) {
+  *stats = g_i2sStats;
+}
+
+#if defined(USE_I2S)
+
+// ---------------------------------------------------------------------------
+// NUCLEO-F411RE HAL backend.
+// This code assumes you generated I2S3 (SPI3 in I2S mode, 16-bit, Philips
+// standard) and its TX DMA stream in circular mode with CubeMX, and that
+// MX_I2S3_Init() has been called so the I2S handle (hi2s3) exists.
+// ---------------------------------------------------------------------------
 
 #include <Arduino.h>
 #include "stm32f4xx_hal.h"
@@ -30,64 +124,87 @@ void i2sStop(void) {}
 // Replace these with the actual handles/names from your CubeMX project if different.
 extern I2S_HandleTypeDef hi2s3; // provided by CubeMX: I2S3 handle
 
-static const int kI2sDmaBufSize = 1024; // stereo samples (interleaved) or mono depending setup
-static int16_t g_i2sDmaBuf[kI2sDmaBufSize];
-static volatile int g_i2sDmaWriteIndex = 0; // write index in samples
+static uint8_t i2sDmaReadingHalf() {
+  // NDTR counts the 16-bit words still to be sent in the current pass.
+  const uint32_t remaining = __HAL_DMA_GET_COUNTER(hi2s3.hdmatx);
+  return (remaining > kI2sHalfWords) ? 0U : 1U;
+}
 
-// Called to initialize I2S (user should also call MX_I2S3_Init())
-void initI2SOutput(uint32_t sampleRate) {
-  (void)sampleRate;
-  g_i2sDmaWriteIndex = 0;
-  // Ensure MX_I2S3_Init() is called from main setup (CubeMX generated). The project must
-  // setup DMA transfer for hi2s3 with circular mode and set callbacks HAL_I2S_TxCpltCallback
-  // and HAL_I2S_TxHalfCpltCallback to refill buffers.
-}
-
-// Push a mono sample into the DMA buffer (interleaving for stereo if needed)
-bool i2sPushSample(int16_t sample) {
-  int next = (g_i2sDmaWriteIndex + 1) % kI2sDmaBufSize;
-  int idx = g_i2sDmaWriteIndex;
-  // If buffer is about to overwrite the area being sent by DMA, drop sample
-  // (simple overflow protection). In circular DMA mode, ensure DMA buffer is large enough.
-  // This template does not implement a full producer/consumer; adapt as needed.
-  g_i2sDmaBuf[idx] = sample;
-  g_i2sDmaWriteIndex = next;
-  return true;
+void initI2SOutput(uint32_t sampleRate, I2sRenderCallback render) {
+  i2sResetPipeline(render);
+  // Re-initialize with the requested frame rate (the rest of the CubeMX setup is kept).
+  hi2s3.Init.AudioFreq = sampleRate;
+  HAL_I2S_Init(&hi2s3);
 }
 
 void i2sStart(void) {
-  // Start DMA in circular mode: transmit g_i2sDmaBuf with size kI2sDmaBufSize
-  // Example (uncomment after integrating CubeMX generated hi2s3 and HAL):
-  // HAL_I2S_Transmit_DMA(&hi2s3, (uint16_t*)g_i2sDmaBuf, kI2sDmaBufSize);
+  i2sPrimeBuffers();
+  HAL_I2S_Transmit_DMA(&hi2s3, reinterpret_cast<uint16_t *>(g_i2sDmaBuf), kI2sDmaWords);
 }
 
 void i2sStop(void) {
-  // HAL_I2S_DMAStop(&hi2s3);
+  HAL_I2S_DMAStop(&hi2s3);
 }
 
-// The following callbacks are called by HAL when DMA transfer reaches half or full.
-// Implementations here refill the DMA buffer from the internal ring buffer.
-// Make sure to enable these callbacks in your CubeMX/HAL configuration.
+// Called by HAL when the DMA reaches the middle / end of the circular buffer.
+// Make sure the DMA interrupt is enabled in your CubeMX configuration.
+extern "C" void HAL_I2S_TxHalfCpltCallback(I2S_HandleTypeDef *hi2s) {
+  if (hi2s == &hi2s3) {
+    i2sOnHalfDone(0U);
+  }
+}
 
-void HAL_I2S_TxHalfCpltCallback(I2S_HandleTypeDef *hi2s) {
-  (void)hi2s;
-  // refill first half
-  for (int i = 0; i < kI2sDmaBufSize / 2; ++i) {
-    // simple consumption from circular write index (not robust producer/consumer)
-    // Users should replace with proper synchronization if needed.
-    int idx = (i) % kI2sDmaBufSize;
-    g_i2sDmaBuf[idx] = 0; // silence by default
+extern "C" void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *hi2s) {
+  if (hi2s == &hi2s3) {
+    i2sOnHalfDone(1U);
   }
 }
 
-void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *hi2s) {
-  (void)hi2s;
-  // refill second half
-  for (int i = kI2sDmaBufSize / 2; i < kI2sDmaBufSize; ++i) {
-    int idx = i % kI2sDmaBufSize;
-    g_i2sDmaBuf[idx] = 0;
+#else
+
+// ---------------------------------------------------------------------------
+// Host simulation: models the DMA read position and the two interrupts.
+// ---------------------------------------------------------------------------
+
+static uint8_t g_i2sSimReadHalf = 0U;
+static bool g_i2sSimRunning = false;
+
+static uint8_t i2sDmaReadingHalf() {
+  return g_i2sSimReadHalf;
+}
+
+void initI2SOutput(uint32_t sampleRate, I2sRenderCallback render) {
+  (void)sampleRate;
+  i2sResetPipeline(render);
+}
+
+void i2sStart(void) {
+  i2sPrimeBuffers();
+  g_i2sSimReadHalf = 0U;
+  g_i2sSimRunning = true;
+}
+
+void i2sStop(void) {
+  g_i2sSimRunning = false;
+}
+
+// May also be called (with deliverCallback = false) from inside the renderer to
+// model a fill that overran its deadline.
+void i2sSimulateHalfTransfer(bool deliverCallback) {
+  if (!g_i2sSimRunning) {
+    return;
+  }
+  const uint8_t done = g_i2sSimReadHalf;
+  g_i2sSimReadHalf = done ^ 1U;
+  if (deliverCallback) {
+    i2sOnHalfDone(done);
   }
 }
 
+const int16_t *i2sSimulatedBuffer(void) {
+  return g_i2sDmaBuf;
+}
+
 #endif
 
+#endif
@@ -1,27 +1,55 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
-// Simple I2S output interface used by the synth. Default a stub is provided.
-// Implement platform-specific I2S/DMA code and replace the stub when enabling USE_I2S.
+// Double-buffered (ping-pong) I2S DMA output.
+//
+// The DMA buffer is split into two halves. When the DMA controller finishes
+// transmitting one half (half-complete / complete interrupt), the callback
+// renders the next block straight into that half while the other half plays.
+// There is no per-sample push: the synth renders whole blocks from the ISR.
+//
+// Build switches:
+//  - USE_I2S      : STM32 HAL backend (I2S3 + circular DMA generated by CubeMX).
+//  - I2S_HOST_SIM : host-side simulation of the DMA callbacks (no hardware).
+// Without either, the functions below are no-op stubs.
 
-#ifdef __cplusplus
-extern "C" {
+// Mono frames rendered per DMA half-buffer (each frame is sent as an L/R pair).
+#ifndef I2S_HALF_FRAMES
+#define I2S_HALF_FRAMES 128
 #endif
 
 /**
- * @brief Initialize I2S output at given sample rate (Hz).
+ * @brief Block renderer called from the DMA interrupt.
+ * @param out Destination for `frames` mono samples.
+ * @param frames Number of frames to render (I2S_HALF_FRAMES).
+ */
+typedef void (*I2sRenderCallback)(int16_t *out, size_t frames);
+
+/**
+ * @brief Health counters of the DMA pipeline.
  */
-void initI2SOutput(uint32_t sampleRate);
+struct I2sStats {
+  uint32_t fills;           //!< Half-buffers rendered.
+  uint32_t lateFills;       //!< Fills that finished after DMA had wrapped into the same half.
+  uint32_t missedCallbacks; //!< Callbacks lost or delivered out of order (a half was replayed).
+  uint32_t silentFills;     //!< Fills with no renderer attached (silence written).
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
- * @brief Push one signed 16-bit sample into the I2S output queue.
- * @return true if sample was queued, false if dropped (queue full or not enabled).
+ * @brief Initialize I2S output at given sample rate (Hz).
+ * @param sampleRate Output frame rate.
+ * @param render Renderer invoked for every half-buffer (may be NULL for silence).
  */
-bool i2sPushSample(int16_t sample);
+void initI2SOutput(uint32_t sampleRate, I2sRenderCallback render);
 
 /**
- * @brief Start I2S output (enable DMA etc.).
+ * @brief Pre-fill both halves and start circular DMA.
  */
 void i2sStart(void);
 
@@ -30,6 +58,33 @@ void i2sStart(void);
  */
 void i2sStop(void);
 
+/**
+ * @brief Consume one frame of output credit.
+ *
+ * Every rendered half-buffer grants I2S_HALF_FRAMES credits. The control loop
+ * takes one credit per audio frame so that its rate follows the I2S clock.
+ * @return true if a credit was available.
+ */
+bool i2sTakeFrameCredit(void);
+
+/**
+ * @brief Copy the current pipeline counters.
+ */
+void i2sGetStats(struct I2sStats *stats);
+
+#if defined(I2S_HOST_SIM)
+/**
+ * @brief Simulate the DMA controller finishing the half it is currently sending.
+ * @param deliverCallback false models an interrupt that was lost (e.g. masked too long).
+ */
+void i2sSimulateHalfTransfer(bool deliverCallback);
+
+/**
+ * @brief Access the simulated DMA buffer (interleaved L/R, 4 * I2S_HALF_FRAMES samples).
+ */
+const int16_t *i2sSimulatedBuffer(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,167 @@
+#include <Arduino.h>
+
+#include "MiniSynthKeys.h"
+
+#include "MiniSynthEventQueue.h"
+
+namespace mini_synth {
+namespace {
+/**
+ * @brief 既定のノート割り当て。
+ */
+#if KEY_MATRIX
+// 鍵番号順に KEY_BASE_NOTE から半音ずつ
+constexpr uint8_t defaultKeyNote(const uint8_t key) {
+  return static_cast<uint8_t>(KEY_BASE_NOTE + key);
+}
+#else
+// 従来の 5 鍵（C, E, G, A, D）
+constexpr uint8_t kDirectKeyNotes[kKeyCount] = {60, 64, 67, 69, 62};
+constexpr uint8_t defaultKeyNote(const uint8_t key) {
+  return kDirectKeyNotes[key];
+}
+#endif
+
+uint8_t g_keyNotes[kKeyCount];
+KeyDebouncer g_debouncer;
+// スキャナ（割り込み）→コントロール側のイベントキュー
+SpscQueue<KeyEvent, KEY_EVENT_QUEUE_SIZE> g_keyEvents;
+
+/**
+ * @brief 行を駆動する（行ピンがない直結構成では何もしない）。
+ */
+inline void driveRow(const uint8_t row, const bool active) {
+  if (kKeyRowPins[row] != kNoPin) {
+    digitalWrite(kKeyRowPins[row], active ? LOW : HIGH);
+  }
+}
+
+/**
+ * @brief 駆動中の行の列を読み、押下中の列のビットを返す（プルアップのため LOW = 押下）。
+ */
+inline uint32_t readColumns() {
+  uint32_t bits = 0U;
+  for (uint8_t col = 0; col < kKeyCols; ++col) {
+    if (digitalRead(kKeyColPins[col]) == LOW) {
+      bits |= static_cast<uint32_t>(1U) << col;
+    }
+  }
+  return bits;
+}
+
+void initKeyPins() {
+  for (uint8_t key = 0; key < kKeyCount; ++key) {
+    g_keyNotes[key] = defaultKeyNote(key);
+  }
+  for (uint8_t col = 0; col < kKeyCols; ++col) {
+    pinMode(kKeyColPins[col], INPUT_PULLUP);
+  }
+  for (uint8_t row = 0; row < kKeyRows; ++row) {
+    if (kKeyRowPins[row] != kNoPin) {
+      pinMode(kKeyRowPins[row], OUTPUT);
+      driveRow(row, false);
+    }
+  }
+}
+}  // namespace
+
+#if defined(USE_KEY_SCAN_TIMER)
+
+// ---------------------------------------------------------------------------
+// Timer-driven row strobing (STM32duino HardwareTimer).
+// Each interrupt reads the row driven by the previous interrupt (so the lines
+// settle for a whole period), releases it and drives the next one.
+// ---------------------------------------------------------------------------
+
+#ifndef KEY_SCAN_TIMER
+#define KEY_SCAN_TIMER TIM4
+#endif
+
+namespace {
+HardwareTimer g_keyTimer(KEY_SCAN_TIMER);
+uint8_t g_scanRow = 0U;
+uint32_t g_scanRaw = 0U;
+
+void keysScanTick() {
+  g_scanRaw |= readColumns() << (g_scanRow * kKeyCols);
+  driveRow(g_scanRow, false);
+  if (++g_scanRow >= kKeyRows) {
+    keysProcessScan(g_scanRaw);
+    g_scanRow = 0U;
+    g_scanRaw = 0U;
+  }
+  driveRow(g_scanRow, true);
+}
+}  // namespace
+
+void keysInit() {
+  initKeyPins();
+  driveRow(0U, true);
+  g_keyTimer.setOverflow(KEY_SCAN_ROW_HZ, HERTZ_FORMAT);
+  g_keyTimer.attachInterrupt(keysScanTick);
+  g_keyTimer.resume();
+}
+
+void keysUpdate() {}
+
+#else
+
+// ---------------------------------------------------------------------------
+// Polled scan from the control tick (also used on the host).
+// ---------------------------------------------------------------------------
+
+void keysInit() {
+  initKeyPins();
+}
+
+void keysUpdate() {
+  uint32_t raw = 0U;
+  for (uint8_t row = 0; row < kKeyRows; ++row) {
+    driveRow(row, true);
+    if (kKeyRowPins[row] != kNoPin) {
+      delayMicroseconds(KEY_SETTLE_US);
+    }
+    raw |= readColumns() << (row * kKeyCols);
+    driveRow(row, false);
+  }
+  keysProcessScan(raw);
+}
+
+#endif
+
+void keysProcessScan(const uint32_t raw) {
+  // 変化した鍵のビットだけを走査する。
+  for (uint32_t toggled = g_debouncer.update(raw); toggled != 0U; toggled &= toggled - 1U) {
+    KeyEvent event;
+    event.key = static_cast<uint8_t>(__builtin_ctz(toggled));
+    event.pressed = (g_debouncer.state & (toggled & (~toggled + 1U))) != 0U;
+    // 満杯なら破棄する（確定状態は keysPressedMask() で参照できる）。
+    g_keyEvents.push(event);
+  }
+}
+
+bool keysPollEvent(KeyEvent &event) {
+  const KeyEvent *next = g_keyEvents.peek();
+  if (next == nullptr) {
+    return false;
+  }
+  event = *next;
+  g_keyEvents.pop();
+  return true;
+}
+
+uint32_t keysPressedMask() {
+  return __atomic_load_n(&g_debouncer.state, __ATOMIC_RELAXED);
+}
+
+uint8_t keyNote(const uint8_t key) {
+  return (key < kKeyCount) ? g_keyNotes[key] : 0U;
+}
+
+void keySetNote(const uint8_t key, const uint8_t note) {
+  if (key < kKeyCount) {
+    g_keyNotes[key] = note & 0x7FU;
+  }
+}
+
+}  // namespace mini_synth
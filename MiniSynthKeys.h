@@ -0,0 +1,133 @@
+#pragma once
+
+#include "MiniSynthTypes.h"
+
+// 鍵盤マトリクスのスキャンとデバウンス。
+//
+// -DUSE_KEY_SCAN_TIMER=1 : ハードウェアタイマ割り込み（STM32duino の HardwareTimer）で 1 行ずつ
+//                          ストローブし、全行を読み終えるたびにデバウンスしてイベントを積む。
+// 未定義時               : keysUpdate()（コントロール周期）で全行をまとめてスキャンする。
+// 押下/離鍵はイベントとして取り出すため、コントロール側の処理量は鍵数ではなく変化数に比例します。
+
+// 行ストローブの周波数 [Hz]（USE_KEY_SCAN_TIMER 時。5 行なら 1 スキャン 5ms）
+#ifndef KEY_SCAN_ROW_HZ
+#define KEY_SCAN_ROW_HZ 1000
+#endif
+
+// 行を駆動してから列を読むまでの待ち時間 [us]（ポーリング時のみ。タイマ時は 1 周期あける）
+#ifndef KEY_SETTLE_US
+#define KEY_SETTLE_US 5
+#endif
+
+// 押下/離鍵を確定するのに必要な連続スキャン数（1..4）。スキャン間隔に合わせて、タイマスキャン
+// （5 行で 5ms/スキャン）では 4（20ms）、ポーリング（コントロール周期 15.6ms/スキャン）では 2 が既定
+#ifndef KEY_DEBOUNCE_SCANS
+#if defined(USE_KEY_SCAN_TIMER)
+#define KEY_DEBOUNCE_SCANS 4
+#else
+#define KEY_DEBOUNCE_SCANS 2
+#endif
+#endif
+
+// 鍵イベントキューの容量（2 の冪）
+#ifndef KEY_EVENT_QUEUE_SIZE
+#define KEY_EVENT_QUEUE_SIZE 32
+#endif
+
+// マトリクス時の最低音（鍵番号順に半音ずつ割り当てる）
+#ifndef KEY_BASE_NOTE
+#define KEY_BASE_NOTE 48
+#endif
+
+namespace mini_synth {
+
+/**
+ * @brief 押下/離鍵の確定に必要な連続スキャン数。
+ */
+constexpr uint8_t kKeyDebounceScans = KEY_DEBOUNCE_SCANS;
+static_assert(kKeyDebounceScans >= 1U && kKeyDebounceScans <= 4U, "KEY_DEBOUNCE_SCANS must be 1..4");
+
+/**
+ * @brief 鍵の押下/離鍵イベント。
+ */
+struct KeyEvent {
+  uint8_t key = 0U;     //!< 鍵番号（行 * kKeyCols + 列）。
+  bool pressed = false; //!< 押下なら true、離鍵なら false。
+};
+
+/**
+ * @brief 全鍵を 1 bit ずつ並べた縦型カウンタによるデバウンサ（ハードウェア非依存）。
+ *
+ * 2 枚のビットプレーンで鍵ごとに 2bit のカウンタを持ち、確定状態と異なるサンプルが
+ * kKeyDebounceScans 回続いたときだけ状態を反転させます。全鍵を数命令で同時に処理します。
+ */
+struct KeyDebouncer {
+  uint32_t state = 0U;  //!< 確定した押下状態（1 = 押下）。
+  uint32_t count0 = 0U; //!< カウンタの下位ビットプレーン。
+  uint32_t count1 = 0U; //!< カウンタの上位ビットプレーン。
+
+  /**
+   * @brief 1 スキャン分の生の押下状態を取り込む。
+   * @param raw 生の押下状態（1 = 押下、ビット位置 = 鍵番号）。
+   * @return このスキャンで状態が反転した鍵のマスク。
+   */
+  uint32_t update(const uint32_t raw) {
+    constexpr uint8_t kLast = kKeyDebounceScans - 1U;
+    const uint32_t delta = raw ^ state;
+    // これまでに kLast 回続けて異なっていた鍵は、このサンプルで規定回数に達するので反転する。
+    const uint32_t toggled = delta & ((kLast & 1U) ? count0 : ~count0) & ((kLast & 2U) ? count1 : ~count1);
+    // 状態と異なる鍵だけカウントを進め、一致した鍵と反転した鍵はカウンタを 0 に戻す。
+    count1 = (count1 ^ count0) & delta & ~toggled;
+    count0 = ~count0 & delta & ~toggled;
+    state ^= toggled;
+    return toggled;
+  }
+};
+
+/**
+ * @brief 鍵盤のピンを初期化し、スキャンを開始する（USE_KEY_SCAN_TIMER 時はタイマを開始）。
+ */
+void keysInit();
+
+/**
+ * @brief ポーリング時に全行をスキャンする（コントロール側。タイマスキャン時は何もしない）。
+ */
+void keysUpdate();
+
+/**
+ * @brief 1 スキャン分の生の押下状態をデバウンスし、変化した鍵のイベントを積む。
+ *
+ * スキャナ（タイマ割り込みまたは keysUpdate()）から呼ばれます。ホストでは任意の
+ * 押下パターンを与えてマトリクスを模擬できます。
+ * @param raw 生の押下状態（1 = 押下、ビット位置 = 鍵番号）。
+ */
+void keysProcessScan(uint32_t raw);
+
+/**
+ * @brief 鍵イベントを 1 つ取り出す（コントロール側）。
+ * @param event 取り出したイベントの格納先。
+ * @return イベントがあれば true。
+ */
+bool keysPollEvent(KeyEvent &event);
+
+/**
+ * @brief 確定済みの押下状態を取得する。
+ * @return 押下中の鍵のマスク。
+ */
+uint32_t keysPressedMask();
+
+/**
+ * @brief 鍵に割り当てた MIDI ノート番号を取得する。
+ * @param key 鍵番号。
+ * @return ノート番号。
+ */
+uint8_t keyNote(uint8_t key);
+
+/**
+ * @brief 鍵に割り当てる MIDI ノート番号を変更する。
+ * @param key 鍵番号。
+ * @param note ノート番号。
+ */
+void keySetNote(uint8_t key, uint8_t note);
+
+}  // namespace mini_synth
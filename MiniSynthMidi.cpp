@@ -3,6 +3,8 @@
 
 #include "MiniSynthMidi.h"
 
+#include "MiniSynthNoteTable.h"
+
 #include "MiniSynthMozziConfig.h"
 
 namespace mini_synth {
@@ -10,51 +12,200 @@ namespace mini_synth {
 void noteOn(SynthState &state, const uint8_t channel, const uint8_t note, const uint8_t velocity) {
   (void)channel;
   // 空きボイスを割り当てて初期化。
-  Voice *voice = allocateVoice(state);
-  if (voice != nullptr) {
-    initVoice(state, *voice, note, velocity);
+  const uint8_t index = allocateVoice(state);
+  if (index != kNoVoice) {
+    initVoice(state, index, note, velocity);
   }
 }
 
 void noteOff(SynthState &state, const uint8_t channel, const uint8_t note) {
   (void)channel;
   // 対応するボイスを探索し、リリースを開始。
-  Voice *voice = findVoiceByNote(state, note);
-  if (voice != nullptr) {
-    releaseVoice(*voice);
+  const uint8_t index = findVoiceByNote(state, note);
+  if (index != kNoVoice) {
+    releaseVoice(state.voices, index);
   }
 }
 
-void handleMidiByte(SynthState &state, const uint8_t data) {
-  // ステータスバイトの場合はバッファをリセット。
+void controlChange(SynthState &state, const uint8_t channel, const uint8_t controller, const uint8_t value) {
+  (void)channel;
+  switch (controller) {
+    case kMidiCcVolume: {
+      // GM の推奨カーブ（40 log10(v/127) dB = (v/127)^2）を整数で求め、オーディオ側でランプさせる。
+      VoiceEvent event;
+      event.type = VoiceEventType::kParam;
+      event.voice = static_cast<uint8_t>(SynthParam::kVolume);
+      event.value = (static_cast<uint32_t>(value) * value * 32768U) / (127U * 127U);
+      state.volume = static_cast<uint16_t>(event.value);
+      postEvent(state, event);
+      break;
+    }
+    case kMidiCcDecayTime:
+      // 値が大きいほど長いディケイ（8..128 コントロール周期）。
+      state.envelope.decayRate = static_cast<uint32_t>(map(value, 0, 127, 8192, 512));
+      break;
+    case kMidiCcSustainLevel:
+      state.envelope.sustainLevel = static_cast<int16_t>((static_cast<int32_t>(value) * 32767) / 127);
+      break;
+    case kMidiCcUnisonSpread: {
+      // 小さい値ほど細かく調整できるよう 2 乗カーブで Q15 へ（0 でユニゾン解除）。
+      VoiceEvent event;
+      event.type = VoiceEventType::kParam;
+      event.voice = static_cast<uint8_t>(SynthParam::kUnisonSpread);
+      event.value = (static_cast<uint32_t>(value) * value * 32767U) / (127U * 127U);
+      state.unisonSpread = static_cast<uint16_t>(event.value);
+      postEvent(state, event);
+      break;
+    }
+    case kMidiCcPatchStore:
+      // フラッシュへの書き込みはコントロール側（handleControl()）でまとめて行う。
+      if (value >= 64U) {
+        state.storeRequested = true;
+      }
+      break;
+    case kMidiCcAllSoundOff:
+      // リリースを待たずに即座に無音にする。
+      stopAllVoices(state);
+      break;
+    case kMidiCcAllNotesOff:
+      releaseAllVoices(state);
+      break;
+    case kMidiCcResetControllers:
+      setPitchBend(state, 0);
+      state.pressure = 0U;
+      break;
+    default:
+      // その他のコントローラは未使用。
+      break;
+  }
+}
+
+namespace {
+/**
+ * @brief ステータスバイトに続くデータバイト数を返す。
+ */
+uint8_t midiDataLength(const uint8_t status) {
+  switch (status & 0xF0U) {
+    case 0xC0U:
+    case 0xD0U:
+      return 1U;
+    case 0xF0U:
+      // システムコモン: タイムコード/ソングセレクトは 1、ソングポジションは 2、その他は 0。
+      return (status == 0xF2U) ? 2U : ((status == 0xF1U || status == 0xF3U) ? 1U : 0U);
+    default:
+      return 2U;
+  }
+}
+}  // namespace
+
+bool parseMidiByte(MidiParser &parser, const uint8_t data, MidiEvent &event) {
+  if (data >= 0xF8U) {
+    // リアルタイムメッセージは解析中のメッセージに割り込める（0xF9/0xFD は未定義のため捨てる）。
+    if (data == 0xF9U || data == 0xFDU) {
+      return false;
+    }
+    event.type = static_cast<MidiMessage>(data);
+    event.channel = 0U;
+    event.data1 = 0U;
+    event.data2 = 0U;
+    return true;
+  }
   if ((data & 0x80U) != 0U) {
-    state.midi.buffer[0] = data;
-    state.midi.index = 1U;
-    return;
-  }
-  if (state.midi.index == 0U) {
-    // ステータスが未受信の場合は無視。
-    return;
-  }
-  // データバイトをバッファへ追加。
-  state.midi.buffer[state.midi.index++] = data;
-  const uint8_t status = state.midi.buffer[0] & 0xF0U;
-  const uint8_t channel = state.midi.buffer[0] & 0x0FU;
-  if (status == static_cast<uint8_t>(MidiMessage::kNoteOn) && state.midi.index >= 3U) {
-    if (state.midi.buffer[2] == 0U) {
-      noteOff(state, channel, state.midi.buffer[1]);
-    } else {
-      noteOn(state, channel, state.midi.buffer[1], state.midi.buffer[2]);
+    // ステータスバイトは SysEx を終わらせ、受信途中のメッセージを捨てる。
+    parser.inSysEx = (data == static_cast<uint8_t>(MidiMessage::kSysExStart));
+    parser.index = 0U;
+    parser.expected = midiDataLength(data);
+    if (data < 0xF0U || parser.expected != 0U) {
+      parser.status = data;
+      return false;
+    }
+    // データを持たないシステムコモン（チューンリクエスト等）はランニングステータスを解除する。
+    parser.status = 0U;
+    if (data == static_cast<uint8_t>(MidiMessage::kTuneRequest)) {
+      event.type = MidiMessage::kTuneRequest;
+      event.channel = 0U;
+      event.data1 = 0U;
+      event.data2 = 0U;
+      return true;
     }
-    state.midi.index = 1U;
-  } else if (status == static_cast<uint8_t>(MidiMessage::kNoteOff) && state.midi.index >= 3U) {
-    noteOff(state, channel, state.midi.buffer[1]);
-    state.midi.index = 1U;
-  } else if (status == static_cast<uint8_t>(MidiMessage::kControlChange) && state.midi.index >= 3U) {
-    // 今回はコントロールチェンジを利用しないため読み飛ばす。
-    state.midi.index = 1U;
+    return false;
   }
+  if (parser.inSysEx) {
+    ++parser.sysExBytes;
+    return false;
+  }
+  if (parser.status == 0U) {
+    // ステータスが未受信（またはランニングステータス解除後）のデータは捨てる。
+    return false;
+  }
+  parser.data[parser.index++] = data;
+  if (parser.index < parser.expected) {
+    return false;
+  }
+  const uint8_t status = parser.status;
+  parser.index = 0U;
+  event.data1 = parser.data[0];
+  event.data2 = (parser.expected == 2U) ? parser.data[1] : 0U;
+  if (status >= 0xF0U) {
+    // システムコモンはランニングステータスの対象外。
+    parser.status = 0U;
+    event.type = static_cast<MidiMessage>(status);
+    event.channel = 0U;
+    return true;
+  }
+  event.type = static_cast<MidiMessage>(status & 0xF0U);
+  event.channel = status & 0x0FU;
+  if (event.type == MidiMessage::kNoteOn && event.data2 == 0U) {
+    event.type = MidiMessage::kNoteOff;
+  }
+  return true;
 }
 
-}  // namespace mini_synth
+void handleMidiEvent(SynthState &state, const MidiEvent &event) {
+  switch (event.type) {
+    case MidiMessage::kNoteOn:
+      noteOn(state, event.channel, event.data1, event.data2);
+      break;
+    case MidiMessage::kNoteOff:
+      noteOff(state, event.channel, event.data1);
+      break;
+    case MidiMessage::kControlChange:
+      controlChange(state, event.channel, event.data1, event.data2);
+      break;
+    case MidiMessage::kPitchBend: {
+      // 14bit（中央 8192）を ±kPitchBendRange 半音のファインチューン単位へ。
+      const int32_t bend = static_cast<int32_t>(event.value14()) - 8192;
+      setPitchBend(state, static_cast<int16_t>((bend * kPitchBendRange * kFineTuneSteps) / 8192));
+      break;
+    }
+    case MidiMessage::kChannelPressure:
+      state.pressure = event.data1;
+      break;
+    case MidiMessage::kPolyPressure:
+      // フィルタは全ボイス共通のため、ノートごとの圧力も同じ値として扱う。
+      state.pressure = event.data2;
+      break;
+    case MidiMessage::kProgramChange:
+      // パッチの呼び出しはコントロール側（handleControl()）で 1 ティック内に行う。
+      state.program = event.data1;
+      state.recallRequested = true;
+      break;
+    case MidiMessage::kSystemReset:
+      releaseAllVoices(state);
+      setPitchBend(state, 0);
+      state.pressure = 0U;
+      break;
+    default:
+      // クロック/トランスポート/アクティブセンシング/システムコモンは未使用。
+      break;
+  }
+}
 
+void handleMidiByte(SynthState &state, const uint8_t data) {
+  MidiEvent event;
+  if (parseMidiByte(state.midi, data, event)) {
+    handleMidiEvent(state, event);
+  }
+}
+
+}  // namespace mini_synth
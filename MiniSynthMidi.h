@@ -22,6 +22,37 @@ void noteOn(SynthState &state, uint8_t channel, uint8_t note, uint8_t velocity);
  */
 void noteOff(SynthState &state, uint8_t channel, uint8_t note);
 
+/**
+ * @brief コントロールチェンジを処理する（ボリューム/ディケイタイム/サステインレベル/ユニゾン幅/パッチ保存/チャンネルモード）。
+ * @param state シンセ状態。
+ * @param channel 受信チャンネル。
+ * @param controller コントローラ番号。
+ * @param value 値（0..127）。
+ */
+void controlChange(SynthState &state, uint8_t channel, uint8_t controller, uint8_t value);
+
+/**
+ * @brief MIDI 1.0 のバイト列を 1 バイトずつ解析する（ハードウェア非依存）。
+ *
+ * ランニングステータスに対応し、リアルタイムメッセージ（0xF8..0xFF）はメッセージの途中でも
+ * 解析状態を変えずにそのまま返します。SysEx は終端（または次のステータス）まで読み飛ばし、
+ * システムコモンメッセージはランニングステータスを解除します。
+ * @param parser パーサ状態。
+ * @param data 受信したバイト。
+ * @param event メッセージが完成したときの格納先（time は呼び出し側で設定する）。
+ * @return メッセージが完成した場合は true。
+ */
+bool parseMidiByte(MidiParser &parser, uint8_t data, MidiEvent &event);
+
+/**
+ * @brief 解析済みの MIDI メッセージを処理する。
+ *
+ * 投入するボイスイベントには state.eventTime が付きます。
+ * @param state シンセ状態。
+ * @param event MIDI メッセージ。
+ */
+void handleMidiEvent(SynthState &state, const MidiEvent &event);
+
 /**
  * @brief MIDI バイト列を解析して処理する。
  * @param state シンセ状態。
@@ -0,0 +1,131 @@
+#include <Arduino.h>
+
+#include "MiniSynthMidiIn.h"
+
+#include "MiniSynthEventQueue.h"
+
+namespace mini_synth {
+namespace {
+// 受信割り込み（またはポーリング）→コントロール側のバイトキュー
+SpscQueue<MidiRxByte, MIDI_RX_BUFFER_SIZE> g_rxRing;
+MidiClock g_clock = nullptr;
+// 統計はプロデューサ側だけが更新する
+MidiInStats g_stats;
+
+uint32_t receiveTime() {
+  return (g_clock != nullptr) ? g_clock() : 0U;
+}
+}  // namespace
+
+bool midiInReceive(const uint8_t data, const uint32_t time) {
+  MidiRxByte item;
+  item.time = time;
+  item.data = data;
+  if (!g_rxRing.push(item)) {
+    ++g_stats.ringOverruns;
+    return false;
+  }
+  ++g_stats.bytes;
+  const uint32_t fill = g_rxRing.head - __atomic_load_n(&g_rxRing.tail, __ATOMIC_RELAXED);
+  if (fill > g_stats.maxFill) {
+    g_stats.maxFill = static_cast<uint16_t>(fill);
+  }
+  return true;
+}
+
+bool midiInRead(MidiRxByte &out) {
+  const MidiRxByte *next = g_rxRing.peek();
+  if (next == nullptr) {
+    return false;
+  }
+  out = *next;
+  g_rxRing.pop();
+  return true;
+}
+
+void midiInGetStats(MidiInStats *stats) {
+  *stats = g_stats;
+}
+
+void midiInReset() {
+  g_rxRing.head = 0U;
+  g_rxRing.tail = 0U;
+  g_stats = MidiInStats();
+}
+
+}  // namespace mini_synth
+
+#if defined(USE_MIDI_UART_IRQ)
+
+// ---------------------------------------------------------------------------
+// NUCLEO-F411RE USART1 receive interrupt.
+// This code assumes USART1 was generated with CubeMX at 31250 baud, 8N1, RX
+// enabled, that MX_USART1_UART_Init() has been called so the handle (huart1)
+// exists, and that the core's HardwareSerial does not own USART1 (so this file
+// can provide USART1_IRQHandler). Each byte is timestamped in the ISR, which
+// keeps the UART from overrunning no matter how late the control tick runs.
+// ---------------------------------------------------------------------------
+
+#include "stm32f4xx_hal.h"
+
+extern UART_HandleTypeDef huart1; // provided by CubeMX: USART1 handle
+
+#ifndef MIDI_UART_IRQ_PRIORITY
+#define MIDI_UART_IRQ_PRIORITY 1
+#endif
+
+extern "C" void USART1_IRQHandler(void) {
+  // Reading SR then DR clears RXNE and ORE; a byte lost to an overrun is counted.
+  const uint32_t sr = USART1->SR;
+  if ((sr & (USART_SR_RXNE | USART_SR_ORE)) != 0U) {
+    const uint8_t data = static_cast<uint8_t>(USART1->DR);
+    if ((sr & USART_SR_ORE) != 0U) {
+      ++mini_synth::g_stats.uartOverruns;
+    }
+    mini_synth::midiInReceive(data, mini_synth::receiveTime());
+  }
+}
+
+namespace mini_synth {
+
+void midiInInit(const MidiClock clock) {
+  g_clock = clock;
+  HAL_NVIC_SetPriority(USART1_IRQn, MIDI_UART_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(USART1_IRQn);
+  __HAL_UART_ENABLE_IT(&huart1, UART_IT_RXNE);
+}
+
+uint32_t midiInPoll() {
+  return 0U;
+}
+
+}  // namespace mini_synth
+
+#else
+
+// ---------------------------------------------------------------------------
+// Polled fallback (HardwareSerial FIFO) used without USE_MIDI_UART_IRQ and on
+// the host. Bytes are timestamped when they are moved into the ring.
+// ---------------------------------------------------------------------------
+
+namespace mini_synth {
+
+void midiInInit(const MidiClock clock) {
+  g_clock = clock;
+  midiSerial().begin(31250);
+}
+
+uint32_t midiInPoll() {
+  uint32_t moved = 0U;
+  const uint32_t time = receiveTime();
+  // リングの空きがある分だけ移し、残りは FIFO に残す。
+  while (g_rxRing.head - g_rxRing.tail < MIDI_RX_BUFFER_SIZE && midiSerial().available() > 0) {
+    midiInReceive(static_cast<uint8_t>(midiSerial().read()), time);
+    ++moved;
+  }
+  return moved;
+}
+
+}  // namespace mini_synth
+
+#endif
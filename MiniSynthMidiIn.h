@@ -0,0 +1,83 @@
+#pragma once
+
+#include "MiniSynthTypes.h"
+
+// MIDI 受信バイトのリングバッファ。
+//
+// -DUSE_MIDI_UART_IRQ=1 : USART1 の受信割り込みで 1 バイトずつ時刻付きでリングへ積む
+//                         （CubeMX の huart1 が必要。HardwareSerial には USART1 を使わせない）。
+// 未定義時              : midiInPoll() が HardwareSerial の受信 FIFO からリングへ移す（ホストビルドもこちら）。
+//                         loop() から頻繁に呼ぶことで、時刻の分解能と UART のオーバーランを改善します。
+// どちらの場合もコントロール周期では midiInRead() でリングを読み出すだけです。
+
+// 受信リングの容量（2 の冪）。31250bps は約 49 バイト/コントロール周期なので数周期分の余裕を持たせる。
+#ifndef MIDI_RX_BUFFER_SIZE
+#define MIDI_RX_BUFFER_SIZE 256
+#endif
+
+namespace mini_synth {
+
+/**
+ * @brief 受信時刻付きの MIDI バイト。
+ */
+struct MidiRxByte {
+  uint32_t time = 0U; //!< 受信時のサンプル時刻（midiInInit() で渡したクロック基準）。
+  uint8_t data = 0U;  //!< 受信バイト。
+};
+
+/**
+ * @brief 受信統計。
+ */
+struct MidiInStats {
+  uint32_t bytes = 0U;         //!< リングへ積んだバイト数。
+  uint32_t ringOverruns = 0U;  //!< リング満杯で捨てたバイト数。
+  uint32_t uartOverruns = 0U;  //!< UART のオーバーラン検出回数（割り込み版のみ）。
+  uint16_t maxFill = 0U;       //!< リングの最大使用量 [バイト]。
+};
+
+/**
+ * @brief 受信時刻を返すクロック（割り込みから呼ばれる）。
+ */
+using MidiClock = uint32_t (*)();
+
+/**
+ * @brief MIDI 入力（31250bps）を初期化し、受信を開始する。
+ * @param clock 受信時刻のクロック（通常は audioSampleClock() を返す関数）。
+ */
+void midiInInit(MidiClock clock);
+
+/**
+ * @brief HardwareSerial の受信 FIFO をリングへ移す（ポーリング版。割り込み版では何もしない）。
+ *
+ * リングが満杯のときは FIFO に残したまま戻ります。
+ * @return リングへ移したバイト数。
+ */
+uint32_t midiInPoll();
+
+/**
+ * @brief 1 バイトを時刻付きでリングへ積む（プロデューサ側: 受信割り込みまたは midiInPoll()）。
+ * @param data 受信バイト。
+ * @param time 受信時刻。
+ * @return リング満杯で捨てた場合は false。
+ */
+bool midiInReceive(uint8_t data, uint32_t time);
+
+/**
+ * @brief リングから 1 バイト取り出す（コンシューマ側: コントロール周期）。
+ * @param out 取り出したバイトの格納先。
+ * @return バイトがあれば true。
+ */
+bool midiInRead(MidiRxByte &out);
+
+/**
+ * @brief 受信統計を取得する。
+ * @param stats 格納先。
+ */
+void midiInGetStats(MidiInStats *stats);
+
+/**
+ * @brief リングと受信統計をクリアする（受信停止中に呼ぶ）。
+ */
+void midiInReset();
+
+}  // namespace mini_synth
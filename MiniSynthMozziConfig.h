@@ -2,8 +2,24 @@
 
 #include <MozziConfigValues.h>
 
+// The sample rate is configured once with AUDIO_RATE (MiniSynthTypes.h); do not set
+// MOZZI_AUDIO_RATE directly. mini_synth.ino checks that both agree.
+#include "MiniSynthTypes.h"
+
+// With I2S the DMA interrupt renders audio itself; Mozzi only paces the control
+// loop through canBufferAudioOutput()/audioOutput() defined in mini_synth.ino.
+#if defined(USE_I2S)
+#define MOZZI_AUDIO_MODE MOZZI_OUTPUT_EXTERNAL_CUSTOM
+#endif
+
 #ifndef MOZZI_AUDIO_RATE
-#define MOZZI_AUDIO_RATE 16384
+#define MOZZI_AUDIO_RATE AUDIO_RATE
+#endif
+
+// Mozzi's own timer output only runs at power-of-two rates; 48 kHz needs the I2S backend
+// (or its host simulation), where Mozzi only paces the control ticks.
+#if (AUDIO_RATE & (AUDIO_RATE - 1)) != 0 && !defined(USE_I2S) && !defined(I2S_HOST_SIM)
+#error "AUDIO_RATE=48000 requires USE_I2S (Mozzi's built-in outputs support 16384 and 32768 only)"
 #endif
 
 #ifndef MOZZI_CONTROL_RATE
@@ -1,133 +1,337 @@
 #pragma once
 
-// Generated note->f table (MIDI 0..127)
-static const float kNoteFTable[128] = {
-    0.03067778f, // 0
-    0.03096791f, // 1
-    0.03126130f, // 2
-    0.03155797f, // 3
-    0.03185791f, // 4
-    0.03216113f, // 5
-    0.03246762f, // 6
-    0.03277740f, // 7
-    0.03309045f, // 8
-    0.03340679f, // 9
-    0.03372641f, // 10
-    0.03404932f, // 11
-    0.03437552f, // 12
-    0.03470501f, // 13
-    0.03503779f, // 14
-    0.03537386f, // 15
-    0.03571323f, // 16
-    0.03605589f, // 17
-    0.03640185f, // 18
-    0.03675111f, // 19
-    0.03710366f, // 20
-    0.03745951f, // 21
-    0.03781866f, // 22
-    0.03818111f, // 23
-    0.03854686f, // 24
-    0.03891590f, // 25
-    0.03928825f, // 26
-    0.03966390f, // 27
-    0.04004286f, // 28
-    0.04042513f, // 29
-    0.04081071f, // 30
-    0.04119960f, // 31
-    0.04159180f, // 32
-    0.04198732f, // 33
-    0.04238615f, // 34
-    0.04278830f, // 35
-    0.04319376f, // 36
-    0.04360254f, // 37
-    0.04401464f, // 38
-    0.04443006f, // 39
-    0.04484881f, // 40
-    0.04527089f, // 41
-    0.04569630f, // 42
-    0.04612505f, // 43
-    0.04655714f, // 44
-    0.04699258f, // 45
-    0.04743136f, // 46
-    0.04787349f, // 47
-    0.04831900f, // 48
-    0.04876785f, // 49
-    0.04922008f, // 50
-    0.04967567f, // 51
-    0.05013464f, // 52
-    0.05059700f, // 53
-    0.05106274f, // 54
-    0.05153189f, // 55
-    0.05200443f, // 56
-    0.05248039f, // 57
-    0.05295975f, // 58
-    0.05344254f, // 59
-    0.05392875f, // 60
-    0.05441839f, // 61
-    0.05491147f, // 62
-    0.05540800f, // 63
-    0.05590800f, // 64
-    0.05641147f, // 65
-    0.05691843f, // 66
-    0.05742888f, // 67
-    0.05794284f, // 68
-    0.05846031f, // 69
-    0.05898130f, // 70
-    0.05950583f, // 71
-    0.06003389f, // 72
-    0.06056550f, // 73
-    0.06110069f, // 74
-    0.06163944f, // 75
-    0.06218178f, // 76
-    0.06272772f, // 77
-    0.06327727f, // 78
-    0.06383044f, // 79
-    0.06438726f, // 80
-    0.06494771f, // 81
-    0.06551182f, // 82
-    0.06607960f, // 83
-    0.06665107f, // 84
-    0.06722622f, // 85
-    0.06780508f, // 86
-    0.06838765f, // 87
-    0.06897396f, // 88
-    0.06956401f, // 89
-    0.07015783f, // 90
-    0.07075543f, // 91
-    0.07135683f, // 92
-    0.07196203f, // 93
-    0.07257107f, // 94
-    0.07318395f, // 95
-    0.07380070f, // 96
-    0.07442135f, // 97
-    0.07504589f, // 98
-    0.07567437f, // 99
-    0.07630679f, // 100
-    0.07694318f, // 101
-    0.07758357f, // 102
-    0.07822799f, // 103
-    0.07887648f, // 104
-    0.07952905f, // 105
-    0.08018575f, // 106
-    0.08084662f, // 107
-    0.08151167f, // 108
-    0.08218095f, // 109
-    0.08285447f, // 110
-    0.08353227f, // 111
-    0.08421438f, // 112
-    0.08490082f, // 113
-    0.08559162f, // 114
-    0.08628682f, // 115
-    0.08698645f, // 116
-    0.08769055f, // 117
-    0.08839916f, // 118
-    0.08911231f, // 119
-    0.08983005f, // 120
-    0.09055241f, // 121
-    0.09127944f, // 122
-    0.09201117f, // 123
-    0.09274764f, // 124
-    0.09348890f, // 125
-    0.09423500f, // 126
-    0.09498598f, // 127
+#include "MiniSynthTypes.h"
+
+namespace mini_synth {
+
+// ---------------------------------------------------------------------------
+// コンパイル時生成テーブル
+//
+// すべて kAudioRate を基にコンパイル時に計算され、フラッシュ上に配置されます。
+// サンプルレートを変更してもテーブルとずれることはありません。
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief 1 半音あたりのファインチューン分割数（ピッチベンド解像度）。
+ */
+constexpr uint8_t kFineTuneSteps = 32U;
+
+/**
+ * @brief カットオフカーブテーブルの区間数（ADC 値を 4 段階ずつ補間）。
+ */
+constexpr uint16_t kCutoffCurveSize = 256U;
+
+/**
+ * @brief カットオフカーブとキー追従フィルタの下限/上限周波数 [Hz]。
+ */
+constexpr double kCutoffMinHz = 80.0;
+constexpr double kCutoffMaxHz = 6000.0;
+static_assert(kCutoffMaxHz * 2.0 < static_cast<double>(kAudioRate), "the cutoff range must stay below Nyquist");
+
+/**
+ * @brief エンベロープカーブテーブルの区間数（セグメント位置 Q16 の上位 8bit で引く）。
+ */
+constexpr uint16_t kEnvelopeCurveSize = 256U;
+
+/**
+ * @brief エンベロープカーブの時定数（セグメント長に対する e の冪、5 で終端の残差は約 -43dB）。
+ */
+constexpr double kEnvelopeCurveK = 5.0;
+
+/**
+ * @brief ソフトクリップテーブルの 1 オクターブあたりの区間数。
+ */
+constexpr uint8_t kSoftClipSegmentPoints = 32U;
+
+/**
+ * @brief ソフトクリップテーブルが扱う入力の大きさのビット数（|x| < 2^kSoftClipInputBits、32768 = 1.0 で 256.0 まで）。
+ */
+constexpr uint8_t kSoftClipInputBits = 23U;
+
+/**
+ * @brief ソフトクリップテーブルの点数。
+ *
+ * |x| < 2048 は 32 刻みの等間隔、それ以上は 1 オクターブ（2^k..2^(k+1)）を kSoftClipSegmentPoints 区間に分けます。
+ * 曲率の大きい原点付近ほど細かくなり、線形補間の誤差は全域で 2 LSB 以内に収まります。
+ */
+constexpr uint16_t kSoftClipTableSize = (kSoftClipInputBits - 9U) * kSoftClipSegmentPoints + 1U;
+
+namespace table_detail {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kLn2 = 0.69314718055994530942;
+
+/**
+ * @brief constexpr 版 exp(x)。半分に縮小してテイラー展開し、二乗で戻す。
+ */
+constexpr double cexp(double x) {
+  int halvings = 0;
+  while (x > 0.5 || x < -0.5) {
+    x *= 0.5;
+    ++halvings;
+  }
+  double term = 1.0;
+  double sum = 1.0;
+  for (int n = 1; n < 20; ++n) {
+    term *= x / n;
+    sum += term;
+  }
+  while (halvings-- > 0) {
+    sum *= sum;
+  }
+  return sum;
+}
+
+/**
+ * @brief constexpr 版 ln(x)（x > 0）。2 の冪で正規化し atanh 級数で求める。
+ */
+constexpr double clog(double x) {
+  int exponent = 0;
+  while (x > 1.5) {
+    x *= 0.5;
+    ++exponent;
+  }
+  while (x < 0.75) {
+    x *= 2.0;
+    --exponent;
+  }
+  const double y = (x - 1.0) / (x + 1.0);
+  const double y2 = y * y;
+  double term = y;
+  double sum = 0.0;
+  for (int n = 1; n < 40; n += 2) {
+    sum += term / n;
+    term *= y2;
+  }
+  return 2.0 * sum + exponent * kLn2;
+}
+
+/**
+ * @brief constexpr 版 sin(x)。[-pi, pi] に折り返してテイラー展開する。
+ */
+constexpr double csin(double x) {
+  while (x > kPi) {
+    x -= 2.0 * kPi;
+  }
+  while (x < -kPi) {
+    x += 2.0 * kPi;
+  }
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 15; ++n) {
+    term *= -x * x / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+/**
+ * @brief MIDI ノート（小数可）を周波数 [Hz] に変換する（A4 = 69 = 440Hz）。
+ */
+constexpr double noteToHz(const double note) {
+  return 440.0 * cexp((note - 69.0) / 12.0 * kLn2);
+}
+
+/**
+ * @brief 周波数から 32bit 位相インクリメントを求める（飽和付き）。
+ */
+constexpr uint32_t hzToIncrement(const double hz) {
+  const double inc = hz * 4294967296.0 / static_cast<double>(kAudioRate);
+  return (inc >= 4294967295.0) ? 0xFFFFFFFFUL : static_cast<uint32_t>(inc + 0.5);
+}
+
+/**
+ * @brief 0..1 の位置を kCutoffMinHz..kCutoffMaxHz に指数マップする。
+ */
+constexpr double cutoffCurveHz(const double t) {
+  return kCutoffMinHz * cexp(t * clog(kCutoffMaxHz / kCutoffMinHz));
+}
+
+/**
+ * @brief SVF の正規化周波数係数 f = 2 * sin(pi * fc / fs) を求める。
+ */
+constexpr double svfCoefficient(const double hz) {
+  return 2.0 * csin(kPi * hz / static_cast<double>(kAudioRate));
+}
+
+/**
+ * @brief 固定長テーブルの格納型（constexpr 関数から値で返せるようにする）。
+ */
+template <typename T, size_t N>
+struct ConstTable {
+  T values[N];
+  constexpr const T &operator[](const size_t index) const {
+    return values[index];
+  }
 };
+
+constexpr ConstTable<uint32_t, 128> makeNoteIncrementTable() {
+  ConstTable<uint32_t, 128> table{};
+  for (size_t note = 0; note < 128; ++note) {
+    table.values[note] = hzToIncrement(noteToHz(static_cast<double>(note)));
+  }
+  return table;
+}
+
+constexpr ConstTable<uint32_t, kFineTuneSteps> makeFineTuneTable() {
+  ConstTable<uint32_t, kFineTuneSteps> table{};
+  for (size_t step = 0; step < kFineTuneSteps; ++step) {
+    // 2^(step / (12 * kFineTuneSteps)) を Q30 で保持（1.0 <= 比 < 1.06）
+    const double ratio = cexp(static_cast<double>(step) / (12.0 * kFineTuneSteps) * kLn2);
+    table.values[step] = static_cast<uint32_t>(ratio * 1073741824.0 + 0.5);
+  }
+  return table;
+}
+
+// キー追従フィルタ: ノート 0..127 をカットオフカーブの 0..1 に対応させる
+constexpr double noteSvfCoefficient(const size_t note) {
+  const double f = svfCoefficient(cutoffCurveHz(static_cast<double>(note) / 127.0));
+  return (f > 0.999) ? 0.999 : f;
+}
+
+constexpr ConstTable<float, 128> makeNoteFTable() {
+  ConstTable<float, 128> table{};
+  for (size_t note = 0; note < 128; ++note) {
+    table.values[note] = static_cast<float>(noteSvfCoefficient(note));
+  }
+  return table;
+}
+
+constexpr ConstTable<int16_t, 128> makeNoteFQ15Table() {
+  ConstTable<int16_t, 128> table{};
+  for (size_t note = 0; note < 128; ++note) {
+    table.values[note] = static_cast<int16_t>(noteSvfCoefficient(note) * 32768.0 + 0.5);
+  }
+  return table;
+}
+
+constexpr ConstTable<uint16_t, kCutoffCurveSize + 1> makeCutoffCurveTable() {
+  ConstTable<uint16_t, kCutoffCurveSize + 1> table{};
+  for (size_t i = 0; i <= kCutoffCurveSize; ++i) {
+    // Chamberlin SVF が安定な f < 2.0 の範囲に収める（Q15 で 65535 まで）
+    double f = svfCoefficient(cutoffCurveHz(static_cast<double>(i) / kCutoffCurveSize)) * 32768.0 + 0.5;
+    if (f > 65535.0) {
+      f = 65535.0;
+    }
+    table.values[i] = static_cast<uint16_t>(f);
+  }
+  return table;
+}
+
+constexpr ConstTable<uint16_t, kEnvelopeCurveSize + 1> makeEnvelopeCurveTable() {
+  ConstTable<uint16_t, kEnvelopeCurveSize + 1> table{};
+  // 指数減衰 exp(-k t) を、t = 0 で 1、t = 1 でちょうど 0 になるよう正規化する
+  const double tail = cexp(-kEnvelopeCurveK);
+  for (size_t i = 0; i <= kEnvelopeCurveSize; ++i) {
+    const double t = static_cast<double>(i) / kEnvelopeCurveSize;
+    const double y = (cexp(-kEnvelopeCurveK * t) - tail) / (1.0 - tail);
+    table.values[i] = static_cast<uint16_t>(y * 32767.0 + 0.5);
+  }
+  return table;
+}
+
+/**
+ * @brief ソフトクリップテーブルの点 index に対応する入力の大きさを求める（softClipQ15() の逆写像）。
+ */
+constexpr uint32_t softClipTableInput(const size_t index) {
+  if (index < kSoftClipSegmentPoints) {
+    return static_cast<uint32_t>(index) << 5U;
+  }
+  const size_t octave = index / kSoftClipSegmentPoints;
+  const uint32_t mantissa = static_cast<uint32_t>(kSoftClipSegmentPoints + index % kSoftClipSegmentPoints);
+  return mantissa << (4U + octave);
+}
+
+constexpr ConstTable<int16_t, kSoftClipTableSize> makeSoftClipTable() {
+  ConstTable<int16_t, kSoftClipTableSize> table{};
+  // y = x / (1 + |x|)（32768 を 1.0 とみなす）
+  for (size_t i = 0; i < kSoftClipTableSize; ++i) {
+    const double x = static_cast<double>(softClipTableInput(i));
+    table.values[i] = static_cast<int16_t>(x * 32768.0 / (32768.0 + x) + 0.5);
+  }
+  return table;
+}
+
+}  // namespace table_detail
+
+/**
+ * @brief MIDI ノート 0..127 の位相インクリメント。
+ */
+inline constexpr auto kNoteIncrementTable = table_detail::makeNoteIncrementTable();
+
+/**
+ * @brief 1/kFineTuneSteps 半音ごとの周波数比（Q30）。
+ */
+inline constexpr auto kFineTuneTable = table_detail::makeFineTuneTable();
+
+/**
+ * @brief ノート→SVF 正規化周波数係数（キー追従用、float）。
+ */
+inline constexpr auto kNoteFTable = table_detail::makeNoteFTable();
+
+/**
+ * @brief kNoteFTable の Q15 固定小数点版（SVF_FIXED_POINT 用）。
+ */
+inline constexpr auto kNoteFQ15Table = table_detail::makeNoteFQ15Table();
+
+/**
+ * @brief カットオフポット用の指数カーブ（SVF 係数 f の Q15、kCutoffCurveSize + 1 点）。
+ */
+inline constexpr auto kCutoffCurveTable = table_detail::makeCutoffCurveTable();
+
+/**
+ * @brief エンベロープの指数減衰カーブ（Q15、32767 → 0、kEnvelopeCurveSize + 1 点）。
+ */
+inline constexpr auto kEnvelopeCurveTable = table_detail::makeEnvelopeCurveTable();
+
+/**
+ * @brief ソフトクリップ x / (1 + |x|) の非負側（Q15、kSoftClipTableSize 点、オクターブ単位の区間）。
+ */
+inline constexpr auto kSoftClipTable = table_detail::makeSoftClipTable();
+
+/**
+ * @brief ファインチューン単位のピッチから位相インクリメントを求める。
+ * @param pitch ノート番号 * kFineTuneSteps + 半音内のステップ（0..127 * kFineTuneSteps）。
+ * @return 位相インクリメント。
+ */
+inline uint32_t pitchToIncrement(const int32_t pitch) {
+  const int32_t maxPitch = 127 * static_cast<int32_t>(kFineTuneSteps);
+  const int32_t clamped = (pitch < 0) ? 0 : ((pitch > maxPitch) ? maxPitch : pitch);
+  const uint32_t note = static_cast<uint32_t>(clamped) / kFineTuneSteps;
+  const uint32_t step = static_cast<uint32_t>(clamped) % kFineTuneSteps;
+  return static_cast<uint32_t>((static_cast<uint64_t>(kNoteIncrementTable[note]) * kFineTuneTable[step]) >> 30);
+}
+
+/**
+ * @brief 10bit ADC 値からカットオフカーブ上の SVF 係数（Q15）を求める。
+ * @param adc ADC 値（0..kAdcMax）。
+ * @return Q15 の SVF 係数 f。
+ */
+inline uint16_t cutoffCurveQ15(const uint16_t adc) {
+  // 0..1023 を 256 区間に割り当て、区間内は線形補間する。
+  const uint32_t position = static_cast<uint32_t>(adc) * kCutoffCurveSize * 4U / kAdcMax;
+  const uint32_t index = position >> 2U;
+  if (index >= kCutoffCurveSize) {
+    return kCutoffCurveTable[kCutoffCurveSize];
+  }
+  const uint32_t frac = position & 3U;
+  const int32_t a = kCutoffCurveTable[index];
+  const int32_t b = kCutoffCurveTable[index + 1U];
+  return static_cast<uint16_t>(a + (((b - a) * static_cast<int32_t>(frac)) >> 2));
+}
+
+/**
+ * @brief セグメント位置からエンベロープの減衰カーブ値を求める。
+ * @param position セグメント内の位置（Q16、0..65535）。
+ * @return Q15 のカーブ値（位置 0 で 32767、終端で 0 に近づく）。
+ */
+inline int32_t envelopeCurveQ15(const uint32_t position) {
+  // 上位 8bit で区間を選び、下位 8bit で線形補間する。
+  const uint32_t index = (position >> 8U) & (kEnvelopeCurveSize - 1U);
+  const int32_t frac = static_cast<int32_t>(position & 0xFFU);
+  const int32_t a = kEnvelopeCurveTable[index];
+  const int32_t b = kEnvelopeCurveTable[index + 1U];
+  return a + (((b - a) * frac) >> 8);
+}
+
+}  // namespace mini_synth
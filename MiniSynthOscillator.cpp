@@ -4,11 +4,75 @@
 #include "MiniSynthOscillator.h"
 
 #include "MiniSynthMozziConfig.h"
+#include "MiniSynthDsp.h"
+#include "MiniSynthFilter.h"
 
 #include <mozzi_pgmspace.h>
 #include <tables/sin2048_int8.h>
 
 namespace mini_synth {
+namespace {
+/**
+ * @brief PolyBLEP 補正に使う 16bit 位相幅と、その逆数を求める。
+ * @param increment 32bit 位相インクリメント。
+ * @param recip 2^31 / dt を格納する。
+ * @return 16bit 位相単位の 1 サンプル幅 dt（1..32768）。
+ */
+inline uint16_t blepWidth(const uint32_t increment, uint32_t &recip) {
+  uint32_t dt = increment >> 16U;
+  if (dt == 0U) {
+    dt = 1U;
+  } else if (dt > 32768U) {
+    dt = 32768U;
+  }
+  recip = 0x80000000UL / dt;
+  return static_cast<uint16_t>(dt);
+}
+
+/**
+ * @brief 位相 0 の不連続点（高さ 2.0 の段差）に対する PolyBLEP 補正量を返す。
+ *
+ * 不連続点の前後 1 サンプル分だけ 2 次多項式の残差を与えます。除算はブロック単位の
+ * 逆数 recip で置き換えており、1 サンプルあたりのコストは一定です。
+ * @param t 16bit 位相。
+ * @param dt blepWidth() が返した位相幅。
+ * @param recip blepWidth() が返した逆数。
+ * @return Q15（32768 = 1.0）の補正量。
+ */
+inline int32_t polyBlep(const uint16_t t, const uint16_t dt, const uint32_t recip) {
+  if (t < dt) {
+    // 不連続点の直後: -(1 - t/dt)^2
+    const int32_t r = 32768 - static_cast<int32_t>((t * recip) >> 16U);
+    return -((r * r) >> 15);
+  }
+  const uint32_t u = 65536U - t;
+  if (u < dt) {
+    // 不連続点の直前: +(1 - (1 - t)/dt)^2
+    const int32_t r = 32768 - static_cast<int32_t>((u * recip) >> 16U);
+    return (r * r) >> 15;
+  }
+  return 0;
+}
+
+/**
+ * @brief 帯域制限ノコギリ波を 1 サンプル生成する。
+ *
+ * 段差の高さを補正量と合わせるため、フルスケール（-32768..32767、DC なし）で生成します。
+ */
+inline int16_t sawBL(const uint16_t phase, const uint16_t dt, const uint32_t recip) {
+  const int32_t naive = static_cast<int32_t>(phase) - 32768;
+  return static_cast<int16_t>(constrain(naive - polyBlep(phase, dt, recip), -32768, 32767));
+}
+
+/**
+ * @brief 帯域制限矩形波（デューティ 50%）を 1 サンプル生成する。
+ */
+inline int16_t squareBL(const uint16_t phase, const uint16_t dt, const uint32_t recip) {
+  const int32_t naive = (phase < 32768U) ? 32767 : -32768;
+  const int32_t value = naive + polyBlep(phase, dt, recip) - polyBlep(static_cast<uint16_t>(phase + 32768U), dt, recip);
+  return static_cast<int16_t>(constrain(value, -32768, 32767));
+}
+}  // namespace
 
 OscWaveform analogToWaveform(const uint16_t value) {
   // 入力レンジを5等分して波形を選択。
@@ -19,6 +83,15 @@ OscWaveform analogToWaveform(const uint16_t value) {
   if (value < segment * 2U) {
     return OscWaveform::kTriangle;
   }
+#if OSC_BANDLIMITED
+  if (value < segment * 3U) {
+    return OscWaveform::kSawBL;
+  }
+  if (value < segment * 4U) {
+    return OscWaveform::kPulseBL;
+  }
+  return OscWaveform::kSquareBL;
+#else
   if (value < segment * 3U) {
     return OscWaveform::kSaw;
   }
@@ -26,6 +99,7 @@ OscWaveform analogToWaveform(const uint16_t value) {
     return OscWaveform::kPulse;
   }
   return OscWaveform::kSquare;
+#endif
 }
 
 int16_t sineFromTable(const uint16_t phase) {
@@ -34,9 +108,10 @@ int16_t sineFromTable(const uint16_t phase) {
   return pgm_read_word_near(SIN2048_DATA + index);
 }
 
-int16_t renderWave(const Voice &voice, const OscWaveform waveform) {
+int16_t renderWave(const uint32_t voicePhase, const uint32_t increment, const OscWaveform waveform) {
   // 位相を 16bit に正規化。
-  const uint16_t phase = static_cast<uint16_t>(voice.phase >> 16U);
+  const uint16_t phase = static_cast<uint16_t>(voicePhase >> 16U);
+  uint32_t recip = 0U;
   switch (waveform) {
     case OscWaveform::kSine:
       // サイン波はテーブル参照で省リソース化。
@@ -49,11 +124,397 @@ int16_t renderWave(const Voice &voice, const OscWaveform waveform) {
       return static_cast<int16_t>((static_cast<int32_t>(phase) >> 1) - 32768);
     case OscWaveform::kPulse:
       return (phase < 32768U) ? 16384 : -16384;
+    case OscWaveform::kSawBL: {
+      const uint16_t dt = blepWidth(increment, recip);
+      return sawBL(phase, dt, recip);
+    }
+    case OscWaveform::kPulseBL: {
+      const uint16_t dt = blepWidth(increment, recip);
+      return static_cast<int16_t>(squareBL(phase, dt, recip) >> 1);
+    }
+    case OscWaveform::kSquareBL: {
+      const uint16_t dt = blepWidth(increment, recip);
+      return squareBL(phase, dt, recip);
+    }
     case OscWaveform::kSquare:
     default:
       return (phase < 32768U) ? 32767 : -32768;
   }
 }
 
+namespace {
+/**
+ * @brief 波形種別ごとに特殊化した 1 サンプル生成関数。
+ *
+ * 分岐はコンパイル時に解決され、各カーネルのループには波形判定が残りません。
+ * 生成式は renderWave() と同一です。
+ */
+template <OscWaveform W>
+inline int16_t oscSample(const uint32_t voicePhase, const uint16_t dt, const uint32_t recip) {
+  const uint16_t phase = static_cast<uint16_t>(voicePhase >> 16U);
+  if constexpr (W == OscWaveform::kSine) {
+    return sineFromTable(phase);
+  } else if constexpr (W == OscWaveform::kTriangle) {
+    return static_cast<int16_t>((phase < 32768U) ? (phase * 2) : (65535U - phase) * 2) - 32768;
+  } else if constexpr (W == OscWaveform::kSaw) {
+    return static_cast<int16_t>((static_cast<int32_t>(phase) >> 1) - 32768);
+  } else if constexpr (W == OscWaveform::kPulse) {
+    return (phase < 32768U) ? 16384 : -16384;
+  } else if constexpr (W == OscWaveform::kSquare) {
+    return (phase < 32768U) ? 32767 : -32768;
+  } else if constexpr (W == OscWaveform::kSawBL) {
+    return sawBL(phase, dt, recip);
+  } else if constexpr (W == OscWaveform::kPulseBL) {
+    return static_cast<int16_t>(squareBL(phase, dt, recip) >> 1);
+  } else {
+    static_assert(W == OscWaveform::kSquareBL, "unhandled waveform");
+    return squareBL(phase, dt, recip);
+  }
+}
+
+/**
+ * @brief 波形のみをブロック生成するカーネル。
+ */
+template <OscWaveform W>
+void renderOscBlock(uint32_t &phase, const uint32_t increment, int16_t *out, const size_t frames) {
+  // 帯域制限波形の補正幅はブロック内で一定（除算はここで 1 回のみ）。
+  uint32_t recip = 0U;
+  const uint16_t dt = blepWidth(increment, recip);
+  uint32_t acc = phase;
+  for (size_t i = 0; i < frames; ++i, acc += increment) {
+    out[i] = oscSample<W>(acc, dt, recip);
+  }
+  phase = acc;
+}
+
+/**
+ * @brief ボイスフィルタなし（VOICE_SVF 無効時）のポリシー。
+ */
+struct NoVoiceFilter {
+  NoVoiceFilter(const VoiceBank &bank, const uint8_t index, const VoiceKernelParams &params) {
+    (void)bank;
+    (void)index;
+    (void)params;
+  }
+  int32_t process(const int32_t sample) {
+    return sample;
+  }
+  void store(VoiceBank &bank, const uint8_t index) const {
+    (void)bank;
+    (void)index;
+  }
+};
+
+#if VOICE_SVF
+/**
+ * @brief ボイス毎 SVF のポリシー。状態と係数をブロック中ローカルに保持する。
+ */
+struct VoiceSvfFilter {
+  VoiceSvfFilter(const VoiceBank &bank, const uint8_t index, const VoiceKernelParams &params)
+      : low(bank.svfLow[index]), band(bank.svfBand[index]), f(bank.svfF[index]), q(params.resonance) {}
+  int32_t process(const int32_t sample) {
+#if SVF_FIXED_POINT
+    return processSvfQ15(low, band, sample, f, q);
+#else
+    return static_cast<int32_t>(processSvfFloat(low, band, static_cast<float>(sample), f, q));
+#endif
+  }
+  void store(VoiceBank &bank, const uint8_t index) const {
+    bank.svfLow[index] = low;
+    bank.svfBand[index] = band;
+  }
+  SvfValue low;
+  SvfValue band;
+  SvfValue f;
+  SvfValue q;
+};
+using ActiveVoiceFilter = VoiceSvfFilter;
+#else
+using ActiveVoiceFilter = NoVoiceFilter;
+#endif
+
+/**
+ * @brief 単一オシレータの音源ポリシー。位相と補正幅をブロック中ローカルに保持する。
+ */
+template <OscWaveform W>
+struct OscSource {
+  OscSource(const VoiceBank &bank, const uint8_t index, const VoiceKernelParams &params)
+      : phase(bank.phase[index]), increment(bank.increment[index]) {
+    (void)params;
+    dt = blepWidth(increment, recip);
+  }
+  int32_t next() {
+    const int32_t sample = oscSample<W>(phase, dt, recip);
+    phase += increment;
+    return sample;
+  }
+  void store(VoiceBank &bank, const uint8_t index) const {
+    bank.phase[index] = phase;
+  }
+  uint32_t phase;
+  uint32_t increment;
+  uint32_t recip = 0U;
+  uint16_t dt;
+};
+
+#if UNISON_VOICES
+/**
+ * @brief ユニゾンの音源ポリシー。ボイス本来のオシレータにデチューンしたノコギリ波を重ねる。
+ *
+ * サブオシレータは位相の上位 16bit を 2 つずつ 1 語に詰め（PKHTB）、各ハーフワードの符号ビットを
+ * 反転して 2 つのノコギリ波（phase - 32768）とし、ゲインとの積和（SMLAD）で 1 命令ずつミックスします。
+ * サブオシレータは帯域制限しません（デチューン幅が小さいため中心の帯域制限版が音色の芯になります）。
+ */
+template <OscWaveform W>
+struct UnisonSource {
+  UnisonSource(const VoiceBank &bank, const uint8_t index, const VoiceKernelParams &params) : center(bank, index, params) {
+    for (uint8_t k = 0; k < kUnisonVoices; ++k) {
+      phase[k] = bank.unisonPhase[index][k];
+      increment[k] = unisonIncrement(center.increment, params.unisonSpread, k);
+    }
+  }
+  int32_t next() {
+    static constexpr uint32_t kSideGains = packInt16(kUnisonSideGain, kUnisonSideGain);
+    int32_t acc = center.next() * kUnisonCenterGain;
+    for (uint8_t k = 0; k < kUnisonVoices; k += 2U) {
+      const uint32_t saws = packHigh16(phase[k + 1U], phase[k]) ^ 0x80008000UL;
+      phase[k] += increment[k];
+      phase[k + 1U] += increment[k + 1U];
+      acc = smlad(saws, kSideGains, acc);
+    }
+    // ゲインの合計は 1.0 以下なので 16bit に収まる。
+    return acc >> 15;
+  }
+  void store(VoiceBank &bank, const uint8_t index) const {
+    center.store(bank, index);
+    for (uint8_t k = 0; k < kUnisonVoices; ++k) {
+      bank.unisonPhase[index][k] = phase[k];
+    }
+  }
+  OscSource<W> center;
+  uint32_t phase[kUnisonVoices];
+  uint32_t increment[kUnisonVoices];
+};
+#endif
+
+/**
+ * @brief 波形生成・エンベロープ適用・ボイスフィルタ・ミックス加算を 1 ループにまとめたカーネル。
+ *
+ * エンベロープはランプ区間だけサンプルごとに加算し、残りは一定値のループで処理します。
+ */
+template <class Source, class Filter>
+void renderVoiceBlock(VoiceBank &bank, const uint8_t index, const VoiceKernelParams &params, int32_t *mix, const size_t frames) {
+  int32_t level = bank.envelopeLevel[index];
+  const int32_t step = bank.envelopeStep[index];
+  const size_t ramp = (bank.envelopeRamp[index] < frames) ? bank.envelopeRamp[index] : frames;
+  Source source(bank, index, params);
+  Filter filter(bank, index, params);
+  size_t i = 0;
+  for (; i < ramp; ++i) {
+    level += step;
+    const int32_t sample = (source.next() * (level >> kEnvelopeLevelShift)) >> 15;
+    mix[i] += filter.process(sample);
+  }
+  if (ramp != 0U) {
+    bank.envelopeRamp[index] = static_cast<uint16_t>(bank.envelopeRamp[index] - ramp);
+    if (bank.envelopeRamp[index] == 0U) {
+      // 除算の丸め誤差を残さないよう、ランプ終端で目標値に揃える。
+      level = bank.envelopeTarget[index];
+    }
+  }
+  const int32_t envelope = level >> kEnvelopeLevelShift;
+  for (; i < frames; ++i) {
+    const int32_t sample = (source.next() * envelope) >> 15;
+    mix[i] += filter.process(sample);
+  }
+  filter.store(bank, index);
+  source.store(bank, index);
+  bank.envelopeLevel[index] = level;
+}
+
+/**
+ * @brief 2 ボイス分の生成・エンベロープ適用・ミックス加算を 1 ループにまとめたカーネル（ボイス毎 SVF なし）。
+ *
+ * 2 ボイスのサンプルとエンベロープをそれぞれ 16bit x 2 に詰め（PKHBT / PKHTB）、積和 1 回（SMUAD）で
+ * 両ボイスの寄与をまとめてからミックスバッファへ加算します。ミックスバッファの読み書きと乗算が
+ * 2 ボイスで 1 回になります。丸め（>> 15）は 2 ボイスの和に対して 1 回だけ行います。
+ * エンベロープのランプ長はボイスごとに異なるため、短い方のランプ終端と長い方のランプ終端で区間を分けます。
+ */
+template <class Source>
+void renderVoicePairBlock(VoiceBank &bank, const uint8_t a, const uint8_t b, const VoiceKernelParams &params, int32_t *mix, const size_t frames) {
+  Source sourceA(bank, a, params);
+  Source sourceB(bank, b, params);
+  int32_t levelA = bank.envelopeLevel[a];
+  int32_t levelB = bank.envelopeLevel[b];
+  const int32_t stepA = bank.envelopeStep[a];
+  const int32_t stepB = bank.envelopeStep[b];
+  const size_t rampA = (bank.envelopeRamp[a] < frames) ? bank.envelopeRamp[a] : frames;
+  const size_t rampB = (bank.envelopeRamp[b] < frames) ? bank.envelopeRamp[b] : frames;
+  const size_t first = (rampA < rampB) ? rampA : rampB;
+  const size_t second = (rampA < rampB) ? rampB : rampA;
+  size_t i = 0;
+  // [i, end) をエンベロープ増分 (da, db) で処理する。エンベロープ値は Q15 << 16 なので上位ハーフワードがそのまま Q15。
+  auto run = [&](const size_t end, const int32_t da, const int32_t db) {
+    for (; i < end; ++i) {
+      levelA += da;
+      levelB += db;
+      const uint32_t samples = packLow16(sourceB.next(), sourceA.next());
+      const uint32_t envelopes = packHigh16(static_cast<uint32_t>(levelB), static_cast<uint32_t>(levelA));
+      mix[i] += smuad(samples, envelopes) >> 15;
+    }
+  };
+  // ランプを ramp サンプル進めた後の残りを書き戻し、終端なら丸め誤差を残さないよう目標値に揃える。
+  auto finishRamp = [&bank](const uint8_t index, const size_t ramp, int32_t &level) {
+    if (ramp == 0U) {
+      return;
+    }
+    bank.envelopeRamp[index] = static_cast<uint16_t>(bank.envelopeRamp[index] - ramp);
+    if (bank.envelopeRamp[index] == 0U) {
+      level = bank.envelopeTarget[index];
+    }
+  };
+  static_assert(kEnvelopeLevelShift == 16U, "the pair kernel packs the upper halfword of the envelope level");
+  run(first, stepA, stepB);
+  if (rampA == first) {
+    finishRamp(a, rampA, levelA);
+  }
+  if (rampB == first) {
+    finishRamp(b, rampB, levelB);
+  }
+  run(second, (rampA > first) ? stepA : 0, (rampB > first) ? stepB : 0);
+  if (rampA > first) {
+    finishRamp(a, rampA, levelA);
+  }
+  if (rampB > first) {
+    finishRamp(b, rampB, levelB);
+  }
+  run(frames, 0, 0);
+  sourceA.store(bank, a);
+  sourceB.store(bank, b);
+  bank.envelopeLevel[a] = levelA;
+  bank.envelopeLevel[b] = levelB;
+}
+
+using OscBlockKernel = void (*)(uint32_t &phase, uint32_t increment, int16_t *out, size_t frames);
+
+// 波形種別の並び順（OscWaveform の値）に合わせたディスパッチテーブル
+constexpr OscBlockKernel kOscBlockKernels[kOscWaveformCount] = {
+    &renderOscBlock<OscWaveform::kSine>,
+    &renderOscBlock<OscWaveform::kTriangle>,
+    &renderOscBlock<OscWaveform::kSaw>,
+    &renderOscBlock<OscWaveform::kPulse>,
+    &renderOscBlock<OscWaveform::kSquare>,
+    &renderOscBlock<OscWaveform::kSawBL>,
+    &renderOscBlock<OscWaveform::kPulseBL>,
+    &renderOscBlock<OscWaveform::kSquareBL>,
+};
+
+constexpr VoiceKernel kVoiceKernels[kOscWaveformCount] = {
+    &renderVoiceBlock<OscSource<OscWaveform::kSine>, ActiveVoiceFilter>,
+    &renderVoiceBlock<OscSource<OscWaveform::kTriangle>, ActiveVoiceFilter>,
+    &renderVoiceBlock<OscSource<OscWaveform::kSaw>, ActiveVoiceFilter>,
+    &renderVoiceBlock<OscSource<OscWaveform::kPulse>, ActiveVoiceFilter>,
+    &renderVoiceBlock<OscSource<OscWaveform::kSquare>, ActiveVoiceFilter>,
+    &renderVoiceBlock<OscSource<OscWaveform::kSawBL>, ActiveVoiceFilter>,
+    &renderVoiceBlock<OscSource<OscWaveform::kPulseBL>, ActiveVoiceFilter>,
+    &renderVoiceBlock<OscSource<OscWaveform::kSquareBL>, ActiveVoiceFilter>,
+};
+
+constexpr VoicePairKernel kVoicePairKernels[kOscWaveformCount] = {
+    &renderVoicePairBlock<OscSource<OscWaveform::kSine>>,
+    &renderVoicePairBlock<OscSource<OscWaveform::kTriangle>>,
+    &renderVoicePairBlock<OscSource<OscWaveform::kSaw>>,
+    &renderVoicePairBlock<OscSource<OscWaveform::kPulse>>,
+    &renderVoicePairBlock<OscSource<OscWaveform::kSquare>>,
+    &renderVoicePairBlock<OscSource<OscWaveform::kSawBL>>,
+    &renderVoicePairBlock<OscSource<OscWaveform::kPulseBL>>,
+    &renderVoicePairBlock<OscSource<OscWaveform::kSquareBL>>,
+};
+
+#if UNISON_VOICES
+/**
+ * @brief サブオシレータ k のデチューン位置（Q15、-1..+1 を等間隔）。
+ */
+constexpr int32_t unisonOffset(const uint8_t k) {
+  return (kUnisonVoices < 2U) ? 0 : ((2 * static_cast<int32_t>(k) + 1 - static_cast<int32_t>(kUnisonVoices)) * 32767) / (static_cast<int32_t>(kUnisonVoices) - 1);
+}
+#endif
+
+/**
+ * @brief 波形種別をテーブルのインデックスへ変換する（範囲外は Square 扱い）。
+ */
+inline uint8_t kernelIndex(const OscWaveform waveform) {
+  const uint8_t index = static_cast<uint8_t>(waveform);
+  return (index < kOscWaveformCount) ? index : static_cast<uint8_t>(OscWaveform::kSquare);
+}
+}  // namespace
+
+void renderWaveBlock(uint32_t &phase, const uint32_t increment, const OscWaveform waveform, int16_t *out, const size_t frames) {
+  kOscBlockKernels[kernelIndex(waveform)](phase, increment, out, frames);
+}
+
+VoiceKernel selectVoiceKernel(const OscWaveform waveform, const bool unison) {
+#if UNISON_VOICES
+  if (unison) {
+    if (waveform == OscWaveform::kSaw) {
+      return &renderVoiceBlock<UnisonSource<OscWaveform::kSaw>, ActiveVoiceFilter>;
+    }
+    if (waveform == OscWaveform::kSawBL) {
+      return &renderVoiceBlock<UnisonSource<OscWaveform::kSawBL>, ActiveVoiceFilter>;
+    }
+  }
+#else
+  (void)unison;
+#endif
+  return kVoiceKernels[kernelIndex(waveform)];
+}
+
+VoicePairKernel selectVoicePairKernel(const OscWaveform waveform, const bool unison) {
+#if VOICE_SVF
+  // ボイス毎 SVF はエンベロープの後段にあるため、2 ボイスの和をまとめて求められない。
+  (void)waveform;
+  (void)unison;
+  return nullptr;
+#else
+#if UNISON_VOICES
+  if (unison) {
+    if (waveform == OscWaveform::kSaw) {
+      return &renderVoicePairBlock<UnisonSource<OscWaveform::kSaw>>;
+    }
+    if (waveform == OscWaveform::kSawBL) {
+      return &renderVoicePairBlock<UnisonSource<OscWaveform::kSawBL>>;
+    }
+  }
+#else
+  (void)unison;
+#endif
+  return kVoicePairKernels[kernelIndex(waveform)];
+#endif
+}
+
+uint32_t unisonIncrement(const uint32_t increment, const uint16_t spread, const uint8_t sub) {
+#if UNISON_VOICES
+  const int32_t detune = (static_cast<int32_t>(spread) * unisonOffset(sub)) >> 15;
+  const int64_t delta = (static_cast<int64_t>(increment) * detune) >> (15U + kUnisonDetuneShift);
+  return static_cast<uint32_t>(static_cast<int64_t>(increment) + delta);
+#else
+  (void)spread;
+  (void)sub;
+  return increment;
+#endif
+}
+
+void initUnisonPhases(VoiceBank &bank, const uint8_t index) {
+#if UNISON_VOICES
+  // 黄金比で位相をずらし、サブオシレータどうしが揃って始まらないようにする。
+  for (uint8_t k = 0; k < kUnisonVoices; ++k) {
+    bank.unisonPhase[index][k] = static_cast<uint32_t>(k + 1U) * 0x9E3779B9UL;
+  }
+#else
+  (void)bank;
+  (void)index;
+#endif
+}
+
 }  // namespace mini_synth
 
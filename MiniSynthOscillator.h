@@ -6,6 +6,8 @@ namespace mini_synth {
 
 /**
  * @brief アナログ値から波形種別へ変換する。
+ *
+ * OSC_BANDLIMITED 有効時は Saw/Pulse/Square の帯域制限版を返します。
  * @param value アナログ入力値。
  * @return 対応する波形種別。
  */
@@ -19,12 +21,108 @@ OscWaveform analogToWaveform(uint16_t value);
 int16_t sineFromTable(uint16_t phase);
 
 /**
- * @brief ボイスの設定に基づいて波形を生成する。
- * @param voice 入力となるボイス情報。
+ * @brief ボイスの位相に基づいて波形を生成する。
+ * @param phase 入力となるボイスの位相値。
+ * @param increment 位相インクリメント（帯域制限波形の補正幅に使用）。
  * @param waveform 選択されている波形種別。
  * @return 16bit の波形サンプル。
  */
-int16_t renderWave(const Voice &voice, OscWaveform waveform);
+int16_t renderWave(uint32_t phase, uint32_t increment, OscWaveform waveform);
+
+/**
+ * @brief 波形種別に特殊化したカーネルで、指定フレーム数の波形をまとめて生成する。
+ * @param phase 位相値。生成したフレーム数だけ進めて書き戻す。
+ * @param increment 位相インクリメント。
+ * @param waveform 選択されている波形種別。
+ * @param out 出力先バッファ（frames 要素）。
+ * @param frames 生成するフレーム数。
+ */
+void renderWaveBlock(uint32_t &phase, uint32_t increment, OscWaveform waveform, int16_t *out, size_t frames);
+
+/**
+ * @brief ボイスレンダリングカーネルに渡すブロック共通のパラメータ。
+ */
+struct VoiceKernelParams {
+  SvfValue resonance = 0; //!< VOICE_SVF 用のレゾナンス（固定小数点時は Q15）。
+  uint16_t unisonSpread = 0U; //!< ユニゾンのデチューン幅（Q15、ユニゾンカーネルのみ参照）。
+};
+
+/**
+ * @brief 2 ボイス分のブロックをまとめて生成してミックスバッファへ加算するカーネル。
+ *
+ * 2 ボイスのサンプルとエンベロープを 16bit x 2 に詰め、1 回の積和（SMUAD）で両ボイスの寄与を求めます。
+ * 丸めは 2 ボイスの和に対して 1 回なので、VoiceKernel を 2 回呼んだ結果とは最大 1 LSB 異なります。
+ */
+using VoicePairKernel = void (*)(VoiceBank &bank, uint8_t a, uint8_t b, const VoiceKernelParams &params, int32_t *mix, size_t frames);
+
+/**
+ * @brief ユニゾンで外側のサブオシレータが離れる最大幅（インクリメントの 2^-kUnisonDetuneShift 倍 = 約 ±1 半音）。
+ */
+constexpr uint8_t kUnisonDetuneShift = 4U;
+
+/**
+ * @brief ユニゾン時の中心オシレータ（ボイス本来の位相）のゲイン（Q15）。
+ *
+ * 中心はサブオシレータ 2 つ分の重みで、中心とサブオシレータのゲインの合計が 1.0 以下になるように配分します。
+ */
+constexpr int16_t kUnisonCenterGain = (kUnisonVoices == 0U) ? 32767 : static_cast<int16_t>(65536 / (kUnisonVoices + 2));
+
+/**
+ * @brief ユニゾン時のサブオシレータ 1 つあたりのゲイン（Q15）。
+ */
+constexpr int16_t kUnisonSideGain = static_cast<int16_t>(32768 / (kUnisonVoices + 2));
+
+/**
+ * @brief ユニゾンのサブオシレータの位相インクリメントを求める。
+ *
+ * サブオシレータはデチューン幅の -1..+1 倍に等間隔で並びます。ブロック先頭で 1 回だけ呼び出します。
+ * @param increment ボイスの位相インクリメント。
+ * @param spread デチューン幅（Q15）。
+ * @param sub サブオシレータ番号（0..kUnisonVoices-1）。
+ * @return サブオシレータの位相インクリメント。
+ */
+uint32_t unisonIncrement(uint32_t increment, uint16_t spread, uint8_t sub);
+
+/**
+ * @brief ユニゾンのサブオシレータ位相を初期値（互いにずらした固定位相）へ戻す（オーディオ側、ノートオン時）。
+ *
+ * 発音ごとに同じ位相から始めることで、アタックの音色と出力が再現可能になります。
+ * @param bank ボイスバンク。
+ * @param index 対象のボイスインデックス。
+ */
+void initUnisonPhases(VoiceBank &bank, uint8_t index);
+
+/**
+ * @brief 1 ボイス分のブロックを生成してミックスバッファへ加算するカーネル。
+ *
+ * 波形生成・エンベロープ適用・ボイス毎 SVF（VOICE_SVF 有効時）をまとめて行い、位相とフィルタ状態を書き戻します。
+ */
+using VoiceKernel = void (*)(VoiceBank &bank, uint8_t index, const VoiceKernelParams &params, int32_t *mix, size_t frames);
+
+/**
+ * @brief 波形種別に特殊化されたボイスカーネルを取得する。
+ *
+ * ブロック（またはコントロール周期）ごとに 1 回だけ呼び出し、サンプルループから波形分岐を取り除きます。
+ *
+ * unison が true でノコギリ波（kSaw/kSawBL）のときは、ボイス本来のオシレータに kUnisonVoices 個の
+ * デチューンしたノコギリ波を重ねるユニゾン（スーパーソー）カーネルを返します。サブオシレータは 2 つずつ
+ * 16bit x 2 のパック演算（PKHTB + SMLAD）で生成・ミックスするため、1 サンプルあたりのコストは
+ * フルボイスを kUnisonVoices 個重ねるより大幅に小さく収まります。その他の波形と UNISON_VOICES=0 では unison を無視します。
+ * @param waveform 波形種別。
+ * @param unison ユニゾンカーネルを選ぶ場合は true（VoiceKernelParams::unisonSpread を参照する）。
+ * @return ボイスカーネル。
+ */
+VoiceKernel selectVoiceKernel(OscWaveform waveform, bool unison = false);
+
+/**
+ * @brief selectVoiceKernel() と同じ波形・ユニゾン指定で、2 ボイスをまとめて処理するカーネルを取得する。
+ *
+ * 発音中のボイスを 2 つずつこのカーネルで処理し、端数の 1 ボイスだけ VoiceKernel で処理します。
+ * @param waveform 波形種別。
+ * @param unison ユニゾンカーネルを選ぶ場合は true。
+ * @return ペアカーネル。VOICE_SVF 有効時（フィルタがエンベロープの後段にある）は nullptr。
+ */
+VoicePairKernel selectVoicePairKernel(OscWaveform waveform, bool unison = false);
 
 }  // namespace mini_synth
 
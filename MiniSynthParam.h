@@ -0,0 +1,111 @@
+#pragma once
+
+#include "MiniSynthTypes.h"
+
+namespace mini_synth {
+
+/**
+ * @brief ParamRamp の内部値の拡張ビット数（Q15 値を 2^14 倍して補間精度を確保。2.0 までなら 2^30 に収まる）。
+ */
+constexpr uint8_t kParamRampShift = 14U;
+
+/**
+ * @brief パラメータが目標値へ向かう形。
+ */
+enum class RampShape : uint8_t {
+  kLinear = 0,  //!< rampFrames サンプルかけて等速で目標値へ到達する。
+  kExponential, //!< ブロックごとに残差の 1/2^kParamExpShift を詰める（ブロック内は直線補間）。
+};
+
+/**
+ * @brief 指数ランプで 1 ブロックごとに残差を詰める割合のシフト量（1/8、64 フレームブロックで時定数 約 30ms）。
+ */
+constexpr uint8_t kParamExpShift = 3U;
+
+/**
+ * @brief コントロール側が目標値を設定し、オーディオ側がブロックごとの直線ランプで追従するパラメータ。
+ *
+ * オーディオ側はブロック先頭で beginBlock() を 1 回呼び、返された増分をサンプルごとに加算します。
+ * サンプルループには整数の加算しか残らず、除算はブロックあたり 1 回です。
+ * 値は Q15（0x8000 = 1.0）で扱い、浮動小数点の消費側はブロック先頭の値と増分だけを変換します。
+ * setTarget()/beginBlock() ともオーディオ側から呼び出します（コントロール側からは kParam イベント経由）。
+ */
+struct ParamRamp {
+  int32_t value = 0;      //!< 現在値（Q15 << kParamRampShift）。
+  int32_t target = 0;     //!< 目標値（同上）。
+  uint32_t remaining = 0U; //!< 線形ランプの残りサンプル数。
+  uint16_t rampFrames = kControlPeriod; //!< 線形ランプの長さ [サンプル]。
+  RampShape shape = RampShape::kLinear; //!< 追従の形。
+
+  /**
+   * @brief 目標値を設定する。
+   * @param q15 新しい目標値（Q15）。
+   */
+  void setTarget(const int32_t q15) {
+    target = q15 << kParamRampShift;
+    remaining = rampFrames;
+  }
+
+  /**
+   * @brief 目標値へ即座に移る（起動時・リセット時用）。
+   * @param q15 新しい値（Q15）。
+   */
+  void jumpTo(const int32_t q15) {
+    target = q15 << kParamRampShift;
+    value = target;
+    remaining = 0U;
+  }
+
+  /**
+   * @brief ランプが終わって値が一定かどうか。
+   */
+  bool settled() const {
+    return value == target;
+  }
+
+  /**
+   * @brief 1 ブロック分のランプを確定し、1 サンプルあたりの増分を返す。
+   *
+   * 呼び出し後の value はブロック終端の値になります。ブロック先頭の値は呼び出し前に読み出してください。
+   * @param frames ブロックのフレーム数（1 以上）。
+   * @return 1 サンプルあたりの増分（Q15 << kParamRampShift）。
+   */
+  int32_t beginBlock(const size_t frames) {
+    const int32_t diff = target - value;
+    if (diff == 0) {
+      return 0;
+    }
+    const int32_t count = static_cast<int32_t>(frames);
+    int32_t step = 0;
+    if (shape == RampShape::kExponential) {
+      // 残差の一定割合を詰める。小さくなった残差はこのブロックで詰め切る。
+      const int32_t delta = diff >> kParamExpShift;
+      step = (delta > -count && delta < count) ? diff / count : delta / count;
+    } else if (remaining <= frames) {
+      step = diff / count;
+    } else {
+      step = diff / static_cast<int32_t>(remaining);
+    }
+    remaining = (remaining > frames) ? remaining - static_cast<uint32_t>(frames) : 0U;
+    value += step * count;
+    // 除算の丸め誤差で止まらないよう、線形ランプの終端と詰め切ったブロックでは目標値に揃える。
+    if ((shape == RampShape::kLinear && remaining == 0U) || step == 0) {
+      value = target;
+    }
+    return step;
+  }
+
+  /**
+   * @brief Q15 の現在値を返す。
+   */
+  int32_t q15() const {
+    return value >> kParamRampShift;
+  }
+};
+
+/**
+ * @brief ParamRamp の内部値を浮動小数点（1.0 = Q15 の 0x8000）へ変換する係数。
+ */
+constexpr float kParamRampToFloat = 1.0f / static_cast<float>(static_cast<int32_t>(1) << (15 + kParamRampShift));
+
+}  // namespace mini_synth
@@ -0,0 +1,72 @@
+#include "MiniSynthPatch.h"
+
+namespace mini_synth {
+namespace {
+/**
+ * @brief 16bit 値をリトルエンディアンで書き込む。
+ */
+void putU16(uint8_t *out, const uint16_t value) {
+  out[0] = static_cast<uint8_t>(value);
+  out[1] = static_cast<uint8_t>(value >> 8U);
+}
+
+/**
+ * @brief リトルエンディアンの 16bit 値を読み出す。
+ */
+uint16_t getU16(const uint8_t *data) {
+  return static_cast<uint16_t>(data[0] | (static_cast<uint16_t>(data[1]) << 8U));
+}
+}  // namespace
+
+void encodePatch(const SynthPatch &patch, uint8_t *out) {
+  for (size_t i = 0; i < kPatchRecordBytes; ++i) {
+    out[i] = 0U;
+  }
+  out[0] = kPatchFormatVersion;
+  out[1] = static_cast<uint8_t>(patch.waveform);
+  putU16(out + 2, patch.attackPot);
+  putU16(out + 4, patch.releasePot);
+  putU16(out + 6, patch.cutoffPot);
+  putU16(out + 8, patch.resonancePot);
+  putU16(out + 10, patch.decayRate);
+  putU16(out + 12, static_cast<uint16_t>(patch.sustainLevel));
+  putU16(out + 14, patch.volume);
+  putU16(out + 16, patch.unisonSpread);
+}
+
+bool decodePatch(const uint8_t *data, SynthPatch &patch) {
+  if (data[0] != kPatchFormatVersion || data[1] >= kOscWaveformCount) {
+    return false;
+  }
+  SynthPatch decoded;
+  decoded.waveform = static_cast<OscWaveform>(data[1]);
+  decoded.attackPot = getU16(data + 2);
+  decoded.releasePot = getU16(data + 4);
+  decoded.cutoffPot = getU16(data + 6);
+  decoded.resonancePot = getU16(data + 8);
+  decoded.decayRate = getU16(data + 10);
+  decoded.sustainLevel = static_cast<int16_t>(getU16(data + 12));
+  decoded.volume = getU16(data + 14);
+  decoded.unisonSpread = getU16(data + 16);
+  // 範囲外の値はポット・CC からは作れないため、壊れたパッチとして扱う。
+  if (decoded.attackPot > kAdcMax || decoded.releasePot > kAdcMax || decoded.cutoffPot > kAdcMax || decoded.resonancePot > kAdcMax ||
+      decoded.decayRate < 512U || decoded.decayRate > 8192U || decoded.sustainLevel < 0 || decoded.volume > 32768U ||
+      decoded.unisonSpread > 32767U) {
+    return false;
+  }
+  patch = decoded;
+  return true;
+}
+
+bool loadPatch(const uint8_t program, SynthPatch &patch) {
+  uint8_t data[kPatchRecordBytes];
+  return patchStoreRead(program, data) && decodePatch(data, patch);
+}
+
+bool savePatch(const uint8_t program, const SynthPatch &patch) {
+  uint8_t data[kPatchRecordBytes];
+  encodePatch(patch, data);
+  return patchStoreWrite(program, data);
+}
+
+}  // namespace mini_synth
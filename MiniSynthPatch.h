@@ -0,0 +1,76 @@
+#pragma once
+
+#include "MiniSynthTypes.h"
+#include "MiniSynthPatchStore.h"
+
+// パッチ（音色）の保存と呼び出し。
+//
+// パッチはポット位置と MIDI CC で設定する音色パラメータをまとめたもので、
+// kPatchRecordBytes バイトの固定形式（リトルエンディアン、先頭に形式バージョン）へ直列化して
+// プログラム番号ごとにフラッシュ（MiniSynthPatchStore）へ保存します。
+// Program Change でそのプログラム番号のパッチを呼び出し、CC119（値 64 以上）で現在の音色を保存します。
+// 呼び出したポット値は、ポットを動かすまでポットの代わりに使われます（ピックアップ）。
+
+namespace mini_synth {
+
+/**
+ * @brief パッチの直列化形式のバージョン（互換性のない変更で上げる）。
+ */
+constexpr uint8_t kPatchFormatVersion = 1U;
+
+/**
+ * @brief 直列化したパッチの大きさ（残りはゼロで埋める）。
+ */
+constexpr size_t kPatchEncodedBytes = 18U;
+static_assert(kPatchEncodedBytes <= kPatchRecordBytes, "the patch format must fit in a store record");
+
+/**
+ * @brief 保存・呼び出しの対象となる音色パラメータ。
+ *
+ * ポット由来の値は変換前のポット位置（0..kAdcMax）で持ち、呼び出し時も通常のポットと同じ経路で変換します。
+ */
+struct SynthPatch {
+  OscWaveform waveform = OscWaveform::kSine; //!< オシレータ波形。
+  uint16_t attackPot = 0U;                   //!< アタックのポット位置。
+  uint16_t releasePot = 0U;                  //!< リリースのポット位置。
+  uint16_t cutoffPot = kAdcMax;              //!< カットオフのポット位置（アフタータッチ加算前）。
+  uint16_t resonancePot = 0U;                //!< レゾナンスのポット位置。
+  uint16_t decayRate = 1024U;                //!< ディケイの進み幅（EnvelopeParams::decayRate、CC75）。
+  int16_t sustainLevel = 32767;              //!< サステインレベル（Q15、CC79）。
+  uint16_t volume = 32768U;                  //!< マスターボリューム（Q15、CC7）。
+  uint16_t unisonSpread = 0U;                //!< ユニゾンのデチューン幅（Q15、CC94）。
+};
+
+/**
+ * @brief パッチを直列化する。
+ * @param patch パッチ。
+ * @param out kPatchRecordBytes バイトの出力先。
+ */
+void encodePatch(const SynthPatch &patch, uint8_t *out);
+
+/**
+ * @brief 直列化したパッチを復元する（バージョンと各値の範囲を検証する）。
+ * @param data kPatchRecordBytes バイトの入力。
+ * @param patch 成功した場合の格納先（失敗時は変更しない）。
+ * @return 有効なパッチだった場合は true。
+ */
+bool decodePatch(const uint8_t *data, SynthPatch &patch);
+
+/**
+ * @brief プログラム番号のパッチをフラッシュから読み出す（RAM の索引からの数語のコピーのみ）。
+ * @param program プログラム番号。
+ * @param patch 成功した場合の格納先（失敗時は変更しない）。
+ * @return 保存済みで有効なパッチだった場合は true。
+ */
+bool loadPatch(uint8_t program, SynthPatch &patch);
+
+/**
+ * @brief パッチをプログラム番号へ保存する（内容が同じならフラッシュに書き込まない）。
+ * @param program プログラム番号（kPatchSlots 未満）。
+ * @param patch パッチ。
+ * @return 保存できた（または予備バンクの消去待ちとして受け付けた）場合は true。別スロットの保存が消去待ちの間は
+ *         false（patchStoreWritePending() が true。patchStoreService() の後にもう一度保存する）。
+ */
+bool savePatch(uint8_t program, const SynthPatch &patch);
+
+}  // namespace mini_synth
@@ -0,0 +1,536 @@
+#include "MiniSynthPatchStore.h"
+
+#include <string.h>
+
+#if !defined(USE_PATCH_FLASH) && !defined(PATCH_FLASH_HOST_SIM)
+
+// Stub implementation when no flash backend is enabled.
+bool patchStoreInit() {
+  return false;
+}
+
+bool patchStoreRead(uint8_t slot, uint8_t *out) {
+  (void)slot;
+  (void)out;
+  return false;
+}
+
+bool patchStoreWrite(uint8_t slot, const uint8_t *data) {
+  (void)slot;
+  (void)data;
+  return false;
+}
+
+bool patchStoreWritePending() {
+  return false;
+}
+
+bool patchStoreService() {
+  return false;
+}
+
+void patchStoreGetStats(PatchStoreStats *stats) {
+  *stats = PatchStoreStats();
+}
+
+#else
+
+// ---------------------------------------------------------------------------
+// Portable log-structured core (shared by the HAL backend and the host simulation)
+//
+// Bank layout (32-bit words):
+//   [0] kBankMagic  [1] generation (erased = bank not committed)
+//   [2..] records of kRecordWords words: payload words, then the commit word
+//         slot | kCommitMarker << 8 | crc16(slot, payload) << 16
+// The first fully erased record ends the log.
+// ---------------------------------------------------------------------------
+
+static const uint32_t kErasedWord = 0xFFFFFFFFUL;
+static const uint32_t kBankMagic = 0x48435450UL; // "PTCH"
+static const uint32_t kCommitMarker = 0x5AU;
+static const uint16_t kHeaderWords = 2U;
+static const uint16_t kPayloadWords = static_cast<uint16_t>(kPatchRecordBytes / 4U);
+static const uint16_t kRecordWords = kPayloadWords + 1U;
+static_assert(kPatchRecordBytes % 4U == 0U, "records are programmed in whole words");
+
+// Smallest bank that holds every slot plus one free record (so a transfer never
+// leaves a full bank behind).
+static const uint32_t kMinBankBytes = (kHeaderWords + (static_cast<uint32_t>(kPatchSlots) + 1U) * kRecordWords) * 4U;
+
+// Backend hooks. Offsets are in words from the start of the bank.
+static uint32_t patchFlashBankBytes();
+static uint32_t patchFlashRead(uint8_t bank, uint16_t offset);
+static bool patchFlashProgram(uint8_t bank, uint16_t offset, uint32_t value);
+static bool patchFlashErase(uint8_t bank);
+
+static uint16_t g_bankWords = 0U;
+static uint8_t g_activeBank = 0U;
+static uint32_t g_generation = 0U;
+// Next free record of the active bank.
+static uint16_t g_writeOffset = 0U;
+// Newest record of each slot in the active bank (0 = never written).
+static uint16_t g_patchIndex[kPatchSlots];
+// The spare bank holds an old or torn copy and must be erased before the next transfer.
+static bool g_erasePending = false;
+// A store that needed a transfer while the spare bank was dirty, finished by patchStoreService().
+static bool g_writePending = false;
+static uint8_t g_pendingSlot = 0U;
+static uint32_t g_pendingPayload[kPayloadWords];
+static bool g_storeReady = false;
+static PatchStoreStats g_storeStats = {};
+
+// CRC-16/CCITT-FALSE over the slot number and the payload words.
+static uint16_t crc16Update(uint16_t crc, const uint8_t byte) {
+  crc ^= static_cast<uint16_t>(byte) << 8U;
+  for (uint8_t bit = 0U; bit < 8U; ++bit) {
+    crc = (crc & 0x8000U) ? static_cast<uint16_t>((crc << 1U) ^ 0x1021U) : static_cast<uint16_t>(crc << 1U);
+  }
+  return crc;
+}
+
+static uint32_t commitWord(const uint8_t slot, const uint32_t *payload) {
+  uint16_t crc = crc16Update(0xFFFFU, slot);
+  for (uint16_t i = 0U; i < kPayloadWords; ++i) {
+    for (uint8_t shift = 0U; shift < 32U; shift += 8U) {
+      crc = crc16Update(crc, static_cast<uint8_t>(payload[i] >> shift));
+    }
+  }
+  return static_cast<uint32_t>(slot) | (kCommitMarker << 8U) | (static_cast<uint32_t>(crc) << 16U);
+}
+
+// Payload bytes are packed little-endian into words.
+static void packPayload(const uint8_t *data, uint32_t *words) {
+  for (uint16_t i = 0U; i < kPayloadWords; ++i) {
+    const uint8_t *b = data + i * 4U;
+    words[i] = static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8U) | (static_cast<uint32_t>(b[2]) << 16U) |
+               (static_cast<uint32_t>(b[3]) << 24U);
+  }
+}
+
+static void readPayload(const uint8_t bank, const uint16_t offset, uint32_t *words) {
+  for (uint16_t i = 0U; i < kPayloadWords; ++i) {
+    words[i] = patchFlashRead(bank, static_cast<uint16_t>(offset + i));
+  }
+}
+
+static bool programWord(const uint8_t bank, const uint16_t offset, const uint32_t value) {
+  if (!patchFlashProgram(bank, offset, value) || patchFlashRead(bank, offset) != value) {
+    return false;
+  }
+  g_storeStats.programmedBytes += 4U;
+  return true;
+}
+
+// Payload first, commit word last: a record torn by power loss fails its CRC.
+static bool programRecord(const uint8_t bank, const uint16_t offset, const uint32_t *payload, const uint32_t commit) {
+  for (uint16_t i = 0U; i < kPayloadWords; ++i) {
+    if (!programWord(bank, static_cast<uint16_t>(offset + i), payload[i])) {
+      return false;
+    }
+  }
+  return programWord(bank, static_cast<uint16_t>(offset + kPayloadWords), commit);
+}
+
+static bool eraseBank(const uint8_t bank) {
+  if (!patchFlashErase(bank)) {
+    return false;
+  }
+  ++g_storeStats.erases;
+  return true;
+}
+
+static bool bankIsBlank(const uint8_t bank) {
+  for (uint16_t i = 0U; i < g_bankWords; ++i) {
+    if (patchFlashRead(bank, i) != kErasedWord) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool bankIsCommitted(const uint8_t bank) {
+  return patchFlashRead(bank, 0U) == kBankMagic && patchFlashRead(bank, 1U) != kErasedWord;
+}
+
+// Rebuild the index from the records of `bank`.
+static void scanBank(const uint8_t bank, const bool countCorrupt) {
+  for (uint8_t s = 0U; s < kPatchSlots; ++s) {
+    g_patchIndex[s] = 0U;
+  }
+  uint16_t offset = kHeaderWords;
+  while (static_cast<uint32_t>(offset) + kRecordWords <= g_bankWords) {
+    uint32_t payload[kPayloadWords];
+    readPayload(bank, offset, payload);
+    const uint32_t commit = patchFlashRead(bank, static_cast<uint16_t>(offset + kPayloadWords));
+    bool erased = commit == kErasedWord;
+    for (uint16_t i = 0U; i < kPayloadWords && erased; ++i) {
+      erased = payload[i] == kErasedWord;
+    }
+    if (erased) {
+      break;
+    }
+    const uint8_t slot = static_cast<uint8_t>(commit);
+    if (slot < kPatchSlots && commit == commitWord(slot, payload)) {
+      g_patchIndex[slot] = offset;
+    } else if (countCorrupt) {
+      ++g_storeStats.corruptRecords;
+    }
+    offset = static_cast<uint16_t>(offset + kRecordWords);
+  }
+  g_writeOffset = offset;
+}
+
+static bool writeHeader(const uint8_t bank, const uint32_t generation) {
+  return programWord(bank, 0U, kBankMagic) && programWord(bank, 1U, generation);
+}
+
+// Copy the newest record of every other slot and the new record into the
+// (erased) spare bank, then commit it with the next generation. Until the
+// generation word is programmed the active bank stays authoritative.
+static bool transferBank(const uint8_t slot, const uint32_t *payload) {
+  const uint8_t spare = g_activeBank ^ 1U;
+  // From here on a failure leaves the spare bank dirty.
+  g_erasePending = true;
+  uint16_t offset = kHeaderWords;
+  for (uint8_t s = 0U; s < kPatchSlots; ++s) {
+    if (s == slot || g_patchIndex[s] == 0U) {
+      continue;
+    }
+    uint32_t copy[kPayloadWords];
+    readPayload(g_activeBank, g_patchIndex[s], copy);
+    const uint32_t commit = patchFlashRead(g_activeBank, static_cast<uint16_t>(g_patchIndex[s] + kPayloadWords));
+    if (!programRecord(spare, offset, copy, commit)) {
+      return false;
+    }
+    offset = static_cast<uint16_t>(offset + kRecordWords);
+  }
+  if (!programRecord(spare, offset, payload, commitWord(slot, payload)) || !writeHeader(spare, g_generation + 1U)) {
+    return false;
+  }
+  g_activeBank = spare;
+  ++g_generation;
+  ++g_storeStats.compactions;
+  scanBank(spare, false);
+  return true;
+}
+
+bool patchStoreInit() {
+  g_storeStats = PatchStoreStats();
+  g_storeReady = false;
+  g_erasePending = false;
+  g_writePending = false;
+  const uint32_t bankBytes = patchFlashBankBytes();
+  if (bankBytes < kMinBankBytes || bankBytes / 4U > 0xFFFFU) {
+    return false;
+  }
+  g_bankWords = static_cast<uint16_t>(bankBytes / 4U);
+  g_storeStats.bankBytes = bankBytes;
+
+  const bool committed[2] = {bankIsCommitted(0U), bankIsCommitted(1U)};
+  if (!committed[0] && !committed[1]) {
+    // Blank, foreign or torn during the very first format.
+    for (uint8_t bank = 0U; bank < 2U; ++bank) {
+      if (!bankIsBlank(bank) && !eraseBank(bank)) {
+        return false;
+      }
+    }
+    if (!writeHeader(0U, 1U)) {
+      return false;
+    }
+    g_activeBank = 0U;
+    g_generation = 1U;
+  } else {
+    if (committed[0] && committed[1]) {
+      // A transfer committed but the old bank was not erased yet.
+      g_activeBank = (patchFlashRead(1U, 1U) > patchFlashRead(0U, 1U)) ? 1U : 0U;
+    } else {
+      g_activeBank = committed[1] ? 1U : 0U;
+    }
+    g_generation = patchFlashRead(g_activeBank, 1U);
+    g_erasePending = !bankIsBlank(g_activeBank ^ 1U);
+  }
+  scanBank(g_activeBank, true);
+  g_storeReady = true;
+  return true;
+}
+
+bool patchStoreRead(const uint8_t slot, uint8_t *out) {
+  if (!g_storeReady || slot >= kPatchSlots) {
+    return false;
+  }
+  uint32_t words[kPayloadWords];
+  if (g_writePending && slot == g_pendingSlot) {
+    memcpy(words, g_pendingPayload, sizeof(words));
+  } else if (g_patchIndex[slot] != 0U) {
+    readPayload(g_activeBank, g_patchIndex[slot], words);
+  } else {
+    return false;
+  }
+  for (uint16_t i = 0U; i < kPayloadWords; ++i) {
+    for (uint8_t b = 0U; b < 4U; ++b) {
+      out[i * 4U + b] = static_cast<uint8_t>(words[i] >> (8U * b));
+    }
+  }
+  return true;
+}
+
+bool patchStoreWrite(const uint8_t slot, const uint8_t *data) {
+  if (!g_storeReady || slot >= kPatchSlots) {
+    return false;
+  }
+  uint32_t payload[kPayloadWords];
+  packPayload(data, payload);
+  uint8_t stored[kPatchRecordBytes];
+  if (patchStoreRead(slot, stored) && memcmp(stored, data, kPatchRecordBytes) == 0) {
+    ++g_storeStats.unchangedWrites;
+    return true;
+  }
+  if (g_writePending && slot == g_pendingSlot) {
+    // Replace the queued store; it still lands in one transfer.
+    memcpy(g_pendingPayload, payload, sizeof(payload));
+    ++g_storeStats.queuedWrites;
+    return true;
+  }
+  if (static_cast<uint32_t>(g_writeOffset) + kRecordWords > g_bankWords) {
+    if (g_writePending) {
+      // Only one store can wait for the erase.
+      return false;
+    }
+    if (g_erasePending) {
+      // Never erase here (it stalls the CPU); patchStoreService() erases and then stores.
+      g_writePending = true;
+      g_pendingSlot = slot;
+      memcpy(g_pendingPayload, payload, sizeof(payload));
+      ++g_storeStats.queuedWrites;
+      return true;
+    }
+    if (!transferBank(slot, payload)) {
+      return false;
+    }
+  } else {
+    const uint16_t offset = g_writeOffset;
+    // The slot is consumed even if programming fails half way (it cannot be reprogrammed).
+    g_writeOffset = static_cast<uint16_t>(offset + kRecordWords);
+    if (!programRecord(g_activeBank, offset, payload, commitWord(slot, payload))) {
+      return false;
+    }
+    g_patchIndex[slot] = offset;
+  }
+  ++g_storeStats.writes;
+  g_storeStats.payloadBytes += kPatchRecordBytes;
+  return true;
+}
+
+bool patchStoreWritePending() {
+  return g_writePending;
+}
+
+bool patchStoreService() {
+  if (!g_storeReady || !g_erasePending) {
+    return false;
+  }
+  if (!eraseBank(g_activeBank ^ 1U)) {
+    return false;
+  }
+  g_erasePending = false;
+  if (g_writePending) {
+    // The queued store is dropped if the transfer fails, like a failed direct write.
+    g_writePending = false;
+    if (transferBank(g_pendingSlot, g_pendingPayload)) {
+      ++g_storeStats.writes;
+      g_storeStats.payloadBytes += kPatchRecordBytes;
+    }
+  }
+  return true;
+}
+
+void patchStoreGetStats(PatchStoreStats *stats) {
+  *stats = g_storeStats;
+  stats->usedBytes = g_storeReady ? static_cast<uint32_t>(g_writeOffset) * 4U : 0U;
+  stats->pendingWrites = g_writePending ? 1U : 0U;
+}
+
+#if defined(USE_PATCH_FLASH)
+
+// ---------------------------------------------------------------------------
+// STM32 HAL backend (internal flash).
+// The banks must lie outside the sketch: shrink the flash size in the linker
+// script (or board menu) if the sketch could grow into them.
+// ---------------------------------------------------------------------------
+
+#include <Arduino.h>
+
+#if defined(STM32F1xx)
+// STM32F103: 1 KB pages (2 KB on high-density parts); two pages per bank by default.
+#ifndef PATCH_FLASH_BANK_SIZE
+#define PATCH_FLASH_BANK_SIZE 0x800UL
+#endif
+#ifndef PATCH_FLASH_ADDRESS_A
+#define PATCH_FLASH_ADDRESS_A 0x0800F000UL
+#endif
+#ifndef PATCH_FLASH_ADDRESS_B
+#define PATCH_FLASH_ADDRESS_B (PATCH_FLASH_ADDRESS_A + PATCH_FLASH_BANK_SIZE)
+#endif
+#else
+// STM32F411: one 16 KB sector per bank (sectors 2/3), so an erase stalls for
+// about 250 ms instead of 1-2 s for a 128 KB sector. The linker script must
+// keep the sketch out of them (vector table in sectors 0-1, the rest from
+// sector 4) and define _spatchflash; see the readme.
+#ifndef PATCH_FLASH_SECTOR_A
+#define PATCH_FLASH_SECTOR_A FLASH_SECTOR_2
+#endif
+#ifndef PATCH_FLASH_SECTOR_B
+#define PATCH_FLASH_SECTOR_B FLASH_SECTOR_3
+#endif
+#ifndef PATCH_FLASH_ADDRESS_A
+#define PATCH_FLASH_ADDRESS_A 0x08008000UL
+#endif
+#ifndef PATCH_FLASH_ADDRESS_B
+#define PATCH_FLASH_ADDRESS_B 0x0800C000UL
+#endif
+#ifndef PATCH_FLASH_BANK_SIZE
+#define PATCH_FLASH_BANK_SIZE 0x4000UL
+#endif
+#endif
+
+static_assert(PATCH_FLASH_BANK_SIZE >= kMinBankBytes, "PATCH_FLASH_BANK_SIZE is too small for PATCH_SLOTS");
+
+static uint32_t patchFlashAddress(const uint8_t bank, const uint16_t offset) {
+  return ((bank == 0U) ? PATCH_FLASH_ADDRESS_A : PATCH_FLASH_ADDRESS_B) + static_cast<uint32_t>(offset) * 4U;
+}
+
+// Flash image of the sketch as placed by the STM32 core linker scripts: from
+// the start of flash up to the end of the .data load image. A linker script
+// that leaves a hole for the banks below that marks it by defining
+// _spatchflash at the lower bank (weak: address 0 when absent).
+extern "C" uint32_t _sidata;
+extern "C" uint32_t _sdata;
+extern "C" uint32_t _edata;
+extern "C" uint32_t _spatchflash __attribute__((weak));
+
+// Banks inside the sketch image would be erased over its code.
+static bool patchFlashOutsideSketch() {
+  const uint32_t imageEnd = reinterpret_cast<uint32_t>(&_sidata) + (reinterpret_cast<uint32_t>(&_edata) - reinterpret_cast<uint32_t>(&_sdata));
+  const uint32_t lower = (PATCH_FLASH_ADDRESS_A < PATCH_FLASH_ADDRESS_B) ? PATCH_FLASH_ADDRESS_A : PATCH_FLASH_ADDRESS_B;
+  return lower >= imageEnd || reinterpret_cast<uint32_t>(&_spatchflash) == lower;
+}
+
+static uint32_t patchFlashBankBytes() {
+  // A size of 0 makes patchStoreInit() fail, leaving the store unavailable instead of erasing the sketch.
+  return patchFlashOutsideSketch() ? PATCH_FLASH_BANK_SIZE : 0U;
+}
+
+static uint32_t patchFlashRead(const uint8_t bank, const uint16_t offset) {
+  return *reinterpret_cast<const volatile uint32_t *>(patchFlashAddress(bank, offset));
+}
+
+static bool patchFlashProgram(const uint8_t bank, const uint16_t offset, const uint32_t value) {
+  HAL_FLASH_Unlock();
+  const HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, patchFlashAddress(bank, offset), value);
+  HAL_FLASH_Lock();
+  return status == HAL_OK;
+}
+
+static bool patchFlashErase(const uint8_t bank) {
+  FLASH_EraseInitTypeDef erase = {};
+#if defined(STM32F1xx)
+  erase.TypeErase = FLASH_TYPEERASE_PAGES;
+  erase.PageAddress = patchFlashAddress(bank, 0U);
+  erase.NbPages = PATCH_FLASH_BANK_SIZE / FLASH_PAGE_SIZE;
+#else
+  erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+  erase.Sector = (bank == 0U) ? PATCH_FLASH_SECTOR_A : PATCH_FLASH_SECTOR_B;
+  erase.NbSectors = 1U;
+  erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+#endif
+  uint32_t failedAt = 0U;
+  HAL_FLASH_Unlock();
+  const HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &failedAt);
+  HAL_FLASH_Lock();
+  return status == HAL_OK;
+}
+
+#else
+
+// ---------------------------------------------------------------------------
+// Host simulation: NOR flash that only programs erased words, with erase
+// counters and a power-loss countdown.
+// ---------------------------------------------------------------------------
+
+#include <vector>
+
+static std::vector<uint32_t> g_simFlash[2];
+static uint32_t g_simBankBytes = 0U;
+static uint32_t g_simPowerWords = kPatchFlashSimPowerOn;
+static uint32_t g_simEraseCount[2] = {0U, 0U};
+
+static void simEnsureFormatted() {
+  if (g_simBankBytes == 0U) {
+    patchFlashSimFormat(PATCH_FLASH_SIM_BANK_SIZE);
+  }
+}
+
+// One flash operation; false once the power-loss countdown has run out.
+static bool simPowered() {
+  if (g_simPowerWords == kPatchFlashSimPowerOn) {
+    return true;
+  }
+  if (g_simPowerWords == 0U) {
+    return false;
+  }
+  --g_simPowerWords;
+  return true;
+}
+
+bool patchFlashSimFormat(const uint32_t bankBytes) {
+  if (bankBytes == 0U || bankBytes % 4U != 0U || bankBytes > kPatchFlashSimMaxBankBytes) {
+    return false;
+  }
+  g_simBankBytes = bankBytes;
+  for (uint8_t bank = 0U; bank < 2U; ++bank) {
+    g_simFlash[bank].assign(bankBytes / 4U, kErasedWord);
+    g_simEraseCount[bank] = 0U;
+  }
+  g_simPowerWords = kPatchFlashSimPowerOn;
+  return true;
+}
+
+void patchFlashSimCutPower(const uint32_t words) {
+  g_simPowerWords = words;
+}
+
+uint32_t patchFlashSimEraseCount(const uint8_t bank) {
+  return (bank < 2U) ? g_simEraseCount[bank] : 0U;
+}
+
+static uint32_t patchFlashBankBytes() {
+  simEnsureFormatted();
+  return g_simBankBytes;
+}
+
+static uint32_t patchFlashRead(const uint8_t bank, const uint16_t offset) {
+  return g_simFlash[bank][offset];
+}
+
+static bool patchFlashProgram(const uint8_t bank, const uint16_t offset, const uint32_t value) {
+  uint32_t &word = g_simFlash[bank][offset];
+  // Like the F1 controller, refuse to program a word that is not erased.
+  if (word != kErasedWord || !simPowered()) {
+    return false;
+  }
+  word = value;
+  return true;
+}
+
+static bool patchFlashErase(const uint8_t bank) {
+  if (!simPowered()) {
+    return false;
+  }
+  g_simFlash[bank].assign(g_simBankBytes / 4U, kErasedWord);
+  ++g_simEraseCount[bank];
+  return true;
+}
+
+#endif
+
+#endif
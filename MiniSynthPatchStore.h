@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MiniSynthBuildProfile.h"
+
+// Wear-levelled patch storage in emulated EEPROM (two flash banks, log structured).
+//
+// Each write appends a fixed-size record (slot, payload, commit word with a CRC)
+// to the active bank, so repeated stores to the same slot walk across the bank
+// instead of erasing it. When the active bank is full, the newest record of
+// every slot is copied to the other bank, which then becomes active (a higher
+// generation in its header); the old bank is erased later by
+// patchStoreService(). A RAM index keeps the newest record of each slot, so a
+// read is a constant-time copy.
+//
+// Power loss is tolerated at any point: the commit word is programmed last, so
+// a torn record fails its CRC and is skipped, and a bank without a complete
+// header is ignored (the previous bank is still valid).
+//
+// Programming a word stalls flash reads (and so the audio interrupt) for tens
+// of microseconds; erasing a bank stalls them for milliseconds (F103 pages) to
+// about 250 ms (F411 16 KB sectors; 1-2 s for a 128 KB sector). Reads never touch the flash controller and
+// writes never erase: a store that needs a transfer while the spare bank is
+// still dirty is queued in RAM (one store) and finished by patchStoreService()
+// right after its erase. A queued store is lost on power loss (the slot keeps
+// its old patch).
+//
+// Nothing runs while an erase stalls the flash, including the audio, MIDI UART
+// and key scan interrupts: MIDI that arrives during the erase is lost (the
+// USART keeps one byte, the rest overrun) and keys pressed meanwhile are late
+// or missed. The firmware therefore only calls patchStoreService() after
+// PATCH_ERASE_IDLE_MS without sounding voices, MIDI channel messages or key
+// changes.
+//
+// Build switches:
+//  - USE_PATCH_FLASH      : STM32 HAL backend. F4: sectors PATCH_FLASH_SECTOR_A/B (default 2/3,
+//                           16 KB each at 0x08008000 / 0x0800C000; the linker script must place the
+//                           sketch around them and define _spatchflash, see the readme).
+//                           F1: PATCH_FLASH_BANK_SIZE bytes at PATCH_FLASH_ADDRESS_A/B
+//                           (default 2 KB each at the top of 64 KB).
+//                           Banks that overlap the sketch image make patchStoreInit() fail.
+//  - PATCH_FLASH_HOST_SIM : host simulation of NOR flash (bits only clear when programming)
+//                           with wear counters and power-loss injection.
+// Without either, the store is unavailable: patchStoreInit() returns false and
+// reads/writes fail.
+
+// Number of slots (Program Change numbers 0..PATCH_SLOTS-1 can be stored).
+#ifndef PATCH_SLOTS
+#define PATCH_SLOTS 128
+#endif
+
+// Payload bytes per record (multiple of 4).
+constexpr size_t kPatchRecordBytes = 20U;
+constexpr uint8_t kPatchSlots = PATCH_SLOTS;
+static_assert(kPatchSlots >= 1U && kPatchSlots <= 128U, "PATCH_SLOTS must be 1..128");
+
+/**
+ * @brief Storage counters since patchStoreInit().
+ */
+struct PatchStoreStats {
+  uint32_t writes;          //!< Records appended by patchStoreWrite().
+  uint32_t unchangedWrites; //!< Writes skipped because the slot already held the same payload.
+  uint32_t payloadBytes;    //!< Payload bytes of the appended records (writes * kPatchRecordBytes).
+  uint32_t programmedBytes; //!< Bytes programmed into flash (records, compaction copies, headers).
+  uint32_t erases;          //!< Bank erases.
+  uint32_t compactions;     //!< Bank transfers (active bank full).
+  uint32_t corruptRecords;  //!< Records skipped by the start-up scan (torn writes).
+  uint32_t queuedWrites;    //!< Writes queued until patchStoreService() erased the spare bank.
+  uint32_t pendingWrites;   //!< Queued writes not yet programmed (0 or 1).
+  uint32_t bankBytes;       //!< Size of one bank.
+  uint32_t usedBytes;       //!< Bytes in use in the active bank (header and records).
+};
+
+/**
+ * @brief Scan the flash, recover from an interrupted write or transfer and build the index.
+ *
+ * Call before audio starts (a blank or unreadable store is formatted, which erases).
+ * @return false if no backend is configured or the flash could not be formatted.
+ */
+bool patchStoreInit();
+
+/**
+ * @brief Copy the newest payload of `slot`.
+ * @param out kPatchRecordBytes bytes.
+ * @return false if the slot was never written (or the store is unavailable).
+ */
+bool patchStoreRead(uint8_t slot, uint8_t *out);
+
+/**
+ * @brief Append a payload for `slot` (control context; may transfer banks when full, never erases).
+ *
+ * If the active bank is full and the spare bank still needs its erase, the
+ * store is queued and lands in the next patchStoreService(); reads already
+ * return the queued payload.
+ * @param data kPatchRecordBytes bytes.
+ * @return false if the store is unavailable, programming failed, or another slot's store is already queued.
+ */
+bool patchStoreWrite(uint8_t slot, const uint8_t *data);
+
+/**
+ * @brief True while a queued store waits for patchStoreService() (stores to other slots are refused meanwhile).
+ */
+bool patchStoreWritePending();
+
+/**
+ * @brief Erase the spare bank if a transfer left it dirty, then finish a queued store.
+ *
+ * The erase stalls the CPU (and every interrupt), so call it from control context when the output is silent.
+ * @return true if an erase was performed.
+ */
+bool patchStoreService();
+
+/**
+ * @brief Copy the storage counters.
+ */
+void patchStoreGetStats(PatchStoreStats *stats);
+
+#if defined(PATCH_FLASH_HOST_SIM)
+// Default size of one simulated bank.
+#ifndef PATCH_FLASH_SIM_BANK_SIZE
+#define PATCH_FLASH_SIM_BANK_SIZE 4096
+#endif
+
+// Largest simulated bank (the F411 128 KB sector).
+constexpr uint32_t kPatchFlashSimMaxBankBytes = 131072U;
+
+// patchFlashSimCutPower() argument that restores power.
+constexpr uint32_t kPatchFlashSimPowerOn = 0xFFFFFFFFUL;
+
+/**
+ * @brief Erase the simulated flash and set the bank size (call patchStoreInit() afterwards).
+ * @return false if the size is not a multiple of 4 or exceeds kPatchFlashSimMaxBankBytes.
+ */
+bool patchFlashSimFormat(uint32_t bankBytes);
+
+/**
+ * @brief Simulate power loss after `words` more programmed words: later programming and erases are lost.
+ */
+void patchFlashSimCutPower(uint32_t words);
+
+/**
+ * @brief Erase cycles of a simulated bank (0 or 1) since patchFlashSimFormat().
+ */
+uint32_t patchFlashSimEraseCount(uint8_t bank);
+#endif
@@ -0,0 +1,103 @@
+#include <Arduino.h>
+
+#include "MiniSynthPots.h"
+
+namespace mini_synth {
+namespace {
+/**
+ * @brief 各ポットのフィルタ状態。
+ */
+PotFilter g_potFilters[kPotCount];
+
+/**
+ * @brief 直前の potsUpdate() で値が変化したポットのビットマスク。
+ */
+uint8_t g_potChangedMask = 0U;
+
+/**
+ * @brief 平均値を 1 ポット分取り込み、変化を記録する。
+ */
+void acceptPotValue(const uint8_t pot, const uint16_t value12) {
+  if (g_potFilters[pot].update(value12)) {
+    g_potChangedMask |= static_cast<uint8_t>(1U << pot);
+  }
+}
+}  // namespace
+}  // namespace mini_synth
+
+#if defined(USE_ADC_DMA)
+
+// ---------------------------------------------------------------------------
+// NUCLEO-F411RE HAL backend.
+// This code assumes ADC1 was generated with CubeMX in scan + continuous mode
+// with kPotCount regular ranks in PotId order (A0, A1, A2, A3, A4), 12-bit
+// resolution, a long sample time (e.g. 480 cycles) and its DMA stream in
+// circular half-word mode, and that MX_ADC1_Init() has been called so the
+// handle (hadc1) exists. The DMA interrupt is not needed.
+// ---------------------------------------------------------------------------
+
+#include "stm32f4xx_hal.h"
+
+extern ADC_HandleTypeDef hadc1; // provided by CubeMX: ADC1 handle
+
+namespace mini_synth {
+namespace {
+// POT_OVERSAMPLE scans of all pots, written continuously by the DMA controller.
+volatile uint16_t g_adcDmaBuf[POT_OVERSAMPLE][kPotCount] __attribute__((aligned(4)));
+}  // namespace
+
+void potsInit() {
+  HAL_ADC_Start_DMA(&hadc1, reinterpret_cast<uint32_t *>(const_cast<uint16_t *>(&g_adcDmaBuf[0][0])), POT_OVERSAMPLE * kPotCount);
+}
+
+void potsUpdate() {
+  g_potChangedMask = 0U;
+  // DMA が書き込み中の行が混ざっても、平均に新旧のサンプルが混ざるだけで問題ない。
+  for (uint8_t pot = 0; pot < kPotCount; ++pot) {
+    acceptPotValue(pot, averagePotScans(g_adcDmaBuf, pot));
+  }
+}
+
+}  // namespace mini_synth
+
+#else
+
+// ---------------------------------------------------------------------------
+// Polled fallback (analogRead, 10-bit) used without USE_ADC_DMA and on the host.
+// ---------------------------------------------------------------------------
+
+namespace mini_synth {
+namespace {
+const uint8_t kPotPins[kPotCount] = {kOscSelectPin, kAttackPin, kReleasePin, kFilterPin, kResonancePin};
+}  // namespace
+
+void potsInit() {
+  for (uint8_t pot = 0; pot < kPotCount; ++pot) {
+    pinMode(kPotPins[pot], INPUT);
+  }
+}
+
+void potsUpdate() {
+  g_potChangedMask = 0U;
+  for (uint8_t pot = 0; pot < kPotCount; ++pot) {
+    // 10bit を 12bit スケールへ（フルスケールは 4092 = 0x3FF << 2 になるため上端で揃える）。
+    const uint16_t raw = static_cast<uint16_t>(analogRead(kPotPins[pot]));
+    acceptPotValue(pot, (raw >= kAdcMax) ? kPotFullScale : static_cast<uint16_t>(raw << 2U));
+  }
+}
+
+}  // namespace mini_synth
+
+#endif
+
+namespace mini_synth {
+
+uint16_t readPot(const PotId id) {
+  return g_potFilters[static_cast<uint8_t>(id)].value10();
+}
+
+bool potChanged(const PotId id) {
+  return (g_potChangedMask & (1U << static_cast<uint8_t>(id))) != 0U;
+}
+
+}  // namespace mini_synth
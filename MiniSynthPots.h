@@ -0,0 +1,121 @@
+#pragma once
+
+#include "MiniSynthTypes.h"
+
+// ポット（アナログ入力）の取り込み。
+//
+// -DUSE_ADC_DMA=1 : ADC1 のスキャン変換を循環 DMA で回し続け、コントロール周期では
+//                   DMA バッファを平均するだけにする（変換待ちなし。CubeMX で ADC1 の設定が必要）。
+// 未定義時        : analogRead() で 1 周期に 1 回ずつ読み取る（ホストビルドもこちら）。
+// どちらの場合も、平均値にヒステリシスをかけてから値を更新し、変化したポットを通知します。
+
+// DMA バッファに保持するスキャン回数（ポットごとの平均サンプル数）
+#ifndef POT_OVERSAMPLE
+#define POT_OVERSAMPLE 8
+#endif
+
+// 値を更新するのに必要な変化量（12bit スケールの LSB、既定は 10bit 換算で 3LSB）
+#ifndef POT_HYSTERESIS
+#define POT_HYSTERESIS 12
+#endif
+
+namespace mini_synth {
+
+/**
+ * @brief ポットの識別子（DMA のスキャン順と同じ並び）。
+ */
+enum class PotId : uint8_t {
+  kOscSelect = 0, //!< 波形選択（kOscSelectPin）。
+  kAttack,        //!< アタック（kAttackPin）。
+  kRelease,       //!< リリース（kReleasePin）。
+  kFilter,        //!< カットオフ（kFilterPin）。
+  kResonance,     //!< レゾナンス（kResonancePin）。
+};
+
+/**
+ * @brief ポットの数。
+ */
+constexpr uint8_t kPotCount = static_cast<uint8_t>(PotId::kResonance) + 1U;
+
+/**
+ * @brief フィルタ内部で扱うフルスケール（12bit）。
+ */
+constexpr uint16_t kPotFullScale = 4095U;
+
+/**
+ * @brief 平均値にヒステリシスをかける 1 ポット分のフィルタ（ハードウェア非依存）。
+ *
+ * 値は 12bit スケールで保持し、前回採用した値から POT_HYSTERESIS を超えて動いたときだけ更新します。
+ * 入力が 0 または kPotFullScale に達したときだけは差が小さくても端の値へ寄せるため、0 と kAdcMax に
+ * 届かなくなることはありません（端の手前では通常どおりヒステリシスがかかり、1LSB のノイズでちらつかない）。
+ */
+struct PotFilter {
+  uint16_t held = 0U;  //!< 採用中の値（12bit）。
+  bool primed = false; //!< 1 回以上更新済みか。
+
+  /**
+   * @brief 平均値を取り込む。
+   * @param value 平均済みの入力値（12bit、0..kPotFullScale）。
+   * @return 採用値が変化した場合は true。
+   */
+  bool update(const uint16_t value) {
+    const int32_t diff = static_cast<int32_t>(value) - static_cast<int32_t>(held);
+    const int32_t distance = (diff < 0) ? -diff : diff;
+    const bool atEnd = value == 0U || value == kPotFullScale;
+    if (!primed || distance > POT_HYSTERESIS || (atEnd && distance != 0)) {
+      held = value;
+      primed = true;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief 採用値を 10bit（0..kAdcMax）で返す。
+   */
+  uint16_t value10() const {
+    return static_cast<uint16_t>(held >> 2U);
+  }
+};
+
+/**
+ * @brief DMA バッファの POT_OVERSAMPLE 回分のスキャンから 1 ポットの平均値を求める（ハードウェア非依存）。
+ * @param scans スキャン順に並んだ変換結果（12bit）。
+ * @param pot ポット番号（PotId の値）。
+ * @return 平均値（12bit、端数切り捨て）。
+ */
+inline uint16_t averagePotScans(const volatile uint16_t (&scans)[POT_OVERSAMPLE][kPotCount], const uint8_t pot) {
+  uint32_t sum = 0U;
+  for (uint8_t scan = 0; scan < POT_OVERSAMPLE; ++scan) {
+    sum += scans[scan][pot];
+  }
+  return static_cast<uint16_t>(sum / POT_OVERSAMPLE);
+}
+
+/**
+ * @brief ポットの取り込みを開始する（DMA 版は変換を開始し、以降は CPU を使わない）。
+ */
+void potsInit();
+
+/**
+ * @brief 最新の変換結果を平均・ヒステリシス処理して各ポットの値を更新する（コントロール側）。
+ *
+ * DMA 版は変換を待たず、バッファの読み出しと加算だけを行います。
+ */
+void potsUpdate();
+
+/**
+ * @brief ポットの値を取得する（ブロックしない）。
+ * @param id ポット。
+ * @return 0..kAdcMax の値。
+ */
+uint16_t readPot(PotId id);
+
+/**
+ * @brief 直前の potsUpdate() で値が変化したかどうか。
+ * @param id ポット。
+ * @return 変化していれば true。
+ */
+bool potChanged(PotId id);
+
+}  // namespace mini_synth
@@ -0,0 +1,141 @@
+// MiniSynthProfiler.cpp
+#include "MiniSynthProfiler.h"
+
+namespace {
+
+#if SYNTH_PROFILE
+struct ZoneStats {
+  uint32_t count;
+  uint32_t last;
+  uint32_t max;
+  uint64_t total;
+  uint32_t histogram[kProfileBuckets];
+};
+
+// Not allocated with SYNTH_PROFILE=0 (the zones record nothing).
+ZoneStats s_zones[kProfileZoneCount];
+uint32_t s_deadlineMisses = 0;
+#endif
+float s_cycleFrequency = 0.0f;
+// Cycle budget of one sample; 0 until profileInit() (no deadline check).
+uint32_t s_cyclesPerSample = 0;
+
+const char *const kZoneNames[kProfileZoneCount] = {
+    "render", "osc", "filter", "mix/clip", "scope", "envelope", "display", "control",
+};
+
+#if SYNTH_PROFILE
+inline uint8_t bucketIndex(const uint32_t cycles) {
+  if (cycles < 4U) {
+    return static_cast<uint8_t>(cycles);
+  }
+  // 4 buckets per octave: the two bits below the leading one select the sub-bucket.
+  const uint32_t msb = 31U - static_cast<uint32_t>(__builtin_clz(cycles));
+  const uint32_t index = 4U * (msb - 1U) + ((cycles >> (msb - 2U)) & 3U);
+  return static_cast<uint8_t>((index < kProfileBuckets) ? index : (kProfileBuckets - 1U));
+}
+#endif
+
+}  // namespace
+
+void profileInit(uint32_t audioRate) {
+  cycleCounterInit();
+  s_cycleFrequency = cycleCounterFrequency();
+  s_cyclesPerSample = (audioRate != 0U) ? static_cast<uint32_t>(s_cycleFrequency / static_cast<float>(audioRate)) : 0U;
+  profileReset();
+}
+
+float profileCycleFrequency() {
+  return s_cycleFrequency;
+}
+
+uint32_t profileCyclesPerSample() {
+  return s_cyclesPerSample;
+}
+
+void profileRecord(ProfileZone zone, uint32_t cycles) {
+#if SYNTH_PROFILE
+  ZoneStats &stats = s_zones[static_cast<uint8_t>(zone)];
+  ++stats.count;
+  stats.last = cycles;
+  if (cycles > stats.max) {
+    stats.max = cycles;
+  }
+  stats.total += cycles;
+  ++stats.histogram[bucketIndex(cycles)];
+#else
+  (void)zone;
+  (void)cycles;
+#endif
+}
+
+void profileEndBlock(uint32_t start, uint32_t frames) {
+#if SYNTH_PROFILE
+  const uint32_t cycles = cycleCounterRead() - start;
+  profileRecord(ProfileZone::kRender, cycles);
+  if (s_cyclesPerSample != 0U && cycles > s_cyclesPerSample * frames) {
+    ++s_deadlineMisses;
+  }
+#else
+  (void)start;
+  (void)frames;
+#endif
+}
+
+void profileGetSummary(ProfileZone zone, ProfileSummary *summary) {
+#if !SYNTH_PROFILE
+  (void)zone;
+  *summary = ProfileSummary();
+#else
+  const ZoneStats &stats = s_zones[static_cast<uint8_t>(zone)];
+  summary->count = stats.count;
+  summary->last = stats.last;
+  summary->max = stats.max;
+  summary->average = (stats.count != 0U) ? static_cast<float>(stats.total) / static_cast<float>(stats.count) : 0.0f;
+  summary->deadlineMisses = (zone == ProfileZone::kRender) ? s_deadlineMisses : 0U;
+
+  // Walk the histogram up to the bucket that holds the 99th percentile.
+  summary->p99 = 0U;
+  const uint32_t threshold = stats.count - stats.count / 100U;
+  uint32_t cumulative = 0U;
+  for (uint8_t bucket = 0; bucket < kProfileBuckets && stats.count != 0U; ++bucket) {
+    cumulative += stats.histogram[bucket];
+    if (cumulative >= threshold) {
+      const uint32_t upper = (bucket + 1U < kProfileBuckets) ? profileBucketLowerBound(bucket + 1U) - 1U : stats.max;
+      summary->p99 = (upper < stats.max) ? upper : stats.max;
+      break;
+    }
+  }
+#endif
+}
+
+uint32_t profileHistogram(ProfileZone zone, uint8_t bucket) {
+#if SYNTH_PROFILE
+  return (bucket < kProfileBuckets) ? s_zones[static_cast<uint8_t>(zone)].histogram[bucket] : 0U;
+#else
+  (void)zone;
+  (void)bucket;
+  return 0U;
+#endif
+}
+
+uint32_t profileBucketLowerBound(uint8_t bucket) {
+  if (bucket < 4U) {
+    return bucket;
+  }
+  const uint32_t msb = bucket / 4U + 1U;
+  return (4U | (bucket & 3U)) << (msb - 2U);
+}
+
+const char *profileZoneName(ProfileZone zone) {
+  return kZoneNames[static_cast<uint8_t>(zone)];
+}
+
+void profileReset() {
+#if SYNTH_PROFILE
+  for (ZoneStats &stats : s_zones) {
+    stats = ZoneStats();
+  }
+  s_deadlineMisses = 0U;
+#endif
+}
@@ -0,0 +1,138 @@
+// MiniSynthProfiler.h
+#pragma once
+#include <Arduino.h>
+
+#include "MiniSynthBuildProfile.h"
+#include "MiniSynthCycles.h"
+
+/**
+ * Cycle-accurate per-stage profiler (DWT CYCCNT on Cortex-M, TSC/steady_clock on host).
+ *
+ * Usage:
+ *  - Call profileInit(kAudioRate) once before the audio interrupt starts.
+ *  - Wrap a stage with
+ *        const uint32_t start = profileBegin();
+ *        ...
+ *        profileEnd(ProfileZone::kFilter, start);
+ *    Zones may nest; each one only stores its own duration.
+ *  - The block renderer reports through profileEndBlock(start, frames), which also
+ *    counts a deadline miss when the block took longer than `frames` sample periods.
+ *  - Read results from control context with profileGetSummary() / profileHistogram().
+ *    Nothing in the measurement path prints or disables interrupts; a summary read
+ *    while the audio interrupt updates the same zone may be off by one sample.
+ *
+ * Build-time options:
+ *  - SYNTH_PROFILE=0 compiles the zones away (profileBegin() returns 0, profileEnd() is empty)
+ *    and drops the statistics (summaries read as zero). profileInit() still computes the
+ *    per-sample budget used by the start-up headroom check.
+ */
+
+#ifndef SYNTH_PROFILE
+#define SYNTH_PROFILE 1
+#endif
+
+/**
+ * Measured stages. kRender is the whole block render (the audio deadline);
+ * the other audio zones are nested inside it.
+ */
+enum class ProfileZone : uint8_t {
+  kRender = 0,   //!< renderBlock(): one block, checked against the deadline.
+  kOscillator,   //!< Voice kernels (oscillator, envelope gain, per-voice SVF).
+  kFilter,       //!< Global SVF (with GLOBAL_SVF it includes the fused soft clip).
+  kMixClip,      //!< Mix buffer clear and (without GLOBAL_SVF) output saturation; event application is only in kRender.
+  kScopePush,    //!< scopePushSample() from the audio callback.
+  kEnvelope,     //!< Control-side envelope/portamento update of all allocated voices.
+  kDisplay,      //!< Display frame: snapshot, composition and dirty-tile scan (transfer runs asynchronously).
+  kControlTick,  //!< Whole handleControl().
+};
+
+constexpr uint8_t kProfileZoneCount = static_cast<uint8_t>(ProfileZone::kControlTick) + 1U;
+
+/**
+ * Histogram resolution: 4 buckets per power of two (<= 19% wide), values up to 2^24 cycles;
+ * longer durations land in the last bucket.
+ */
+constexpr uint8_t kProfileBuckets = 96U;
+
+/**
+ * Statistics of one zone since the last profileReset().
+ */
+struct ProfileSummary {
+  uint32_t count;       //!< Number of measurements.
+  uint32_t last;        //!< Most recent duration [cycles].
+  uint32_t max;         //!< Worst case [cycles].
+  uint32_t p99;         //!< 99th percentile (upper edge of its histogram bucket) [cycles].
+  float average;        //!< Mean duration [cycles].
+  uint32_t deadlineMisses; //!< kRender only: blocks that overran their frames * sample period.
+};
+
+/**
+ * Start the cycle counter and compute the per-sample deadline.
+ * Calibrates the counter on hosts, so call it before audio starts.
+ * @param audioRate Audio sample rate in Hz (e.g. kAudioRate).
+ */
+void profileInit(uint32_t audioRate);
+
+/**
+ * Counter rate in Hz determined by profileInit().
+ */
+float profileCycleFrequency();
+
+/**
+ * Cycle budget of one audio sample (counter rate / audio rate).
+ */
+uint32_t profileCyclesPerSample();
+
+inline uint32_t profileBegin() {
+#if SYNTH_PROFILE
+  return cycleCounterRead();
+#else
+  return 0U;
+#endif
+}
+
+/**
+ * Record the duration since `start` into `zone`.
+ */
+void profileRecord(ProfileZone zone, uint32_t cycles);
+
+inline void profileEnd(ProfileZone zone, uint32_t start) {
+#if SYNTH_PROFILE
+  profileRecord(zone, cycleCounterRead() - start);
+#else
+  (void)zone;
+  (void)start;
+#endif
+}
+
+/**
+ * Record a block render into ProfileZone::kRender and check it against the deadline.
+ * @param start Value returned by profileBegin() before rendering.
+ * @param frames Number of frames the block produced.
+ */
+void profileEndBlock(uint32_t start, uint32_t frames);
+
+/**
+ * Copy the statistics of `zone`.
+ */
+void profileGetSummary(ProfileZone zone, ProfileSummary *summary);
+
+/**
+ * Number of measurements of `zone` that fell into `bucket` (0..kProfileBuckets-1).
+ */
+uint32_t profileHistogram(ProfileZone zone, uint8_t bucket);
+
+/**
+ * Lowest duration [cycles] counted in `bucket`.
+ */
+uint32_t profileBucketLowerBound(uint8_t bucket);
+
+/**
+ * Short printable name of `zone` ("render", "osc", ...).
+ */
+const char *profileZoneName(ProfileZone zone);
+
+/**
+ * Clear all zones (call from control context; pending audio updates may survive).
+ */
+void profileReset();
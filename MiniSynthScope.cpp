@@ -1,26 +1,191 @@
 #include "MiniSynthScope.h"
 
-static volatile int16_t s_buffer[SCOPE_BUFFER_SIZE];
-static volatile uint16_t s_index = 0;
+#include <string.h>
+
+#if ENABLE_SCOPE
+
+static_assert((SCOPE_BUFFER_SIZE & (SCOPE_BUFFER_SIZE - 1)) == 0, "SCOPE_BUFFER_SIZE must be a power of two");
+
+namespace {
+
+enum class CaptureState : uint8_t {
+  kArmed,     // waiting for the trigger (or the auto timeout)
+  kCapturing, // accumulating points
+};
+
+// ---- raw ring (spectrum) ----
+int16_t s_buffer[SCOPE_BUFFER_SIZE];
+// Total samples written; the ring index is the low bits.
+uint32_t s_written = 0;
+
+// ---- capture frames ----
+// Triple buffer: the producer writes one frame, the consumer holds another and
+// the third is the newest published frame. Publishing and acquiring swap a
+// buffer with the published slot, so neither side ever touches the other's.
+ScopeFrame s_frames[3];
+// Published frame index, with kFresh set until the consumer takes it. Written by both sides atomically.
+constexpr uint8_t kFresh = 0x80;
+uint8_t s_published = 1;
+// Frame held by the consumer, and whether it holds a completed capture yet. Consumer only.
+uint8_t s_held = 2;
+bool s_holding = false;
+
+// Producer state (ISR only).
+CaptureState s_state = CaptureState::kArmed;
+uint8_t s_writeFrame = 0;
+uint16_t s_decimation = SCOPE_DECIMATION;
+ScopeTrigger s_mode = ScopeTrigger::kRising;
+int16_t s_level = 0;
+int16_t s_hysteresis = 512;
+bool s_primed = false;   // the signal was on the far side of the hysteresis band
+bool s_triggered = false;
+uint16_t s_waited = 0;
+uint16_t s_count = 0;    // samples in the current point
+uint16_t s_point = 0;
+int16_t s_min = 0;
+int16_t s_max = 0;
+uint32_t s_sequence = 0;
+
+// Settings requested by the control side, applied when the producer re-arms.
+volatile uint16_t s_requestedDecimation = SCOPE_DECIMATION;
+volatile ScopeTrigger s_requestedMode = ScopeTrigger::kRising;
+volatile int16_t s_requestedLevel = 0;
+volatile int16_t s_requestedHysteresis = 512;
+
+void arm() {
+  s_decimation = s_requestedDecimation;
+  s_mode = s_requestedMode;
+  s_level = s_requestedLevel;
+  s_hysteresis = s_requestedHysteresis;
+  s_primed = false;
+  s_waited = 0;
+  s_state = CaptureState::kArmed;
+}
+
+// Constant-time trigger test for one sample.
+inline bool triggerHit(int16_t sample) {
+  const int32_t s = sample;
+  switch (s_mode) {
+    case ScopeTrigger::kRising:
+      if (s < static_cast<int32_t>(s_level) - s_hysteresis) {
+        s_primed = true;
+        return false;
+      }
+      return s_primed && s >= s_level;
+    case ScopeTrigger::kFalling:
+      if (s > static_cast<int32_t>(s_level) + s_hysteresis) {
+        s_primed = true;
+        return false;
+      }
+      return s_primed && s <= s_level;
+    default:
+      return true;
+  }
+}
+
+// Publish the finished frame and continue in the buffer it replaces.
+void publishFrame() {
+  ScopeFrame &frame = s_frames[s_writeFrame];
+  frame.decimation = s_decimation;
+  frame.triggered = s_triggered;
+  frame.sequence = ++s_sequence;
+  // The replaced buffer is either an older unclaimed frame or the one the
+  // consumer gave back; the held frame is never in the published slot.
+  const uint8_t replaced = __atomic_exchange_n(&s_published, static_cast<uint8_t>(s_writeFrame | kFresh), __ATOMIC_ACQ_REL);
+  s_writeFrame = replaced & static_cast<uint8_t>(~kFresh);
+}
+
+}  // namespace
 
 void scopePushSample(int16_t sample) {
-  // Called from ISR; store and advance index atomically (wrap)
-  s_buffer[s_index] = sample;
-  ++s_index;
-  if (s_index >= SCOPE_BUFFER_SIZE) s_index = 0;
+  // Called from ISR.
+  s_buffer[s_written & (SCOPE_BUFFER_SIZE - 1)] = sample;
+  __atomic_store_n(&s_written, s_written + 1, __ATOMIC_RELEASE);
+
+  if (s_state == CaptureState::kArmed) {
+    const bool hit = triggerHit(sample);
+    if (!hit && ++s_waited < SCOPE_AUTO_TIMEOUT) {
+      return;
+    }
+    s_triggered = hit && s_mode != ScopeTrigger::kFreeRun;
+    s_state = CaptureState::kCapturing;
+    s_count = 0;
+    s_point = 0;
+  }
+  if (s_count == 0) {
+    s_min = sample;
+    s_max = sample;
+  } else if (sample < s_min) {
+    s_min = sample;
+  } else if (sample > s_max) {
+    s_max = sample;
+  }
+  if (++s_count < s_decimation) {
+    return;
+  }
+  ScopeFrame &frame = s_frames[s_writeFrame];
+  frame.min[s_point] = s_min;
+  frame.max[s_point] = s_max;
+  s_count = 0;
+  if (++s_point < SCOPE_FRAME_POINTS) {
+    return;
+  }
+  publishFrame();
+  arm();
 }
 
 void scopeSnapshot(int16_t *outBuf, size_t n) {
-  if (n == 0 || n > SCOPE_BUFFER_SIZE) return;
-  // Disable interrupts while copying to ensure consistent snapshot
-  noInterrupts();
-  uint16_t idx = s_index; // next write index
-  // oldest sample is at idx (since idx points to next free)
-  uint16_t start = (idx >= n) ? (idx - n) : (SCOPE_BUFFER_SIZE + idx - n);
-  for (size_t i = 0; i < n; ++i) {
-    uint16_t pos = start + i;
-    if (pos >= SCOPE_BUFFER_SIZE) pos -= SCOPE_BUFFER_SIZE;
-    outBuf[i] = s_buffer[pos];
+  if (n == 0 || n > SCOPE_BUFFER_SIZE / 2) return;
+  for (;;) {
+    const uint32_t end = __atomic_load_n(&s_written, __ATOMIC_ACQUIRE);
+    const uint32_t start = end - static_cast<uint32_t>(n);
+    for (size_t i = 0; i < n; ++i) {
+      outBuf[i] = s_buffer[(start + i) & (SCOPE_BUFFER_SIZE - 1)];
+    }
+    // The copied range is intact unless the writer lapped into it.
+    const uint32_t after = __atomic_load_n(&s_written, __ATOMIC_ACQUIRE);
+    if (after - end <= SCOPE_BUFFER_SIZE - n) {
+      return;
+    }
+  }
+}
+
+const ScopeFrame *scopeAcquireFrame() {
+  if ((__atomic_load_n(&s_published, __ATOMIC_ACQUIRE) & kFresh) != 0) {
+    // Taking the new frame hands the previous one back through the published slot.
+    const uint8_t fresh = __atomic_exchange_n(&s_published, s_held, __ATOMIC_ACQ_REL);
+    s_held = fresh & static_cast<uint8_t>(~kFresh);
+    s_holding = true;
   }
-  interrupts();
+  return s_holding ? &s_frames[s_held] : NULL;
 }
+
+void scopeSetTimebase(uint16_t decimation) {
+  s_requestedDecimation = (decimation == 0) ? 1 : decimation;
+}
+
+void scopeSetTrigger(ScopeTrigger mode, int16_t level, int16_t hysteresis) {
+  s_requestedMode = mode;
+  s_requestedLevel = level;
+  s_requestedHysteresis = (hysteresis < 0) ? 0 : hysteresis;
+}
+
+#else
+
+void scopePushSample(int16_t sample) {
+  (void)sample;
+}
+void scopeSnapshot(int16_t *outBuf, size_t n) {
+  memset(outBuf, 0, n * sizeof(*outBuf));
+}
+const ScopeFrame *scopeAcquireFrame() {
+  return NULL;
+}
+void scopeSetTimebase(uint16_t decimation) {
+  (void)decimation;
+}
+void scopeSetTrigger(ScopeTrigger mode, int16_t level, int16_t hysteresis) {
+  (void)mode; (void)level; (void)hysteresis;
+}
+
+#endif
@@ -1,18 +1,95 @@
 #pragma once
 #include <Arduino.h>
 
-// Simple lock-free circular buffer for last N audio samples.
+#include "MiniSynthBuildProfile.h"
+
+// Oscilloscope capture from the audio callback.
+//
+// Two outputs are fed by scopePushSample():
+//  - a raw ring of the last SCOPE_BUFFER_SIZE samples, copied by scopeSnapshot()
+//    (spectrum analysis);
+//  - triggered capture frames of SCOPE_FRAME_POINTS min/max pairs. Each point
+//    covers `decimation` samples, so the timebase (window length) is chosen
+//    without extra RAM. Capture starts on a level crossing (with hysteresis)
+//    or, if none comes within SCOPE_AUTO_TIMEOUT samples, free-runs (auto mode).
+// Frames are triple-buffered: the producer fills one, the consumer holds one
+// and the third is the newest completed frame. Each side swaps its buffer with
+// that slot using one atomic exchange instead of a noInterrupts() copy, so a
+// held frame never stalls capture and every acquire after a capture gets a
+// newer frame. The per-sample cost is constant (no loop runs in the ISR).
+//
+// With ENABLE_SCOPE=0 (see MiniSynthBuildProfile.h) the buffers are not allocated:
+// scopeAcquireFrame() returns NULL and scopeSnapshot() fills zeros.
+//
 // Usage:
 //  - call scopePushSample(sample) from audio callback (ISR)
-//  - call scopeSnapshot(outBuf, n) from control-rate to copy most recent n samples
+//  - call scopeAcquireFrame() from control context to get the newest frame
+//  - call scopeSnapshot(outBuf, n) from control context for the most recent n raw samples
 
 #ifndef SCOPE_BUFFER_SIZE
 #define SCOPE_BUFFER_SIZE 256
 #endif
 
+// Points (min/max pairs) per capture frame (display width).
+#ifndef SCOPE_FRAME_POINTS
+#define SCOPE_FRAME_POINTS 128
+#endif
+
+// Default samples per point (window = SCOPE_FRAME_POINTS * decimation samples).
+#ifndef SCOPE_DECIMATION
+#define SCOPE_DECIMATION 2
+#endif
+
+// Samples to wait for a trigger before capturing anyway.
+#ifndef SCOPE_AUTO_TIMEOUT
+#define SCOPE_AUTO_TIMEOUT 2048
+#endif
+
+/**
+ * @brief Trigger condition.
+ */
+enum class ScopeTrigger : uint8_t {
+  kFreeRun = 0, //!< Capture continuously.
+  kRising,      //!< Start when the signal rises through the level.
+  kFalling,     //!< Start when the signal falls through the level.
+};
+
+/**
+ * @brief One capture: min/max of each decimated point, oldest..newest.
+ */
+struct ScopeFrame {
+  int16_t min[SCOPE_FRAME_POINTS];
+  int16_t max[SCOPE_FRAME_POINTS];
+  uint16_t decimation; //!< Samples per point.
+  bool triggered;      //!< false if the frame was captured by the auto timeout or in free-run.
+  uint32_t sequence;   //!< Frame counter.
+};
+
 void scopePushSample(int16_t sample);
+
 /**
- * Copy the most recent n samples into outBuf (n <= SCOPE_BUFFER_SIZE).
- * The samples are ordered oldest..newest in the buffer.
+ * Copy the most recent n samples into outBuf (n <= SCOPE_BUFFER_SIZE / 2).
+ * The samples are ordered oldest..newest in the buffer. The copy is retried
+ * if the producer overwrote part of the range meanwhile (no interrupt masking).
  */
 void scopeSnapshot(int16_t *outBuf, size_t n);
+
+/**
+ * @brief Get the newest completed capture frame (control context).
+ *
+ * The returned frame stays valid and unchanged until the next call, which
+ * hands it back to the producer. If no newer frame has completed, the same
+ * frame is returned again.
+ * @return The frame, or NULL before the first capture completes.
+ */
+const ScopeFrame *scopeAcquireFrame();
+
+/**
+ * @brief Set the samples per point (1..65535). Takes effect at the next capture.
+ */
+void scopeSetTimebase(uint16_t decimation);
+
+/**
+ * @brief Set the trigger condition, level and hysteresis. Takes effect at the next capture.
+ */
+void scopeSetTrigger(ScopeTrigger mode, int16_t level, int16_t hysteresis);
@@ -0,0 +1,186 @@
+#include "MiniSynthSpectrum.h"
+
+#if ENABLE_SPECTRUM
+
+namespace {
+
+constexpr size_t kFftSize = SPECTRUM_FFT_SIZE;        // real input length N
+constexpr size_t kHalfSize = kFftSize / 2;            // complex FFT length M = N/2
+constexpr size_t kBands = SPECTRUM_BANDS;
+static_assert((kFftSize & (kFftSize - 1)) == 0 && kFftSize >= 16, "SPECTRUM_FFT_SIZE must be a power of two");
+static_assert(kBands >= 1 && kBands < kHalfSize, "SPECTRUM_BANDS must be smaller than SPECTRUM_FFT_SIZE / 2");
+
+// Averaging / peak decay per analyzer update
+constexpr float kAverageAlpha = 0.35f;
+constexpr float kPeakDecay = 0.92f;
+
+// Precomputed tables (built once in spectrumInit)
+int16_t s_cos[kHalfSize];       // cos(2*pi*k/N), Q15
+int16_t s_sin[kHalfSize];       // sin(2*pi*k/N), Q15
+int16_t s_window[kFftSize];     // Hann window, Q15
+uint8_t s_bitReverse[kHalfSize];
+uint8_t s_bandStart[kBands + 1]; // first FFT bin of each band (last entry = end)
+
+// Work buffers
+int32_t s_re[kHalfSize];
+int32_t s_im[kHalfSize];
+
+float s_bands[kBands];
+float s_peaks[kBands];
+
+inline int32_t mulQ15(int32_t a, int32_t b) {
+  return (a * b) >> 15;
+}
+
+// Cheap magnitude estimate: max + 3/8 * min (within ~4%)
+inline uint32_t magnitude(int32_t re, int32_t im) {
+  uint32_t a = (re < 0) ? -re : re;
+  uint32_t b = (im < 0) ? -im : im;
+  if (a < b) {
+    const uint32_t t = a; a = b; b = t;
+  }
+  return a + ((b * 3U) >> 3);
+}
+
+// In-place radix-2 DIT FFT over s_re/s_im (length M). Each stage halves the
+// values so Q15 input can never overflow; total scaling is 1/M.
+void complexFft() {
+  for (size_t i = 0; i < kHalfSize; ++i) {
+    const size_t j = s_bitReverse[i];
+    if (j > i) {
+      const int32_t tr = s_re[i]; s_re[i] = s_re[j]; s_re[j] = tr;
+      const int32_t ti = s_im[i]; s_im[i] = s_im[j]; s_im[j] = ti;
+    }
+  }
+  for (size_t half = 1; half < kHalfSize; half <<= 1) {
+    // twiddle W_M^k = W_N^(2k); step through the N-point table
+    const size_t step = kFftSize / (2 * half);
+    for (size_t start = 0; start < kHalfSize; start += 2 * half) {
+      for (size_t k = 0; k < half; ++k) {
+        const int32_t c = s_cos[k * step];
+        const int32_t s = s_sin[k * step];
+        const size_t a = start + k;
+        const size_t b = a + half;
+        // t = W * x[b], W = c - j*s
+        const int32_t tr = mulQ15(s_re[b], c) + mulQ15(s_im[b], s);
+        const int32_t ti = mulQ15(s_im[b], c) - mulQ15(s_re[b], s);
+        s_re[b] = (s_re[a] - tr) >> 1;
+        s_im[b] = (s_im[a] - ti) >> 1;
+        s_re[a] = (s_re[a] + tr) >> 1;
+        s_im[a] = (s_im[a] + ti) >> 1;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void spectrumInit() {
+  for (size_t k = 0; k < kHalfSize; ++k) {
+    const float angle = 2.0f * static_cast<float>(M_PI) * static_cast<float>(k) / static_cast<float>(kFftSize);
+    s_cos[k] = static_cast<int16_t>(lroundf(cosf(angle) * 32767.0f));
+    s_sin[k] = static_cast<int16_t>(lroundf(sinf(angle) * 32767.0f));
+  }
+  for (size_t n = 0; n < kFftSize; ++n) {
+    const float angle = 2.0f * static_cast<float>(M_PI) * static_cast<float>(n) / static_cast<float>(kFftSize);
+    s_window[n] = static_cast<int16_t>(lroundf((0.5f - 0.5f * cosf(angle)) * 32767.0f));
+  }
+  uint8_t log2Half = 0;
+  while ((static_cast<size_t>(1) << log2Half) < kHalfSize) {
+    ++log2Half;
+  }
+  for (size_t i = 0; i < kHalfSize; ++i) {
+    size_t r = 0;
+    for (uint8_t b = 0; b < log2Half; ++b) {
+      if (i & (static_cast<size_t>(1) << b)) {
+        r |= static_cast<size_t>(1) << (log2Half - 1 - b);
+      }
+    }
+    s_bitReverse[i] = static_cast<uint8_t>(r);
+  }
+  // Logarithmic band edges over bins 1..M-1 (DC and Nyquist skipped); each band gets at least one bin.
+  const float maxBin = static_cast<float>(kHalfSize);
+  uint8_t prev = 1;
+  s_bandStart[0] = 1;
+  for (size_t b = 1; b <= kBands; ++b) {
+    uint8_t edge = static_cast<uint8_t>(lroundf(powf(maxBin, static_cast<float>(b) / static_cast<float>(kBands))));
+    const uint8_t minEdge = static_cast<uint8_t>(prev + 1);
+    const uint8_t maxEdge = static_cast<uint8_t>(kHalfSize - (kBands - b));
+    if (edge < minEdge) edge = minEdge;
+    if (edge > maxEdge) edge = maxEdge;
+    s_bandStart[b] = edge;
+    prev = edge;
+  }
+  for (size_t b = 0; b < kBands; ++b) {
+    s_bands[b] = 0.0f;
+    s_peaks[b] = 0.0f;
+  }
+}
+
+void spectrumProcess(const int16_t *samples) {
+  // Window and pack even/odd samples into one complex sequence of length M.
+  for (size_t k = 0; k < kHalfSize; ++k) {
+    s_re[k] = mulQ15(samples[2 * k], s_window[2 * k]);
+    s_im[k] = mulQ15(samples[2 * k + 1], s_window[2 * k + 1]);
+  }
+  complexFft();
+
+  // Full-scale sine through the Hann window: |X| = N/4 * 32768, scaled by 1/M in the FFT stages
+  const float norm = 1.0f / (32768.0f * static_cast<float>(kFftSize / 4) / static_cast<float>(kHalfSize));
+  size_t band = 0;
+  uint32_t bandMax = 0;
+  for (size_t k = 1; k < kHalfSize; ++k) {
+    // Split the packed result into the real-input spectrum:
+    // X[k] = Fe + W_N^k * Fo, Fe = (Z[k] + conj(Z[M-k])) / 2, Fo = -j (Z[k] - conj(Z[M-k])) / 2
+    const int32_t zr = s_re[k];
+    const int32_t zi = s_im[k];
+    const int32_t cr = s_re[kHalfSize - k];
+    const int32_t ci = -s_im[kHalfSize - k];
+    const int32_t feR = (zr + cr) >> 1;
+    const int32_t feI = (zi + ci) >> 1;
+    const int32_t foR = (zi - ci) >> 1;
+    const int32_t foI = -((zr - cr) >> 1);
+    const int32_t c = s_cos[k];
+    const int32_t s = s_sin[k];
+    const int32_t xr = feR + mulQ15(foR, c) + mulQ15(foI, s);
+    const int32_t xi = feI + mulQ15(foI, c) - mulQ15(foR, s);
+    const uint32_t mag = magnitude(xr, xi);
+    if (mag > bandMax) bandMax = mag;
+    // Close the band when the next bin belongs to the next one
+    if (k + 1 >= s_bandStart[band + 1]) {
+      float level = static_cast<float>(bandMax) * norm;
+      if (level > 1.0f) level = 1.0f;
+      s_bands[band] += kAverageAlpha * (level - s_bands[band]);
+      s_peaks[band] = (level > s_peaks[band]) ? level : s_peaks[band] * kPeakDecay;
+      bandMax = 0;
+      if (++band >= kBands) break;
+    }
+  }
+}
+
+const float *spectrumBands() {
+  return s_bands;
+}
+
+const float *spectrumPeaks() {
+  return s_peaks;
+}
+
+#else
+
+namespace {
+const float kSilentBands[SPECTRUM_BANDS] = {};
+}  // namespace
+
+void spectrumInit() {}
+void spectrumProcess(const int16_t *samples) {
+  (void)samples;
+}
+const float *spectrumBands() {
+  return kSilentBands;
+}
+const float *spectrumPeaks() {
+  return kSilentBands;
+}
+
+#endif
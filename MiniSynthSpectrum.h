@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+
+#include "MiniSynthBuildProfile.h"
+
+// Fixed-point spectrum analyzer fed from scope snapshots.
+// Usage:
+//  - call spectrumInit() once to build the twiddle, window and band tables
+//  - call spectrumProcess(samples) with SPECTRUM_FFT_SIZE samples from control context.
+//    It is meant to run on a slower cadence than the control rate (see SPECTRUM_DIVIDER).
+//  - read spectrumBands() (decaying average) / spectrumPeaks() (peak hold), 0..1 per band
+//
+// With ENABLE_SPECTRUM=0 (see MiniSynthBuildProfile.h) no tables are allocated and
+// the band levels stay at zero.
+//
+// Pipeline: Hann window -> N/2-point complex radix-2 FFT (Q15, scaled per stage)
+// -> real-FFT split -> magnitude -> log-frequency band grouping -> average/peak decay.
+
+#ifndef SPECTRUM_FFT_SIZE
+#define SPECTRUM_FFT_SIZE 128
+#endif
+
+#ifndef SPECTRUM_BANDS
+#define SPECTRUM_BANDS 16
+#endif
+
+// Run the analyzer every N control ticks (64Hz / 4 = 16 updates per second)
+#ifndef SPECTRUM_DIVIDER
+#define SPECTRUM_DIVIDER 4
+#endif
+
+void spectrumInit();
+
+/**
+ * Analyze SPECTRUM_FFT_SIZE samples (oldest..newest) and update band levels.
+ */
+void spectrumProcess(const int16_t *samples);
+
+/**
+ * Band levels with average decay, SPECTRUM_BANDS entries (0..1, 1 = full-scale sine).
+ */
+const float *spectrumBands();
+
+/**
+ * Band levels with peak hold and slow decay, SPECTRUM_BANDS entries (0..1).
+ */
+const float *spectrumPeaks();
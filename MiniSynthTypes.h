@@ -2,28 +2,156 @@
 
 #include <Arduino.h>
 
+#include "MiniSynthBuildProfile.h"
+#include "MiniSynthEventQueue.h"
+
+// ビルド時に以下のマクロでフィルタ方式を切り替えできます（既定値は MiniSynthBuildProfile.h のプロファイルで変わります）。
+// 定義例:
+// -DGLOBAL_SVF : ミックス後にグローバルな SVF を適用（デフォルト）
+// -DVOICE_SVF  : 各ボイスごとに SVF を持ち、キー追従でカットオフを変化させる
+#ifndef GLOBAL_SVF
+#define GLOBAL_SVF 1
+#endif
+
+#ifndef VOICE_SVF
+#define VOICE_SVF 0
+#endif
+
+// -DSVF_FIXED_POINT=1 : SVF を固定小数点（Q15 係数 + 飽和演算）で実行する（FPU なしの MCU 向け）
+#ifndef SVF_FIXED_POINT
+#define SVF_FIXED_POINT 0
+#endif
+
+// -DAUDIO_RATE=n : オーディオサンプルレート [Hz]（16384 / 32768 / 48000）。テーブル・係数・Mozzi の設定はすべてここから求める
+#ifndef AUDIO_RATE
+#define AUDIO_RATE 16384
+#endif
+
+// -DRENDER_BUDGET_PERCENT=n : 全ボイス発音時のレンダリングに使ってよいサンプル周期の割合 [%]（起動時の自己診断の基準）
+#ifndef RENDER_BUDGET_PERCENT
+#define RENDER_BUDGET_PERCENT 75
+#endif
+
+// -DMAX_VOICES=n : 最大同時発音数（1..32）
+#ifndef MAX_VOICES
+#define MAX_VOICES 4
+#endif
+
+// -DEVENT_QUEUE_SIZE=n : コントロール→オーディオのイベントキュー容量（2 の冪、2 * MAX_VOICES + 16 以上）
+#ifndef EVENT_QUEUE_SIZE
+#if MAX_VOICES > 24
+#define EVENT_QUEUE_SIZE 128
+#else
+#define EVENT_QUEUE_SIZE 64
+#endif
+#endif
+
+// -DKEY_MATRIX=1 : 鍵盤を 5x6 のダイオード付きマトリクスとしてスキャンする（0 は従来の 5 鍵直結）
+#ifndef KEY_MATRIX
+#define KEY_MATRIX 0
+#endif
+
+// -DOSC_BANDLIMITED=0 : 波形選択ポットで Saw/Pulse/Square の素朴な（帯域制限なし）版を選ぶ
+#ifndef OSC_BANDLIMITED
+#define OSC_BANDLIMITED 1
+#endif
+
+// -DUNISON_VOICES=n : ユニゾン時に 1 ボイスへ重ねるデチューン済みサブオシレータ数（偶数 2..8、0 で無効）
+#ifndef UNISON_VOICES
+#define UNISON_VOICES 4
+#endif
+
+// -DPATCH_ERASE_IDLE_MS=n : パッチ用フラッシュの消去を始めるまでに必要な無操作時間 [ms]（発音・MIDI チャンネルメッセージ・鍵盤操作なし）
+#ifndef PATCH_ERASE_IDLE_MS
+#define PATCH_ERASE_IDLE_MS 1000
+#endif
+
 namespace mini_synth {
 
 /**
- * @brief 使用する最大ボイス数。
+ * @brief 使用する最大ボイス数（MAX_VOICES で変更）。
  */
-constexpr uint8_t kMaxVoices = 4U;
+constexpr uint8_t kMaxVoices = MAX_VOICES;
 
 /**
- * @brief オーディオサンプルレート。
+ * @brief ボイスの有効/無効を 1 ボイス 1 bit で表すマスク型。
  */
-constexpr uint16_t kAudioRate = 16384U;
+using VoiceMask = uint32_t;
+static_assert(kMaxVoices >= 1U && kMaxVoices <= 32U, "kMaxVoices must fit in VoiceMask");
+
+/**
+ * @brief ユニゾンのサブオシレータ数（UNISON_VOICES で変更）。
+ *
+ * サブオシレータは 16bit x 2 のパック演算で 2 つずつ処理するため偶数に限ります。
+ */
+constexpr uint8_t kUnisonVoices = UNISON_VOICES;
+static_assert(kUnisonVoices % 2U == 0U && kUnisonVoices <= 8U, "UNISON_VOICES must be 0, 2, 4, 6 or 8");
+
+/**
+ * @brief SVF の状態値の型（SVF_FIXED_POINT に応じて切り替え）。
+ */
+#if SVF_FIXED_POINT
+using SvfValue = int32_t;
+#else
+using SvfValue = float;
+#endif
+
+/**
+ * @brief ボイスが見つからないことを示すインデックス。
+ */
+constexpr uint8_t kNoVoice = 0xFFU;
+
+/**
+ * @brief MIDI ノート番号の数（ノート→ボイス表の大きさ）。
+ */
+constexpr uint8_t kMidiNoteCount = 128U;
+
+/**
+ * @brief オーディオサンプルレート（AUDIO_RATE で変更）。
+ *
+ * ノート/フィルタ係数テーブル、コントロール周期、Mozzi の MOZZI_AUDIO_RATE はすべてこの値から求めます。
+ */
+constexpr uint32_t kAudioRate = AUDIO_RATE;
+static_assert(kAudioRate == 16384U || kAudioRate == 32768U || kAudioRate == 48000U, "AUDIO_RATE must be 16384, 32768 or 48000");
 
 /**
  * @brief コントロールレート。
  */
 constexpr uint8_t kControlRate = 64U;
 
+/**
+ * @brief 1 コントロール周期あたりのオーディオフレーム数。
+ */
+constexpr uint16_t kControlPeriod = static_cast<uint16_t>(kAudioRate / kControlRate);
+static_assert(kAudioRate % kControlRate == 0U, "the control period must be a whole number of frames");
+
+/**
+ * @brief 1 回のブロックレンダリングで生成する最大フレーム数。
+ *
+ * 波形分岐・スムージング係数・アクティブボイス集合の確定はブロック単位で行います。
+ */
+constexpr uint16_t kAudioBlockSize = 64U;
+static_assert(kAudioBlockSize >= 32U && kAudioBlockSize <= 256U, "kAudioBlockSize must be within 32..256");
+
+/**
+ * @brief イベントのタイムスタンプに加える固定レイテンシ [フレーム]。
+ *
+ * 入力の到着からキューへの投入まで最大 1 コントロール周期、さらにオーディオ側が
+ * 1 ブロック先までレンダリングしている可能性があるため、その合計だけ未来に予約します。
+ * 遅延を一定にすることで、発音タイミングのジッタは 1 サンプルに収まります。
+ */
+constexpr uint16_t kEventLatency = kControlPeriod + kAudioBlockSize;
+
 /**
  * @brief ポルタメントの平滑係数（シフト量）。
  */
 constexpr uint8_t kPortamentoShift = 4U;
 
+/**
+ * @brief 使用しないピンを示す値。
+ */
+constexpr uint8_t kNoPin = 0xFFU;
+
 /**
  * @brief オシレータ選択用のアナログ入力ピン。
  */
@@ -50,18 +178,28 @@ constexpr uint8_t kFilterPin = A3;
 constexpr uint8_t kResonancePin = A4;
 
 /**
- * @brief デジタル入力（鍵盤）ピンの定義。
+ * @brief 鍵盤マトリクスの構成（KEY_MATRIX で切り替え）。
  *
- * 現在は 5 鍵を直接 GPIO から読み取る簡易実装です。将来的にはダイオード付きマトリクススキャンに置き換えます。
+ * KEY_MATRIX=1 はダイオード付き 5x6 マトリクス（行を LOW に駆動し、プルアップした列を読む）。
+ * KEY_MATRIX=0 は従来の 5 鍵直結（1 行 x 5 列、行の駆動なし）として同じスキャナで扱います。
  */
-constexpr uint8_t kKeyPin0 = 2;
-constexpr uint8_t kKeyPin1 = 3;
-constexpr uint8_t kKeyPin2 = 4;
-constexpr uint8_t kKeyPin3 = 5;
-constexpr uint8_t kKeyPin4 = 6;
+#if KEY_MATRIX
+constexpr uint8_t kKeyRows = 5U;
+constexpr uint8_t kKeyCols = 6U;
+static const uint8_t kKeyRowPins[kKeyRows] = {2, 3, 4, 5, 6};
+static const uint8_t kKeyColPins[kKeyCols] = {7, 8, 9, 10, 11, 12};
+#else
+constexpr uint8_t kKeyRows = 1U;
+constexpr uint8_t kKeyCols = 5U;
+static const uint8_t kKeyRowPins[kKeyRows] = {kNoPin};
+static const uint8_t kKeyColPins[kKeyCols] = {2, 3, 4, 5, 6};
+#endif
 
-// キーに割り当てる MIDI ノート番号（C, E, G, A, D の例）
-static const uint8_t kKeyNotes[5] = {60, 64, 67, 69, 62};
+/**
+ * @brief 鍵の総数（鍵番号は 行 * kKeyCols + 列）。
+ */
+constexpr uint8_t kKeyCount = kKeyRows * kKeyCols;
+static_assert(kKeyCount <= 32U, "the key matrix must fit in a 32-bit mask");
 
 /**
  * @brief 10bit ADC の最大値。
@@ -70,6 +208,8 @@ constexpr uint16_t kAdcMax = 1023U;
 
 /**
  * @brief オシレータ波形の種類。
+ *
+ * kSawBL / kPulseBL / kSquareBL は PolyBLEP で折り返しを抑えた帯域制限版です。
  */
 enum class OscWaveform : uint8_t {
   kSine = 0,
@@ -77,61 +217,303 @@ enum class OscWaveform : uint8_t {
   kSaw,
   kPulse,
   kSquare,
+  kSawBL,
+  kPulseBL,
+  kSquareBL,
 };
 
+/**
+ * @brief OscWaveform の種類数（カーネルのディスパッチテーブルの大きさ）。
+ */
+constexpr uint8_t kOscWaveformCount = static_cast<uint8_t>(OscWaveform::kSquareBL) + 1U;
+
 /**
  * @brief エンベロープの各ステージ。
  */
 enum class EnvelopeStage : uint8_t {
   kIdle = 0,
   kAttack,
+  kDecay,
   kSustain,
   kRelease,
 };
 
 /**
- * @brief MIDI メッセージの種別。
+ * @brief エンベロープのセグメント位置の終端（Q16 の 1.0）。
+ */
+constexpr uint32_t kEnvelopeSegmentEnd = 65536UL;
+
+/**
+ * @brief オーディオ側のエンベロープ値の拡張ビット数（Q15 をさらに 16bit 拡張してランプの補間精度を確保）。
+ */
+constexpr uint8_t kEnvelopeLevelShift = 16U;
+
+/**
+ * @brief ADSR の設定値（コントロール側）。
+ *
+ * 各レートは 1 コントロール周期あたりに進めるセグメント位置（Q16、kEnvelopeSegmentEnd で 1 セグメント）です。
+ */
+struct EnvelopeParams {
+  uint32_t attackRate = 2048U;  //!< アタックの進み幅（既定 32 周期 = 0.5 秒）。
+  uint32_t decayRate = 1024U;   //!< ディケイの進み幅（既定 64 周期 = 1 秒）。
+  int16_t sustainLevel = 32767; //!< サステインレベル（Q15）。
+  uint32_t releaseRate = 1024U; //!< リリースの進み幅（既定 64 周期 = 1 秒）。
+};
+
+/**
+ * @brief MIDI メッセージの種別（値はステータスバイト。チャンネルメッセージは上位 4bit）。
  */
 enum class MidiMessage : uint8_t {
   kNoteOff = 0x80,
   kNoteOn = 0x90,
+  kPolyPressure = 0xA0,
   kControlChange = 0xB0,
+  kProgramChange = 0xC0,
+  kChannelPressure = 0xD0,
+  kPitchBend = 0xE0,
+  kSysExStart = 0xF0,
+  kTimeCode = 0xF1,
+  kSongPosition = 0xF2,
+  kSongSelect = 0xF3,
+  kTuneRequest = 0xF6,
+  kSysExEnd = 0xF7,
+  kClock = 0xF8,
+  kStart = 0xFA,
+  kContinue = 0xFB,
+  kStop = 0xFC,
+  kActiveSensing = 0xFE,
+  kSystemReset = 0xFF,
 };
 
 /**
- * @brief 単一ボイスの状態を保持する構造体。
+ * @brief ピッチベンドの最大幅 [半音]（14bit 値の ±8192 に対応）。
  */
-struct Voice {
-  bool active = false;                 //!< ボイスが有効かどうか。
+constexpr uint8_t kPitchBendRange = 2U;
+
+/**
+ * @brief マスターボリュームを設定するコントロールチェンジ番号（Channel Volume）。
+ */
+constexpr uint8_t kMidiCcVolume = 7U;
+
+/**
+ * @brief ディケイタイムを設定するコントロールチェンジ番号（GM2 Sound Controller 6）。
+ */
+constexpr uint8_t kMidiCcDecayTime = 75U;
+
+/**
+ * @brief サステインレベルを設定するコントロールチェンジ番号（Sound Controller 10、未定義枠を使用）。
+ */
+constexpr uint8_t kMidiCcSustainLevel = 79U;
+
+/**
+ * @brief ユニゾンのデチューン幅を設定するコントロールチェンジ番号（Effects 4 Depth、旧 Celeste (Detune) Depth）。
+ *
+ * 0 でユニゾンを解除します。
+ */
+constexpr uint8_t kMidiCcUnisonSpread = 94U;
+
+/**
+ * @brief 現在の音色を最後に受信したプログラム番号へ保存するコントロールチェンジ番号（未定義枠を使用）。
+ *
+ * 値 64 以上で保存します（押したときに 127、離したときに 0 を送るボタンを想定）。
+ */
+constexpr uint8_t kMidiCcPatchStore = 119U;
+
+/**
+ * @brief 全発音を止めるチャンネルモードメッセージ（All Sound Off）。
+ */
+constexpr uint8_t kMidiCcAllSoundOff = 120U;
+
+/**
+ * @brief ピッチベンド等のコントローラを初期値へ戻すチャンネルモードメッセージ（Reset All Controllers）。
+ */
+constexpr uint8_t kMidiCcResetControllers = 121U;
+
+/**
+ * @brief 全ノートをリリースするチャンネルモードメッセージ（All Notes Off）。
+ */
+constexpr uint8_t kMidiCcAllNotesOff = 123U;
+
+/**
+ * @brief 単一ボイスのコントロールレート状態（オーディオ処理では参照しない）。
+ *
+ * エンベロープ値と現在インクリメントはコントロール側が正本を持ち、
+ * 変化した値だけをイベントでオーディオ側のコピーへ送ります。
+ * エンベロープはコントロール周期ごとの折れ点だけを計算し、その間はオーディオ側が直線補間します。
+ */
+struct VoiceControl {
   uint8_t note = 0U;                   //!< 割り当てられている MIDI ノート番号。
-  uint32_t phase = 0U;                 //!< 位相値（固定小数点32bit）。
-  uint32_t increment = 0U;             //!< 現在の位相インクリメント。
-  uint32_t targetIncrement = 0U;       //!< ポルタメントの目標インクリメント。
-  int16_t envelope = 0;                //!< エンベロープ値。
-  EnvelopeStage stage = EnvelopeStage::kIdle; //!< 現在のエンベロープステージ。
   uint8_t velocity = 0U;               //!< 受信ベロシティ。
+  EnvelopeStage stage = EnvelopeStage::kIdle; //!< 現在のエンベロープステージ。
+  int16_t envelope = 0;                //!< 次のコントロール周期の終わりに到達するエンベロープ値（正本）。
+  uint32_t envelopePosition = 0U;      //!< 現在のセグメント内の位置（Q16）。
+  int16_t releaseLevel = 0;            //!< リリース開始時のエンベロープ値。
+  uint32_t increment = 0U;             //!< ポルタメント適用後のインクリメント（正本）。
+  uint32_t targetIncrement = 0U;       //!< ポルタメントの目標インクリメント。
   uint32_t age = 0U;                   //!< 割り当て順序を識別するカウンタ。
-  // SVF 用の軽量状態（VOICE_SVF 使用時に利用）
-  float svf_low = 0.0f;                //!< SVF ロー出力状態
-  float svf_band = 0.0f;               //!< SVF バンド出力状態
 };
 
 /**
- * @brief MIDI 解析に使用するワークバッファ。
+ * @brief 全ボイスの状態をフィールドごとの配列で保持するバンク。
+ *
+ * オーディオレートで参照するホット状態を連続した配列にまとめ、
+ * 有効なボイスは activeMask のビットで管理します。
+ * ホット状態と activeMask はオーディオ側だけが書き込み、control と allocatedMask は
+ * コントロール側だけが書き込みます（両者の受け渡しは SynthState::events 経由）。
+ */
+struct VoiceBank {
+  uint32_t phase[kMaxVoices] = {0U};     //!< 位相値（固定小数点32bit）。
+  uint32_t increment[kMaxVoices] = {0U}; //!< 現在の位相インクリメント。
+  int32_t envelopeLevel[kMaxVoices] = {0};  //!< 現在のエンベロープ値（Q15 << kEnvelopeLevelShift）。
+  int32_t envelopeTarget[kMaxVoices] = {0}; //!< ランプの目標値（同上）。
+  int32_t envelopeStep[kMaxVoices] = {0};   //!< 1 サンプルあたりのランプ増分（同上）。
+  uint16_t envelopeRamp[kMaxVoices] = {0U}; //!< ランプの残りサンプル数。
+  VoiceMask activeMask = 0U;             //!< オーディオ側で発音中のボイスのビットマスク。
+#if VOICE_SVF
+  // SVF 用の軽量状態（VOICE_SVF 使用時のみ確保）
+  SvfValue svfLow[kMaxVoices] = {0};     //!< SVF ロー出力状態
+  SvfValue svfBand[kMaxVoices] = {0};    //!< SVF バンド出力状態
+  SvfValue svfF[kMaxVoices] = {0};       //!< キー追従したカットオフ係数
+#endif
+#if UNISON_VOICES
+  uint32_t unisonPhase[kMaxVoices][kUnisonVoices] = {{0U}}; //!< ユニゾンのサブオシレータ位相（ユニゾン中のみ進む）。
+#endif
+  VoiceControl control[kMaxVoices];      //!< コントロールレート状態。
+  VoiceMask allocatedMask = 0U;          //!< コントロール側で割り当て中のボイスのビットマスク。
+  VoiceMask releasingMask = 0U;          //!< リリース中（横取りの優先候補）のボイスのビットマスク。
+  uint8_t noteSlot[kMidiNoteCount] = {0U}; //!< ノート→ボイスの索引（ボイスインデックス + 1、0 は未割り当て）。
+};
+
+/**
+ * @brief ボイスインデックスに対応するマスクビットを返す。
+ * @param index ボイスインデックス。
+ * @return マスクビット。
+ */
+constexpr VoiceMask voiceBit(const uint8_t index) {
+  return static_cast<VoiceMask>(1U) << index;
+}
+
+/**
+ * @brief 全ボイス分のビットを立てたマスク。
+ */
+constexpr VoiceMask kAllVoicesMask = (kMaxVoices >= 32U) ? ~static_cast<VoiceMask>(0U) : (voiceBit(kMaxVoices) - 1U);
+
+/**
+ * @brief マスク中で最も小さいボイスインデックスを返す。
+ * @param mask 0 以外のボイスマスク。
+ * @return ボイスインデックス。
+ */
+inline uint8_t lowestVoiceIndex(const VoiceMask mask) {
+  return static_cast<uint8_t>(__builtin_ctz(mask));
+}
+
+/**
+ * @brief コントロール側からオーディオ側へ送るイベントの種別。
+ */
+enum class VoiceEventType : uint8_t {
+  kNoteOn = 0,  //!< ボイスの発音開始（位相・フィルタを初期化）。
+  kNoteOff,     //!< リリースを終えたボイスの発音停止。
+  kVoiceUpdate, //!< エンベロープ目標値（1 コントロール周期で到達）とインクリメントの更新。
+  kSteal,       //!< 発音中ボイスの横取り（直後に kNoteOn が続く）。
+  kParam,       //!< グローバルパラメータの変更。
+};
+
+/**
+ * @brief kParam イベントで変更するパラメータ。
+ */
+enum class SynthParam : uint8_t {
+  kWaveform = 0, //!< オシレータ波形（value は OscWaveform）。
+  kCutoff,       //!< グローバル SVF の係数 f（value は Q15）。
+  kResonance,    //!< グローバル SVF のレゾナンス（value は Q15）。
+  kVolume,       //!< マスターボリューム（value は Q15、0x8000 = 0dB）。
+  kUnisonSpread, //!< ユニゾンのデチューン幅（value は Q15、0 でユニゾン解除）。
+};
+
+/**
+ * @brief サンプル単位のタイムスタンプ付きイベント。
+ */
+struct VoiceEvent {
+  uint32_t time = 0U;      //!< 適用するサンプル時刻（オーディオのサンプルクロック基準）。
+  VoiceEventType type = VoiceEventType::kVoiceUpdate; //!< イベント種別。
+  uint8_t voice = 0U;      //!< 対象ボイス（kParam では SynthParam）。
+  uint8_t note = 0U;       //!< ノート番号（kNoteOn のみ）。
+  int16_t envelope = 0;    //!< エンベロープ値。
+  uint32_t value = 0U;     //!< インクリメントまたはパラメータ値。
+};
+
+/**
+ * @brief イベントキューの容量。
+ */
+constexpr size_t kEventQueueSize = EVENT_QUEUE_SIZE;
+
+/**
+ * @brief 1 ティックで全ボイス分のイベント（横取り + ノートオン、またはノートオフ + 更新）に加えて見込む余裕。
+ *
+ * 31250bps の MIDI は 1 コントロール周期（64Hz）に約 49 バイト = 3 バイトのメッセージ 16 個を運びます。
+ */
+constexpr size_t kEventQueueHeadroom = 16U;
+static_assert(kEventQueueSize >= 2U * kMaxVoices + kEventQueueHeadroom,
+              "EVENT_QUEUE_SIZE must hold 2 * MAX_VOICES events plus the MIDI headroom");
+
+/**
+ * @brief キュー満杯で送れなかったノートオン・ノートオフ・横取りを次のティックまで保持する数。
+ */
+constexpr uint8_t kDeferredEventCapacity = 2U * kMaxVoices;
+
+/**
+ * @brief MIDI パーサの状態（ランニングステータス対応）。
  */
 struct MidiParser {
-  uint8_t buffer[3] = {0U}; //!< 受信データの保持領域。
-  uint8_t index = 0U;       //!< 現在格納中のバイト数。
+  uint8_t status = 0U;      //!< 解析中のステータス（チャンネルメッセージはランニングステータスとして保持、0 = なし）。
+  uint8_t data[2] = {0U};   //!< 受信済みのデータバイト。
+  uint8_t index = 0U;       //!< 受信済みのデータバイト数。
+  uint8_t expected = 0U;    //!< メッセージ完了に必要なデータバイト数。
+  bool inSysEx = false;     //!< SysEx の読み飛ばし中か。
+  uint32_t sysExBytes = 0U; //!< 読み飛ばした SysEx データのバイト数（統計用）。
+};
+
+/**
+ * @brief 解析済みの MIDI メッセージ。
+ */
+struct MidiEvent {
+  uint32_t time = 0U;  //!< 最後のバイトを受信したサンプル時刻（audioSampleClock() 基準）。
+  MidiMessage type = MidiMessage::kNoteOff; //!< 種別（ベロシティ 0 のノートオンは kNoteOff に変換済み）。
+  uint8_t channel = 0U; //!< チャンネル（0..15、システムメッセージは 0）。
+  uint8_t data1 = 0U;   //!< 第 1 データバイト（ノート番号、コントローラ番号など）。
+  uint8_t data2 = 0U;   //!< 第 2 データバイト（ベロシティ、値など。1 バイトのメッセージは 0）。
+
+  /**
+   * @brief 2 つのデータバイトを 14bit 値として返す（ピッチベンド、ソングポジション）。
+   */
+  uint16_t value14() const {
+    return static_cast<uint16_t>(data1 | (static_cast<uint16_t>(data2) << 7U));
+  }
 };
 
 /**
  * @brief シンセ全体の状態をまとめたコンテナ。
  */
 struct SynthState {
-  Voice voices[kMaxVoices];               //!< 利用可能なボイス群。
+  VoiceBank voices;                       //!< 利用可能なボイス群。
   uint32_t voiceAgeCounter = 0U;          //!< 次に割り当てるボイス年齢。
-  volatile OscWaveform waveform = OscWaveform::kSine; //!< 現在選択中の波形。
+  OscWaveform waveform = OscWaveform::kSine; //!< コントロール側で選択中の波形。
+  EnvelopeParams envelope;                //!< ADSR の設定値（コントロール側）。
   MidiParser midi;                        //!< MIDI パーサ状態。
+  int16_t pitchBend = 0;                  //!< ピッチベンド量（1/kFineTuneSteps 半音単位）。
+  uint8_t pressure = 0U;                  //!< アフタータッチ（0..127、カットオフを開く）。
+  uint8_t program = 0U;                   //!< 最後に受信したプログラム番号。
+  uint16_t volume = 32768U;               //!< マスターボリューム（Q15、CC7 の最終値。パッチの保存用）。
+  uint16_t unisonSpread = 0U;             //!< ユニゾンのデチューン幅（Q15、CC94 の最終値。パッチの保存用）。
+  bool recallRequested = false;           //!< Program Change を受信し、パッチの呼び出しを待っているか。
+  bool storeRequested = false;            //!< CC119 を受信し、パッチの保存を待っているか。
+  uint32_t droppedStores = 0U;            //!< 保存できずに破棄した CC119 の数（消去待ちの保存が重なった、または書き込み失敗）。
+  SpscQueue<VoiceEvent, kEventQueueSize> events; //!< コントロール→オーディオのイベントキュー。
+  uint32_t eventTime = 0U;                //!< 次に投入するイベントのタイムスタンプ（コントロール側）。
+  uint32_t droppedEvents = 0U;            //!< キュー満杯で破棄したイベント数（コントロール側）。
+  VoiceEvent deferredEvents[kDeferredEventCapacity]; //!< キュー満杯で保留したボイスのライフサイクルイベント（投入順）。
+  uint8_t deferredCount = 0U;             //!< 保留中のイベント数（flushDeferredEvents() で再投入する）。
+  VoiceMask voiceMask = kAllVoicesMask;   //!< 割り当てに使うボイス（起動時の自己診断で締め切りに収まる数へ制限される）。
+  uint32_t sampleClock = 0U;              //!< レンダリング済みフレーム数（オーディオ側のみ更新）。
 };
 
 /**
@@ -142,14 +524,6 @@ inline HardwareSerial &midiSerial() {
   return Serial1;
 }
 
-// ビルド時に以下のマクロでフィルタ方式を切り替えできます。
-// 定義例:
-// -DGLOBAL_SVF : ミックス後にグローバルな SVF を適用（デフォルト）
-// -DVOICE_SVF  : 各ボイスごとに SVF を持ち、キー追従でカットオフを変化させる
-#ifndef GLOBAL_SVF
-#define GLOBAL_SVF 1
-#endif
-
 
 }  // namespace mini_synth
 
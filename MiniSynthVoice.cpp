@@ -3,123 +3,330 @@
 
 #include "MiniSynthVoice.h"
 
-#include "MiniSynthMozziConfig.h"
+#include "MiniSynthFilter.h"
+#include "MiniSynthNoteTable.h"
+#include "MiniSynthOscillator.h"
 
-#include <mozzi_midi.h>
+#include "MiniSynthMozziConfig.h"
 
 namespace mini_synth {
+namespace {
+/**
+ * @brief オーディオ側のエンベロープをランプなしで指定値にする。
+ */
+void setEnvelopeImmediate(VoiceBank &bank, const uint8_t index, const int16_t level) {
+  bank.envelopeLevel[index] = static_cast<int32_t>(level) << kEnvelopeLevelShift;
+  bank.envelopeTarget[index] = bank.envelopeLevel[index];
+  bank.envelopeStep[index] = 0;
+  bank.envelopeRamp[index] = 0U;
+}
+}  // namespace
 
 uint32_t midiNoteToIncrement(const uint8_t note) {
-  // MIDI ノート番号を周波数に変換。
-  const float frequency = mtof(note);
-  // 周波数から固定小数点の位相インクリメントへ変換するスケールを算出。
-  const float scale = static_cast<float>(UINT32_MAX) / static_cast<float>(kAudioRate);
-  return static_cast<uint32_t>(frequency * scale);
-}
-
-Voice *allocateVoice(SynthState &state) {
-  // まず非アクティブなボイスを探索。
-  for (auto &voice : state.voices) {
-    if (!voice.active) {
-      return &voice;
+  // コンパイル時に kAudioRate から生成したテーブルを参照（浮動小数点演算なし）。
+  return kNoteIncrementTable[note & 0x7FU];
+}
+
+uint32_t bentNoteIncrement(const SynthState &state, const uint8_t note) {
+  if (state.pitchBend == 0) {
+    return midiNoteToIncrement(note);
+  }
+  return pitchToIncrement(static_cast<int32_t>(note & 0x7FU) * kFineTuneSteps + state.pitchBend);
+}
+
+void setPitchBend(SynthState &state, const int16_t bend) {
+  if (bend == state.pitchBend) {
+    return;
+  }
+  state.pitchBend = bend;
+  VoiceBank &bank = state.voices;
+  for (VoiceMask mask = bank.allocatedMask; mask != 0U; mask &= mask - 1U) {
+    VoiceControl &control = bank.control[lowestVoiceIndex(mask)];
+    // 目標に到達済みのボイスはベンドに遅れないよう直接移す（変化は updateActiveVoices() が送る）。
+    const bool settled = control.increment == control.targetIncrement;
+    control.targetIncrement = bentNoteIncrement(state, control.note);
+    if (settled) {
+      control.increment = control.targetIncrement;
+    }
+  }
+}
+
+bool postEvent(SynthState &state, VoiceEvent event) {
+  event.time = state.eventTime;
+  // ボイス宛てのイベントは保留中のイベントを追い越さないよう、保留があるうちは直接投入しない
+  //（kParam はボイス全体の設定なので順序を問わない）。
+  if ((state.deferredCount == 0U || event.type == VoiceEventType::kParam) && state.events.push(event)) {
+    return true;
+  }
+  const bool lifecycle = event.type == VoiceEventType::kNoteOn || event.type == VoiceEventType::kNoteOff ||
+                         event.type == VoiceEventType::kSteal;
+  if (!lifecycle) {
+    return false;
+  }
+  if (state.deferredCount >= kDeferredEventCapacity) {
+    ++state.droppedEvents;
+    return false;
+  }
+  state.deferredEvents[state.deferredCount++] = event;
+  return true;
+}
+
+void flushDeferredEvents(SynthState &state) {
+  uint8_t sent = 0U;
+  while (sent < state.deferredCount && state.events.push(state.deferredEvents[sent])) {
+    ++sent;
+  }
+  if (sent == 0U) {
+    return;
+  }
+  for (uint8_t i = sent; i < state.deferredCount; ++i) {
+    state.deferredEvents[i - sent] = state.deferredEvents[i];
+  }
+  state.deferredCount = static_cast<uint8_t>(state.deferredCount - sent);
+}
+
+uint32_t audioSampleClock(const SynthState &state) {
+  return __atomic_load_n(&state.sampleClock, __ATOMIC_ACQUIRE);
+}
+
+void applyVoiceEvent(VoiceBank &bank, const VoiceEvent &event) {
+  const uint8_t index = event.voice;
+  switch (event.type) {
+    case VoiceEventType::kSteal:
+      // 横取りされたボイスは即座に無音化し、続く kNoteOn で再始動する。
+      bank.activeMask &= ~voiceBit(index);
+      setEnvelopeImmediate(bank, index, 0);
+      break;
+    case VoiceEventType::kNoteOn:
+      bank.phase[index] = 0U;
+      bank.increment[index] = event.value;
+      setEnvelopeImmediate(bank, index, event.envelope);
+      // per-voice SVF を初期化
+      initVoiceSVF(bank, index, event.note);
+      initUnisonPhases(bank, index);
+      bank.activeMask |= voiceBit(index);
+      break;
+    case VoiceEventType::kVoiceUpdate: {
+      bank.increment[index] = event.value;
+      // 現在値から目標値まで 1 コントロール周期かけて直線で移る（周期ごとの折れ線で指数カーブを近似）。
+      const int32_t target = static_cast<int32_t>(event.envelope) << kEnvelopeLevelShift;
+      bank.envelopeTarget[index] = target;
+      bank.envelopeStep[index] = (target - bank.envelopeLevel[index]) / static_cast<int32_t>(kControlPeriod);
+      bank.envelopeRamp[index] = kControlPeriod;
+      break;
     }
+    case VoiceEventType::kNoteOff:
+      setEnvelopeImmediate(bank, index, 0);
+      bank.activeMask &= ~voiceBit(index);
+      break;
+    case VoiceEventType::kParam:
+    default:
+      // グローバルパラメータは呼び出し側で処理する。
+      break;
+  }
+}
+
+uint8_t allocateVoice(SynthState &state) {
+  const VoiceBank &bank = state.voices;
+  // まず空きボイスを探索（ビットマスクの最下位ビットを取るだけ）。
+  const VoiceMask freeMask = ~bank.allocatedMask & state.voiceMask;
+  if (freeMask != 0U) {
+    return lowestVoiceIndex(freeMask);
   }
-  // すべて使用中の場合は最も age の小さいボイスを再利用する。
-  Voice *oldest = &state.voices[0];
-  for (auto &voice : state.voices) {
-    if (voice.age < oldest->age) {
-      oldest = &voice;
+  // すべて使用中の場合は、リリース中のボイスを優先し、その中で最も音量の小さいボイスを再利用する。
+  // リリース中のボイスがなければ全ボイスから同じ基準で選ぶ（同音量なら age の小さい方）。
+  const VoiceMask candidates = (bank.releasingMask != 0U) ? bank.releasingMask : bank.allocatedMask;
+  uint8_t quietest = lowestVoiceIndex(candidates);
+  for (VoiceMask mask = candidates & (candidates - 1U); mask != 0U; mask &= mask - 1U) {
+    const uint8_t index = lowestVoiceIndex(mask);
+    const VoiceControl &control = bank.control[index];
+    const VoiceControl &best = bank.control[quietest];
+    if (control.envelope < best.envelope || (control.envelope == best.envelope && control.age < best.age)) {
+      quietest = index;
     }
   }
-  return oldest;
+  return quietest;
 }
 
-void initVoice(SynthState &state, Voice &voice, const uint8_t note, const uint8_t velocity) {
+void initVoice(SynthState &state, const uint8_t index, const uint8_t note, const uint8_t velocity) {
+  VoiceBank &bank = state.voices;
+  VoiceControl &control = bank.control[index];
+  const bool stolen = (bank.allocatedMask & voiceBit(index)) != 0U;
+  if (stolen) {
+    // 横取りされるボイスが保持していたノートの索引を外す。
+    unmapVoiceNote(bank, index);
+  }
   // 新しいノート情報でボイスを再初期化。
-  voice.active = true;
-  voice.note = note;
-  voice.velocity = velocity;
-  voice.phase = 0U;
-  voice.targetIncrement = midiNoteToIncrement(note);
-  voice.increment = voice.targetIncrement;
-  voice.envelope = 0;
-  voice.stage = EnvelopeStage::kAttack;
-  // age カウンタを更新し、LRU 判定に備える。
-  voice.age = ++state.voiceAgeCounter;
-  // per-voice SVF を初期化
-  initVoiceSVF(voice);
-}
-
-Voice *findVoiceByNote(SynthState &state, const uint8_t note) {
-  // 同じノート番号を持つアクティブなボイスを探す。
-  for (auto &voice : state.voices) {
-    if (voice.active && voice.note == note) {
-      return &voice;
-    }
+  control.note = note;
+  control.velocity = velocity;
+  control.targetIncrement = bentNoteIncrement(state, note);
+  control.stage = EnvelopeStage::kAttack;
+  control.increment = control.targetIncrement;
+  control.envelope = 0;
+  control.envelopePosition = 0U;
+  // age カウンタを更新し、横取り時の同音量判定に備える。
+  control.age = ++state.voiceAgeCounter;
+  bank.noteSlot[note & 0x7FU] = static_cast<uint8_t>(index + 1U);
+  bank.releasingMask &= ~voiceBit(index);
+
+  VoiceEvent event;
+  event.voice = index;
+  if (stolen) {
+    // 発音中のボイスを再利用する場合は横取りを先に通知する。
+    event.type = VoiceEventType::kSteal;
+    postEvent(state, event);
   }
-  return nullptr;
+  bank.allocatedMask |= voiceBit(index);
+  event.type = VoiceEventType::kNoteOn;
+  event.note = note;
+  event.envelope = control.envelope;
+  event.value = control.increment;
+  postEvent(state, event);
 }
 
-void releaseVoice(Voice &voice) {
-  // リリースフェーズに遷移し、エンベロープ減衰を開始。
-  voice.stage = EnvelopeStage::kRelease;
+uint8_t findVoiceByNote(const SynthState &state, const uint8_t note) {
+  // 索引を 1 回引くだけ（同じノートが複数ボイスにある場合は最後に割り当てたボイス）。
+  const uint8_t slot = state.voices.noteSlot[note & 0x7FU];
+  return (slot != 0U) ? static_cast<uint8_t>(slot - 1U) : kNoVoice;
 }
 
-void updatePortamento(Voice &voice) {
+void unmapVoiceNote(VoiceBank &bank, const uint8_t index) {
+  uint8_t &slot = bank.noteSlot[bank.control[index].note & 0x7FU];
+  // 同じノートが後から別ボイスへ割り当てられていれば、そちらの索引を残す。
+  if (slot == index + 1U) {
+    slot = 0U;
+  }
+}
+
+void releaseVoice(VoiceBank &bank, const uint8_t index) {
+  VoiceControl &control = bank.control[index];
+  if (control.stage == EnvelopeStage::kRelease || control.stage == EnvelopeStage::kIdle) {
+    return;
+  }
+  // リリースフェーズに遷移し、現在値から指数減衰を開始。
+  control.stage = EnvelopeStage::kRelease;
+  control.envelopePosition = 0U;
+  control.releaseLevel = control.envelope;
+  bank.releasingMask |= voiceBit(index);
+}
+
+void releaseAllVoices(SynthState &state) {
+  VoiceBank &bank = state.voices;
+  for (VoiceMask mask = bank.allocatedMask; mask != 0U; mask &= mask - 1U) {
+    releaseVoice(bank, lowestVoiceIndex(mask));
+  }
+}
+
+void stopAllVoices(SynthState &state) {
+  VoiceBank &bank = state.voices;
+  for (VoiceMask mask = bank.allocatedMask; mask != 0U; mask &= mask - 1U) {
+    const uint8_t index = lowestVoiceIndex(mask);
+    VoiceControl &control = bank.control[index];
+    control.stage = EnvelopeStage::kIdle;
+    control.envelope = 0;
+    control.envelopePosition = 0U;
+    control.releaseLevel = 0;
+    unmapVoiceNote(bank, index);
+    VoiceEvent event;
+    event.type = VoiceEventType::kNoteOff;
+    event.voice = index;
+    postEvent(state, event);
+  }
+  bank.allocatedMask = 0U;
+  bank.releasingMask = 0U;
+}
+
+void updatePortamento(VoiceBank &bank, const uint8_t index) {
   // 現在値と目標値の差分を計算。
-  const int32_t current = static_cast<int32_t>(voice.increment);
-  const int32_t target = static_cast<int32_t>(voice.targetIncrement);
+  VoiceControl &control = bank.control[index];
+  const int32_t current = static_cast<int32_t>(control.increment);
+  const int32_t target = static_cast<int32_t>(control.targetIncrement);
   const int32_t diff = target - current;
   // シフト演算による簡易一次 IIR で平滑化。
   const int32_t step = diff >> kPortamentoShift;
-  voice.increment = static_cast<uint32_t>(current + step);
+  control.increment = static_cast<uint32_t>(current + step);
 }
 
-void updateEnvelope(Voice &voice, const int16_t attackStep, const int16_t releaseStep) {
-  switch (voice.stage) {
+void updateEnvelope(VoiceBank &bank, const uint8_t index, const EnvelopeParams &params) {
+  VoiceControl &control = bank.control[index];
+  int16_t &envelope = control.envelope;
+  // 各セグメントは位置 0..kEnvelopeSegmentEnd をカーブテーブルで指数カーブに写像する。
+  switch (control.stage) {
     case EnvelopeStage::kAttack:
-      // アタック中は指定ステップで増加させる。
-      if (voice.envelope + attackStep >= 32767) {
-        voice.envelope = 32767;
-        voice.stage = EnvelopeStage::kSustain;
+      control.envelopePosition += params.attackRate;
+      if (control.envelopePosition >= kEnvelopeSegmentEnd) {
+        envelope = 32767;
+        control.stage = EnvelopeStage::kDecay;
+        control.envelopePosition = 0U;
+      } else {
+        // 減衰カーブを反転した、立ち上がりの速い凸カーブ。
+        envelope = static_cast<int16_t>(32767 - envelopeCurveQ15(control.envelopePosition));
+      }
+      break;
+    case EnvelopeStage::kDecay:
+      control.envelopePosition += params.decayRate;
+      if (control.envelopePosition >= kEnvelopeSegmentEnd) {
+        envelope = params.sustainLevel;
+        control.stage = EnvelopeStage::kSustain;
       } else {
-        voice.envelope = voice.envelope + attackStep;
+        const int32_t span = 32767 - params.sustainLevel;
+        envelope = static_cast<int16_t>(params.sustainLevel + ((span * envelopeCurveQ15(control.envelopePosition)) >> 15));
       }
       break;
     case EnvelopeStage::kSustain:
-      // サステイン中は値を保持。
+      // サステインレベルの変更にも追従する（ランプはオーディオ側で補間）。
+      envelope = params.sustainLevel;
       break;
     case EnvelopeStage::kRelease:
-      // 指定ステップで減少させ、ゼロに到達したらボイスを無効化。
-      if (voice.envelope <= releaseStep) {
-        voice.envelope = 0;
-        voice.stage = EnvelopeStage::kIdle;
-        voice.active = false;
+      control.envelopePosition += params.releaseRate;
+      if (control.envelopePosition >= kEnvelopeSegmentEnd || control.releaseLevel == 0) {
+        // このティックで 0 までのランプを送り、停止は次のティックで行う。
+        envelope = 0;
+        control.stage = EnvelopeStage::kIdle;
       } else {
-        voice.envelope = voice.envelope - releaseStep;
+        envelope = static_cast<int16_t>((static_cast<int32_t>(control.releaseLevel) * envelopeCurveQ15(control.envelopePosition)) >> 15);
       }
       break;
     case EnvelopeStage::kIdle:
     default:
-      // アイドル状態では何もしない。
+      // 0 へのランプを終えたボイスを解放する。
+      if ((bank.allocatedMask & voiceBit(index)) != 0U) {
+        bank.allocatedMask &= ~voiceBit(index);
+        bank.releasingMask &= ~voiceBit(index);
+        unmapVoiceNote(bank, index);
+      }
       break;
   }
 }
 
 // --- SVF 実装（軽量 Chamberlin 型）
-void initVoiceSVF(Voice &voice) {
-  voice.svf_low = 0.0f;
-  voice.svf_band = 0.0f;
+void initVoiceSVF(VoiceBank &bank, const uint8_t index, const uint8_t note) {
+#if VOICE_SVF
+  bank.svfLow[index] = 0;
+  bank.svfBand[index] = 0;
+  // キー追従のため、プリコンピュートしたテーブルを参照
+#if SVF_FIXED_POINT
+  bank.svfF[index] = kNoteFQ15Table[note & 0x7FU];
+#else
+  bank.svfF[index] = kNoteFTable[note & 0x7FU];
+#endif
+#else
+  (void)bank;
+  (void)index;
+  (void)note;
+#endif
 }
 
-float processVoiceSVF(Voice &voice, float input, float f, float q) {
+#if VOICE_SVF
+SvfValue processVoiceSVF(VoiceBank &bank, const uint8_t index, const SvfValue input, const SvfValue f, const SvfValue q) {
   // Chamberlin-ish:
   // hp = input - low - q * band
-  float hp = input - voice.svf_low - q * voice.svf_band;
-  voice.svf_band += f * hp;
-  voice.svf_low += f * voice.svf_band;
-  return voice.svf_low; // lowpass output
+#if SVF_FIXED_POINT
+  return processSvfQ15(bank.svfLow[index], bank.svfBand[index], input, f, q);
+#else
+  return processSvfFloat(bank.svfLow[index], bank.svfBand[index], input, f, q);
+#endif
 }
+#endif
 
 }  // namespace mini_synth
-
@@ -5,71 +5,162 @@
 namespace mini_synth {
 
 /**
- * @brief MIDI ノート番号から位相インクリメントを計算する。
+ * @brief MIDI ノート番号から位相インクリメントを求める（テーブル参照）。
  * @param note 対象の MIDI ノート番号。
  * @return 固定小数点の位相インクリメント値。
  */
 uint32_t midiNoteToIncrement(uint8_t note);
 
+/**
+ * @brief ピッチベンドを反映したノートの位相インクリメントを求める（コントロール側）。
+ * @param state シンセ状態（state.pitchBend を参照）。
+ * @param note 対象の MIDI ノート番号。
+ * @return 固定小数点の位相インクリメント値。
+ */
+uint32_t bentNoteIncrement(const SynthState &state, uint8_t note);
+
+/**
+ * @brief ピッチベンド量を変更し、発音中のボイスの音程を追従させる（コントロール側）。
+ *
+ * ポルタメント中でないボイスは次のコントロール周期で新しい音程へ移り、ポルタメント中のボイスは目標値だけを変更します。
+ * @param state シンセ状態。
+ * @param bend ベンド量（1/kFineTuneSteps 半音単位）。
+ */
+void setPitchBend(SynthState &state, int16_t bend);
+
+/**
+ * @brief イベントに state.eventTime のタイムスタンプを付けてキューへ投入する（コントロール側）。
+ *
+ * キューが満杯（ボイス宛てのイベントは保留中のイベントがある場合も）のとき、ノートオン・ノートオフ・横取りは
+ * state.deferredEvents に保留して次のティックの flushDeferredEvents() で順番どおり再投入します。
+ * それ以外（kVoiceUpdate・kParam）は投入せず false を返すので、呼び出し側が次のティックで送り直します。
+ * 保留領域も満杯の場合はイベントを破棄し、state.droppedEvents を加算します。
+ * @param state シンセ状態。
+ * @param event 投入するイベント（time は上書きされる）。
+ * @return 投入または保留できた場合は true。
+ */
+bool postEvent(SynthState &state, VoiceEvent event);
+
+/**
+ * @brief 保留中のイベントを投入順にキューへ再投入する（コントロール側、ティックの先頭で呼ぶ）。
+ *
+ * 保留時のタイムスタンプは過去になっているため、オーディオ側は次のブロックで即座に適用します。
+ * @param state シンセ状態。
+ */
+void flushDeferredEvents(SynthState &state);
+
+/**
+ * @brief オーディオ側のサンプルクロックを読み出す（コントロール側から参照可能）。
+ * @param state シンセ状態。
+ * @return これまでにレンダリングしたフレーム数。
+ */
+uint32_t audioSampleClock(const SynthState &state);
+
+/**
+ * @brief ボイスイベントをオーディオ側のホット状態に適用する（オーディオ側）。
+ * @param bank ボイスバンク。
+ * @param event 適用するイベント（kParam 以外）。
+ */
+void applyVoiceEvent(VoiceBank &bank, const VoiceEvent &event);
+
 /**
  * @brief 利用可能なボイスを取得する。
+ *
+ * 空きボイスがあれば allocatedMask から O(1) で選びます。すべて使用中の場合は
+ * リリース中のボイスを優先し、その中で最も音量の小さい（同音量なら古い）ボイスを横取り対象にします。
  * @param state シンセ状態。
- * @return 割り当て可能なボイスへのポインタ。
+ * @return 割り当て可能なボイスのインデックス。
  */
-Voice *allocateVoice(SynthState &state);
+uint8_t allocateVoice(SynthState &state);
 
 /**
- * @brief ボイス情報を初期化する。
+ * @brief ボイス情報を初期化し、発音開始イベントを投入する。
+ *
+ * 発音中のボイスを再利用する場合は先に kSteal イベントを投入します。
  * @param state シンセ状態。
- * @param voice 初期化対象のボイス。
+ * @param index 初期化対象のボイスインデックス。
  * @param note 割り当てるノート番号。
  * @param velocity 受信ベロシティ。
  */
-void initVoice(SynthState &state, Voice &voice, uint8_t note, uint8_t velocity);
+void initVoice(SynthState &state, uint8_t index, uint8_t note, uint8_t velocity);
 
 /**
- * @brief 指定したノートに対応するボイスを検索する。
+ * @brief 指定したノートに対応するボイスを検索する（ノート→ボイス索引による O(1) 参照）。
+ *
+ * 同じノートが複数のボイスに割り当てられている場合は、最後に割り当てたボイスを返します。
  * @param state シンセ状態。
  * @param note 検索するノート番号。
- * @return 見つかったボイス、存在しない場合は nullptr。
+ * @return 見つかったボイスのインデックス、存在しない場合は kNoVoice。
+ */
+uint8_t findVoiceByNote(const SynthState &state, uint8_t note);
+
+/**
+ * @brief ボイスが保持しているノートをノート→ボイス索引から外す（コントロール側）。
+ * @param bank ボイスバンク。
+ * @param index 対象のボイスインデックス。
  */
-Voice *findVoiceByNote(SynthState &state, uint8_t note);
+void unmapVoiceNote(VoiceBank &bank, uint8_t index);
 
 /**
- * @brief ボイスのリリース処理を開始する。
- * @param voice 対象のボイス。
+ * @brief ボイスのリリース処理を開始する（リリース中/停止中のボイスには何もしない）。
+ * @param bank ボイスバンク。
+ * @param index 対象のボイスインデックス。
  */
-void releaseVoice(Voice &voice);
+void releaseVoice(VoiceBank &bank, uint8_t index);
 
 /**
- * @brief ポルタメントを適用して位相インクリメントを更新する。
- * @param voice 対象のボイス。
+ * @brief 割り当て中の全ボイスのリリースを開始する（All Notes Off / System Reset）。
+ * @param state シンセ状態。
+ */
+void releaseAllVoices(SynthState &state);
+
+/**
+ * @brief 割り当て中の全ボイスをリリースなしで即座に止めて解放する（All Sound Off）。
+ *
+ * 各ボイスに kNoteOff を投入し（オーディオ側はエンベロープを即座に 0 にする）、
+ * コントロール側のエンベロープも 0 の停止状態にします。
+ * @param state シンセ状態。
  */
-void updatePortamento(Voice &voice);
+void stopAllVoices(SynthState &state);
 
 /**
- * @brief ボイスのエンベロープを更新する。
- * @param voice 対象のボイス。
- * @param attackStep アタック時の増分。
- * @param releaseStep リリース時の減分。
+ * @brief ポルタメントを適用してコントロール側のインクリメントを更新する。
+ * @param bank ボイスバンク。
+ * @param index 対象のボイスインデックス。
  */
-void updateEnvelope(Voice &voice, int16_t attackStep, int16_t releaseStep);
+void updatePortamento(VoiceBank &bank, uint8_t index);
+
+/**
+ * @brief コントロール側の ADSR エンベロープを 1 コントロール周期分進める。
+ *
+ * 各セグメントはカーブテーブル（kEnvelopeCurveTable）による指数カーブで、ここでは周期末の値だけを求めます。
+ * 周期内の補間はオーディオ側が kVoiceUpdate を受けて直線ランプで行います。
+ * リリースが 0 に達した次の周期でボイスは allocatedMask から外れます。
+ * @param bank ボイスバンク。
+ * @param index 対象のボイスインデックス。
+ * @param params ADSR の設定値。
+ */
+void updateEnvelope(VoiceBank &bank, uint8_t index, const EnvelopeParams &params);
 
 // --- SVF (State Variable Filter) support ---
 /**
- * @brief ボイスのSVF状態を初期化する（必要なら）。
+ * @brief ボイスのSVF状態を初期化し、キー追従係数を設定する（必要なら、オーディオ側）。
  */
-void initVoiceSVF(Voice &voice);
+void initVoiceSVF(VoiceBank &bank, uint8_t index, uint8_t note);
 
+#if VOICE_SVF
 /**
  * @brief ボイス単位のSVFを更新し、入力サンプルをフィルタする。
- * @param voice 対象ボイス
- * @param input 入力サンプル（float、-32768..32767）
- * @param f 正規化周波数係数（0..1 相当）
- * @param q レゾナンス係数
- * @return フィルタ後の出力（float）
+ *
+ * SVF_FIXED_POINT 有効時は係数を Q15 整数として扱います。
+ * @param bank ボイスバンク
+ * @param index 対象ボイスインデックス
+ * @param input 入力サンプル（-32768..32767）
+ * @param f 正規化周波数係数（0..1 相当、固定小数点時は Q15）
+ * @param q レゾナンス係数（固定小数点時は Q15）
+ * @return フィルタ後の出力
  */
-float processVoiceSVF(Voice &voice, float input, float f, float q);
+SvfValue processVoiceSVF(VoiceBank &bank, uint8_t index, SvfValue input, SvfValue f, SvfValue q);
+#endif
 
 }  // namespace mini_synth
-
@@ -0,0 +1,239 @@
+#include "HostMidiFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace host {
+namespace {
+
+/**
+ * @brief Event in tick time before the tempo map is applied.
+ */
+struct TickEvent {
+  uint64_t tick = 0U;
+  uint32_t order = 0U;          // file order, keeps simultaneous events stable
+  uint32_t tempo = 0U;          // microseconds per quarter note, 0 for channel messages
+  MidiFileMessage message;
+};
+
+/**
+ * @brief Bounds-checked big-endian reader over the file image.
+ */
+class Reader {
+ public:
+  Reader(const std::vector<uint8_t> &bytes, size_t begin, size_t end) : bytes_(bytes), pos_(begin), end_(end) {}
+
+  bool atEnd() const { return pos_ >= end_; }
+  size_t position() const { return pos_; }
+  bool ok() const { return ok_; }
+
+  uint8_t peek() {
+    if (pos_ >= end_) {
+      ok_ = false;
+      return 0U;
+    }
+    return bytes_[pos_];
+  }
+
+  uint8_t u8() {
+    const uint8_t value = peek();
+    if (ok_) {
+      ++pos_;
+    }
+    return value;
+  }
+
+  uint32_t be(int count) {
+    uint32_t value = 0U;
+    for (int i = 0; i < count; ++i) {
+      value = (value << 8) | u8();
+    }
+    return value;
+  }
+
+  // Variable-length quantity (at most 4 bytes).
+  uint32_t vlq() {
+    uint32_t value = 0U;
+    for (int i = 0; i < 4; ++i) {
+      const uint8_t byte = u8();
+      value = (value << 7) | (byte & 0x7FU);
+      if ((byte & 0x80U) == 0U) {
+        return value;
+      }
+    }
+    ok_ = false;
+    return value;
+  }
+
+  void skip(size_t count) {
+    if (count > end_ - pos_) {
+      ok_ = false;
+      pos_ = end_;
+      return;
+    }
+    pos_ += count;
+  }
+
+ private:
+  const std::vector<uint8_t> &bytes_;
+  size_t pos_;
+  size_t end_;
+  bool ok_ = true;
+};
+
+// Number of data bytes that follow a channel status byte.
+int channelDataBytes(const uint8_t status) {
+  const uint8_t type = status & 0xF0U;
+  return (type == 0xC0U || type == 0xD0U) ? 1 : 2;
+}
+
+bool readTrack(Reader &reader, std::vector<TickEvent> &events, uint32_t &order, std::string &error) {
+  uint64_t tick = 0U;
+  uint8_t runningStatus = 0U;
+  while (!reader.atEnd()) {
+    tick += reader.vlq();
+    uint8_t status = reader.peek();
+    if ((status & 0x80U) != 0U) {
+      reader.u8();
+    } else if (runningStatus != 0U) {
+      status = runningStatus;
+    } else {
+      error = "data byte without running status";
+      return false;
+    }
+
+    if (status == 0xFFU) {
+      // Meta event: only tempo changes matter, end of track stops the chunk.
+      const uint8_t type = reader.u8();
+      const uint32_t length = reader.vlq();
+      if (type == 0x51U && length == 3U) {
+        TickEvent event;
+        event.tick = tick;
+        event.order = order++;
+        event.tempo = reader.be(3);
+        events.push_back(event);
+      } else {
+        reader.skip(length);
+      }
+      if (type == 0x2FU) {
+        break;
+      }
+    } else if (status == 0xF0U || status == 0xF7U) {
+      // SysEx: skipped. Running status is cancelled by system messages.
+      reader.skip(reader.vlq());
+      runningStatus = 0U;
+    } else if (status >= 0xF0U) {
+      error = "unexpected system message in track";
+      return false;
+    } else {
+      runningStatus = status;
+      TickEvent event;
+      event.tick = tick;
+      event.order = order++;
+      event.message.data[0] = status;
+      event.message.size = static_cast<uint8_t>(1 + channelDataBytes(status));
+      for (uint8_t i = 1U; i < event.message.size; ++i) {
+        event.message.data[i] = reader.u8() & 0x7FU;
+      }
+      events.push_back(event);
+    }
+    if (!reader.ok()) {
+      error = "truncated track";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool readMidiFile(const std::string &path, std::vector<MidiFileMessage> &messages, std::string &error) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    error = "cannot open " + path;
+    return false;
+  }
+  const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  Reader header(bytes, 0U, bytes.size());
+  if (header.be(4) != 0x4D546864UL || header.be(4) < 6U) {
+    error = "not a Standard MIDI File";
+    return false;
+  }
+  const uint32_t format = header.be(2);
+  const uint32_t trackCount = header.be(2);
+  const uint32_t division = header.be(2);
+  if (!header.ok() || format > 1U) {
+    error = "unsupported MIDI file format";
+    return false;
+  }
+
+  // Ticks per quarter note, or a fixed tick length for SMPTE time division.
+  double smpteTickSeconds = 0.0;
+  if ((division & 0x8000U) != 0U) {
+    const int framesPerSecond = -static_cast<int8_t>(division >> 8);
+    const int ticksPerFrame = static_cast<int>(division & 0xFFU);
+    if (framesPerSecond <= 0 || ticksPerFrame == 0) {
+      error = "invalid SMPTE division";
+      return false;
+    }
+    smpteTickSeconds = 1.0 / (static_cast<double>(framesPerSecond) * ticksPerFrame);
+  } else if (division == 0U) {
+    error = "invalid time division";
+    return false;
+  }
+
+  std::vector<TickEvent> events;
+  uint32_t order = 0U;
+  size_t chunk = 14U;
+  uint32_t tracksRead = 0U;
+  while (tracksRead < trackCount && chunk + 8U <= bytes.size()) {
+    Reader chunkHeader(bytes, chunk, bytes.size());
+    const uint32_t id = chunkHeader.be(4);
+    const uint32_t length = chunkHeader.be(4);
+    const size_t begin = chunk + 8U;
+    if (length > bytes.size() - begin) {
+      error = "chunk extends past end of file";
+      return false;
+    }
+    if (id == 0x4D54726BUL) {
+      Reader track(bytes, begin, begin + length);
+      if (!readTrack(track, events, order, error)) {
+        return false;
+      }
+      ++tracksRead;
+    }
+    chunk = begin + length;
+  }
+  if (tracksRead < trackCount) {
+    error = "file ends before all tracks were read";
+    return false;
+  }
+
+  std::stable_sort(events.begin(), events.end(), [](const TickEvent &a, const TickEvent &b) {
+    return (a.tick != b.tick) ? (a.tick < b.tick) : (a.order < b.order);
+  });
+
+  // Apply the tempo map (default 120 BPM) while walking the merged events.
+  messages.clear();
+  double seconds = 0.0;
+  uint64_t lastTick = 0U;
+  double tickSeconds = (smpteTickSeconds > 0.0) ? smpteTickSeconds : 0.5 / division;
+  for (const TickEvent &event : events) {
+    seconds += static_cast<double>(event.tick - lastTick) * tickSeconds;
+    lastTick = event.tick;
+    if (event.tempo != 0U) {
+      if (smpteTickSeconds == 0.0) {
+        tickSeconds = static_cast<double>(event.tempo) * 1e-6 / division;
+      }
+      continue;
+    }
+    MidiFileMessage message = event.message;
+    message.seconds = seconds;
+    messages.push_back(message);
+  }
+  return true;
+}
+
+}  // namespace host
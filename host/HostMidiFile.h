@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace host {
+
+/**
+ * @brief One channel message from a Standard MIDI File, with its absolute time.
+ */
+struct MidiFileMessage {
+  double seconds = 0.0; //!< Time from the start of the file (tempo map applied).
+  uint8_t data[3] = {0U, 0U, 0U}; //!< Status byte (running status expanded) and data bytes.
+  uint8_t size = 0U;    //!< Number of valid bytes in data (2 or 3).
+};
+
+/**
+ * @brief Read a format 0/1 Standard MIDI File.
+ *
+ * All tracks are merged in time order; meta events other than tempo and all
+ * SysEx events are dropped.
+ * @param path File to read.
+ * @param messages Receives the channel messages sorted by time.
+ * @param error Receives a description when parsing fails.
+ * @return true on success.
+ */
+bool readMidiFile(const std::string &path, std::vector<MidiFileMessage> &messages, std::string &error);
+
+}  // namespace host
@@ -0,0 +1,84 @@
+#include "HostWavWriter.h"
+
+#include <cstring>
+
+namespace host {
+namespace {
+
+void putLe(uint8_t *out, const uint32_t value, const int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+// Canonical 44-byte header for 16-bit mono PCM.
+void buildHeader(uint8_t *header, const uint32_t sampleRate, const uint32_t samples) {
+  const uint32_t dataBytes = samples * 2U;
+  memcpy(header, "RIFF", 4);
+  putLe(header + 4, 36U + dataBytes, 4);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  putLe(header + 16, 16U, 4);             // fmt chunk size
+  putLe(header + 20, 1U, 2);              // PCM
+  putLe(header + 22, 1U, 2);              // mono
+  putLe(header + 24, sampleRate, 4);
+  putLe(header + 28, sampleRate * 2U, 4); // byte rate
+  putLe(header + 32, 2U, 2);              // block align
+  putLe(header + 34, 16U, 2);             // bits per sample
+  memcpy(header + 36, "data", 4);
+  putLe(header + 40, dataBytes, 4);
+}
+
+}  // namespace
+
+WavWriter::~WavWriter() {
+  close();
+}
+
+bool WavWriter::open(const std::string &path, const uint32_t sampleRate) {
+  close();
+  file_ = std::fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  samples_ = 0U;
+  uint8_t header[44];
+  buildHeader(header, sampleRate, 0U);
+  return std::fwrite(header, 1, sizeof(header), file_) == sizeof(header);
+}
+
+bool WavWriter::write(const int16_t *samples, const size_t count) {
+  if (file_ == nullptr) {
+    return false;
+  }
+  uint8_t bytes[512];
+  size_t done = 0U;
+  while (done < count) {
+    const size_t chunk = (count - done < sizeof(bytes) / 2U) ? (count - done) : (sizeof(bytes) / 2U);
+    for (size_t i = 0; i < chunk; ++i) {
+      putLe(bytes + 2U * i, static_cast<uint16_t>(samples[done + i]), 2);
+    }
+    if (std::fwrite(bytes, 2, chunk, file_) != chunk) {
+      return false;
+    }
+    done += chunk;
+  }
+  samples_ += static_cast<uint32_t>(count);
+  return true;
+}
+
+bool WavWriter::close() {
+  if (file_ == nullptr) {
+    return true;
+  }
+  uint8_t sizes[4];
+  bool ok = true;
+  putLe(sizes, 36U + samples_ * 2U, 4);
+  ok = ok && std::fseek(file_, 4, SEEK_SET) == 0 && std::fwrite(sizes, 1, 4, file_) == 4;
+  putLe(sizes, samples_ * 2U, 4);
+  ok = ok && std::fseek(file_, 40, SEEK_SET) == 0 && std::fwrite(sizes, 1, 4, file_) == 4;
+  ok = (std::fclose(file_) == 0) && ok;
+  file_ = nullptr;
+  return ok;
+}
+
+}  // namespace host
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cstdio>
+#include <string>
+
+namespace host {
+
+/**
+ * @brief Streaming writer for 16-bit PCM mono WAV files.
+ *
+ * The RIFF sizes are patched in close(), so samples can be appended without
+ * knowing the final length.
+ */
+class WavWriter {
+ public:
+  WavWriter() = default;
+  WavWriter(const WavWriter &) = delete;
+  WavWriter &operator=(const WavWriter &) = delete;
+  ~WavWriter();
+
+  /**
+   * @brief Create the file and write a provisional header.
+   */
+  bool open(const std::string &path, uint32_t sampleRate);
+
+  /**
+   * @brief Append samples.
+   */
+  bool write(const int16_t *samples, size_t count);
+
+  /**
+   * @brief Patch the header sizes and close the file.
+   */
+  bool close();
+
+  /**
+   * @brief Number of samples written so far.
+   */
+  uint32_t sampleCount() const { return samples_; }
+
+ private:
+  std::FILE *file_ = nullptr;
+  uint32_t samples_ = 0U;
+};
+
+}  // namespace host
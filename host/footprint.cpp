@@ -0,0 +1,278 @@
+// Footprint report: sums the flash and RAM taken by each subsystem from a GNU
+// ld link map.
+//
+//   build/footprint mini_synth.ino.map              # one build
+//   build/footprint minimal.map standard.map        # two builds and their difference
+//
+// Each input section of the memory map is charged to the object it came from.
+// Objects of the synth (MiniSynthVoice.cpp.o, libmini_synth_core.a(MiniSynthVoice.cpp.o))
+// are reported by subsystem ("Voice"), host shims by file ("HostArduino"); Arduino libraries by library directory
+// ("Mozzi", "U8g2"), other archives by archive name ("core", "libc").
+// Flash counts .text/.rodata/initialised data images and tables; RAM counts
+// .data and .bss (the data image is in both). Debug and other non-loaded
+// sections are ignored, so the totals are close to what the size tool prints.
+//
+// The STM32 Arduino core writes the map next to the ELF (build/<sketch>.ino.map
+// with `arduino-cli compile --export-binaries`); the host build writes
+// build/midi2wav.map. Build each BUILD_PROFILE and pass two maps to see what a
+// feature costs.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Bytes charged to one subsystem.
+ */
+struct Footprint {
+  unsigned long flash = 0UL;
+  unsigned long ram = 0UL;
+};
+
+using FootprintTable = std::map<std::string, Footprint>;
+
+enum class Region : unsigned char {
+  kNone,     // not loaded (debug info, comments, discarded)
+  kFlash,    // code and read-only data
+  kRam,      // zero-initialised or uninitialised data
+  kFlashRam, // initialised data: image in flash, copy in RAM
+};
+
+bool startsWith(const std::string &text, const char *prefix) {
+  return text.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+Region regionOf(const std::string &outputSection) {
+  static const char *const kNotLoaded[] = {".debug", ".comment", ".note", ".ARM.attributes", ".stab", ".gnu.attributes",
+                                           ".symtab", ".strtab", ".shstrtab", ".gnu_debuglink", "/DISCARD/"};
+  for (const char *prefix : kNotLoaded) {
+    if (startsWith(outputSection, prefix)) {
+      return Region::kNone;
+    }
+  }
+  if (startsWith(outputSection, ".bss") || startsWith(outputSection, ".tbss") || startsWith(outputSection, ".noinit") ||
+      startsWith(outputSection, "._user_heap_stack")) {
+    return Region::kRam;
+  }
+  if (startsWith(outputSection, ".data") || startsWith(outputSection, ".tdata")) {
+    return Region::kFlashRam;
+  }
+  return Region::kFlash;
+}
+
+std::string baseName(const std::string &path) {
+  const size_t slash = path.find_last_of("/\\");
+  return (slash == std::string::npos) ? path : path.substr(slash + 1U);
+}
+
+// "MiniSynthVoice.cpp.o" -> "Voice", "wiring.c.o" -> "wiring", "libc.a" -> "libc".
+std::string stem(std::string name) {
+  if (startsWith(name, "mini_synth.ino")) {
+    return "mini_synth.ino";
+  }
+  if (startsWith(name, "MiniSynth")) {
+    name.erase(0, std::char_traits<char>::length("MiniSynth"));
+  }
+  const size_t dot = name.find('.');
+  if (dot != std::string::npos && dot != 0U) {
+    name.erase(dot);
+  }
+  return name.empty() ? std::string("(unnamed)") : name;
+}
+
+/**
+ * @brief Subsystem an input file is charged to.
+ */
+std::string subsystemOf(const std::string &file) {
+  if (file.empty()) {
+    return "(linker)";
+  }
+  const size_t open = file.find('(');
+  if (open != std::string::npos && file.back() == ')') {
+    // Archive member: synth objects and host shims by member, everything else by archive.
+    const std::string member = file.substr(open + 1U, file.size() - open - 2U);
+    if (startsWith(member, "MiniSynth") || startsWith(member, "Host")) {
+      return stem(member);
+    }
+    return stem(baseName(file.substr(0, open)));
+  }
+  const std::string name = baseName(file);
+  if (startsWith(name, "MiniSynth") || startsWith(name, "mini_synth")) {
+    return stem(name);
+  }
+  const size_t libraries = file.find("/libraries/");
+  if (libraries != std::string::npos) {
+    const size_t start = libraries + std::char_traits<char>::length("/libraries/");
+    return file.substr(start, file.find('/', start) - start);
+  }
+  return stem(name);
+}
+
+void charge(FootprintTable &table, const Region region, const unsigned long size, const std::string &file) {
+  if (region == Region::kNone || size == 0UL) {
+    return;
+  }
+  Footprint &entry = table[subsystemOf(file)];
+  if (region != Region::kRam) {
+    entry.flash += size;
+  }
+  if (region != Region::kFlash) {
+    entry.ram += size;
+  }
+}
+
+bool isHex(const std::string &token) {
+  return startsWith(token, "0x") && token.size() > 2U;
+}
+
+/**
+ * @brief Parse the "Linker script and memory map" part of a GNU ld map file.
+ */
+bool readMap(const std::string &path, FootprintTable &table) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "footprint: cannot open %s\n", path.c_str());
+    return false;
+  }
+  std::string line;
+  bool inMemoryMap = false;
+  Region region = Region::kNone;
+  bool pendingInput = false; // an input section name too long to share its line with the address
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!inMemoryMap) {
+      inMemoryMap = startsWith(line, "Linker script and memory map");
+      continue;
+    }
+    if (line.empty()) {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::vector<std::string> tokens;
+    for (std::string token; fields >> token;) {
+      tokens.push_back(token);
+    }
+    if (tokens.empty()) {
+      continue;
+    }
+    if (line[0] != ' ') {
+      // Output section (".text  0x... 0x...") or a linker directive (LOAD, OUTPUT, ...).
+      region = (tokens[0][0] == '.' || tokens[0][0] == '/') ? regionOf(tokens[0]) : Region::kNone;
+      pendingInput = false;
+      continue;
+    }
+    const bool sectionName = tokens[0][0] == '.' || tokens[0] == "COMMON" || tokens[0] == "*fill*";
+    size_t first = 0U;
+    if (sectionName && tokens.size() == 1U) {
+      pendingInput = true;
+      continue;
+    }
+    if (sectionName) {
+      first = 1U;
+    } else if (!pendingInput) {
+      continue; // symbol, assignment or input pattern
+    }
+    pendingInput = false;
+    // "<address> <size> [file]"; symbol lines have a name instead of a size.
+    if (tokens.size() < first + 2U || !isHex(tokens[first]) || !isHex(tokens[first + 1U])) {
+      continue;
+    }
+    std::string file;
+    for (size_t i = first + 2U; i < tokens.size(); ++i) {
+      file += (i > first + 2U) ? " " + tokens[i] : tokens[i];
+    }
+    if (tokens[0] == "*fill*") {
+      file.clear();
+    }
+    charge(table, region, std::strtoul(tokens[first + 1U].c_str(), nullptr, 16), file);
+  }
+  if (!inMemoryMap) {
+    std::fprintf(stderr, "footprint: %s: no memory map (link with -Wl,-Map=<file>)\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void printSingle(const FootprintTable &table) {
+  std::vector<std::pair<std::string, Footprint>> rows(table.begin(), table.end());
+  std::sort(rows.begin(), rows.end(), [](const std::pair<std::string, Footprint> &a, const std::pair<std::string, Footprint> &b) {
+    return a.second.flash + a.second.ram > b.second.flash + b.second.ram;
+  });
+  Footprint total;
+  std::printf("%-24s %10s %10s\n", "subsystem", "flash", "ram");
+  for (const auto &row : rows) {
+    std::printf("%-24s %10lu %10lu\n", row.first.c_str(), row.second.flash, row.second.ram);
+    total.flash += row.second.flash;
+    total.ram += row.second.ram;
+  }
+  std::printf("%-24s %10lu %10lu\n", "total", total.flash, total.ram);
+}
+
+void printComparison(const FootprintTable &a, const FootprintTable &b) {
+  FootprintTable names = a;
+  names.insert(b.begin(), b.end());
+  std::vector<std::string> rows;
+  for (const auto &entry : names) {
+    rows.push_back(entry.first);
+  }
+  auto find = [](const FootprintTable &table, const std::string &name) {
+    const auto it = table.find(name);
+    return (it != table.end()) ? it->second : Footprint();
+  };
+  // Largest changes first.
+  auto change = [&](const std::string &name) {
+    const Footprint fa = find(a, name);
+    const Footprint fb = find(b, name);
+    return std::labs(static_cast<long>(fb.flash) - static_cast<long>(fa.flash)) + std::labs(static_cast<long>(fb.ram) - static_cast<long>(fa.ram));
+  };
+  std::stable_sort(rows.begin(), rows.end(), [&](const std::string &x, const std::string &y) { return change(x) > change(y); });
+  Footprint totalA;
+  Footprint totalB;
+  std::printf("%-24s %10s %10s %10s %10s %10s %10s\n", "subsystem", "flash(a)", "flash(b)", "delta", "ram(a)", "ram(b)", "delta");
+  auto printRow = [](const char *name, const Footprint &fa, const Footprint &fb) {
+    std::printf("%-24s %10lu %10lu %+10ld %10lu %10lu %+10ld\n", name, fa.flash, fb.flash,
+                static_cast<long>(fb.flash) - static_cast<long>(fa.flash), fa.ram, fb.ram, static_cast<long>(fb.ram) - static_cast<long>(fa.ram));
+  };
+  for (const std::string &name : rows) {
+    const Footprint fa = find(a, name);
+    const Footprint fb = find(b, name);
+    printRow(name.c_str(), fa, fb);
+    totalA.flash += fa.flash;
+    totalA.ram += fa.ram;
+    totalB.flash += fb.flash;
+    totalB.ram += fb.ram;
+  }
+  printRow("total", totalA, totalB);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    std::fprintf(stderr, "usage: %s build.map [other.map]\n", argv[0]);
+    return 2;
+  }
+  FootprintTable first;
+  if (!readMap(argv[1], first)) {
+    return 1;
+  }
+  if (argc == 2) {
+    printSingle(first);
+    return 0;
+  }
+  FootprintTable second;
+  if (!readMap(argv[2], second)) {
+    return 1;
+  }
+  printComparison(first, second);
+  return 0;
+}
@@ -0,0 +1,209 @@
+// Offline renderer: streams a Standard MIDI File through the synth core and
+// writes the result as a 16-bit mono WAV at kAudioRate.
+//
+// MIDI bytes are fed into the Serial1 shim, so they reach handleMidiByte()
+// through handleControl() exactly as on the device; audio is produced with
+// renderBlock() one control period at a time.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "HostMidiFile.h"
+#include "HostWavWriter.h"
+#include "MiniSynthApp.h"
+#include "MiniSynthDisplay.h"
+#include "MiniSynthProfiler.h"
+#include "MiniSynthScope.h"
+
+namespace {
+
+/**
+ * @brief Raw ADC value applied to a pot before rendering.
+ */
+struct PotOption {
+  const char *flag;
+  uint8_t pin;
+  int value;
+};
+
+PotOption g_pots[] = {
+    {"--wave", mini_synth::kOscSelectPin, 0},
+    {"--attack", mini_synth::kAttackPin, 700},
+    {"--release", mini_synth::kReleasePin, 300},
+    {"--cutoff", mini_synth::kFilterPin, 800},
+    {"--resonance", mini_synth::kResonancePin, 300},
+};
+
+void printUsage(const char *program) {
+  std::fprintf(stderr,
+               "usage: %s [options] input.mid output.wav\n"
+               "  --wave N        waveform pot, raw ADC 0..1023 (default 0 = sine)\n"
+               "  --attack N      attack pot (default 700)\n"
+               "  --release N     release pot (default 300)\n"
+               "  --cutoff N      filter cutoff pot (default 800)\n"
+               "  --resonance N   filter resonance pot (default 300)\n"
+               "  --tail SEC      audio rendered after the last event (default 2)\n"
+               "  --quiet         do not print the render summary\n"
+               "  --profile       print per-zone cycle statistics after rendering\n",
+               program);
+}
+
+bool parseArguments(int argc, char **argv, std::string &input, std::string &output, double &tail, bool &quiet, bool &profile) {
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    if (std::strcmp(arg, "--quiet") == 0) {
+      quiet = true;
+      continue;
+    }
+    if (std::strcmp(arg, "--profile") == 0) {
+      profile = true;
+      continue;
+    }
+    if (std::strncmp(arg, "--", 2) != 0) {
+      positional.push_back(arg);
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char *value = argv[++i];
+    if (std::strcmp(arg, "--tail") == 0) {
+      tail = std::atof(value);
+      continue;
+    }
+    bool known = false;
+    for (PotOption &pot : g_pots) {
+      if (std::strcmp(arg, pot.flag) == 0) {
+        pot.value = constrain(std::atoi(value), 0, static_cast<int>(mini_synth::kAdcMax));
+        known = true;
+      }
+    }
+    if (!known) {
+      return false;
+    }
+  }
+  if (positional.size() != 2U || tail < 0.0) {
+    return false;
+  }
+  input = positional[0];
+  output = positional[1];
+  return true;
+}
+
+/**
+ * @brief Print the profiler zones (host counter cycles) and the deadline misses.
+ */
+void printProfile() {
+  std::fprintf(stderr, "%-10s %10s %10s %10s %10s\n", "zone", "count", "avg", "p99", "max");
+  for (uint8_t z = 0; z < kProfileZoneCount; ++z) {
+    const ProfileZone zone = static_cast<ProfileZone>(z);
+    ProfileSummary summary;
+    profileGetSummary(zone, &summary);
+    std::fprintf(stderr, "%-10s %10u %10.0f %10u %10u\n", profileZoneName(zone), summary.count, static_cast<double>(summary.average),
+                 summary.p99, summary.max);
+  }
+  ProfileSummary render;
+  profileGetSummary(ProfileZone::kRender, &render);
+  std::fprintf(stderr, "deadline: %u cycles/sample, %u blocks missed\n", profileCyclesPerSample(), render.deadlineMisses);
+  const mini_synth::RenderHeadroom &headroom = mini_synth::renderHeadroom();
+  std::fprintf(stderr, "headroom: %u Hz, block budget %u cycles, idle %u, %u voices %u -> limit %u%s\n",
+               static_cast<unsigned>(mini_synth::kAudioRate), headroom.budgetCycles, headroom.idleCycles,
+               static_cast<unsigned>(mini_synth::kMaxVoices), headroom.fullCycles, static_cast<unsigned>(headroom.voiceLimit),
+               headroom.meetsDeadline ? "" : " (over budget)");
+  DisplayStats display;
+  displayGetStats(&display);
+  const uint32_t fullFrameTiles = kDisplayPages * kDisplayTilesPerPage;
+  std::fprintf(stderr, "display: %u frames, %u busy skips, %u tiles sent (%.1f%% of full frames), %u bytes\n", display.frames,
+               display.busySkips, display.tilesSent,
+               (display.frames != 0U) ? 100.0 * display.tilesSent / (static_cast<double>(display.frames) * fullFrameTiles) : 0.0,
+               display.bytesSent);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string inputPath;
+  std::string outputPath;
+  double tailSeconds = 2.0;
+  bool quiet = false;
+  bool profile = false;
+  if (!parseArguments(argc, argv, inputPath, outputPath, tailSeconds, quiet, profile)) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  std::vector<host::MidiFileMessage> messages;
+  std::string error;
+  if (!host::readMidiFile(inputPath, messages, error)) {
+    std::fprintf(stderr, "midi2wav: %s: %s\n", inputPath.c_str(), error.c_str());
+    return 1;
+  }
+  host::WavWriter wav;
+  if (!wav.open(outputPath, mini_synth::kAudioRate)) {
+    std::fprintf(stderr, "midi2wav: cannot create %s\n", outputPath.c_str());
+    return 1;
+  }
+
+  for (const PotOption &pot : g_pots) {
+    hostSetAnalog(pot.pin, pot.value);
+  }
+  mini_synth::initializeSynth();
+  // Offline rendering has no deadline: keep every voice even if the start-up check limited them.
+  mini_synth::synthState().voiceMask = mini_synth::kAllVoicesMask;
+
+  const double rate = static_cast<double>(mini_synth::kAudioRate);
+  const double lastEvent = messages.empty() ? 0.0 : messages.back().seconds;
+  const uint64_t totalFrames = static_cast<uint64_t>((lastEvent + tailSeconds) * rate);
+  int16_t block[mini_synth::kControlPeriod];
+  size_t next = 0U;
+  uint64_t frame = 0U;
+  uint32_t droppedBytes = 0U;
+
+  const auto start = std::chrono::steady_clock::now();
+  while (frame < totalFrames) {
+    // Bytes that arrived before this control tick are visible to handleControl().
+    while (next < messages.size() && static_cast<uint64_t>(messages[next].seconds * rate) <= frame) {
+      const host::MidiFileMessage &message = messages[next++];
+      for (uint8_t i = 0U; i < message.size; ++i) {
+        if (!Serial1.feed(message.data[i])) {
+          ++droppedBytes;
+        }
+      }
+    }
+    mini_synth::handleControl();
+    mini_synth::renderBlock(block, mini_synth::kControlPeriod);
+    // Feed the scope like the audio callback does, so spectrum and display see the output.
+    for (int16_t sample : block) {
+      scopePushSample(sample);
+    }
+    if (!wav.write(block, mini_synth::kControlPeriod)) {
+      std::fprintf(stderr, "midi2wav: write error on %s\n", outputPath.c_str());
+      return 1;
+    }
+    frame += mini_synth::kControlPeriod;
+  }
+  const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (!wav.close()) {
+    std::fprintf(stderr, "midi2wav: write error on %s\n", outputPath.c_str());
+    return 1;
+  }
+  if (!quiet) {
+    const double audioSeconds = static_cast<double>(frame) / rate;
+    std::fprintf(stderr, "midi2wav: %zu events, %.2f s of audio in %.3f s (%.0fx realtime)\n", messages.size(), audioSeconds, wall,
+                 (wall > 0.0) ? audioSeconds / wall : 0.0);
+  }
+  if (profile) {
+    printProfile();
+  }
+  if (droppedBytes != 0U) {
+    std::fprintf(stderr, "midi2wav: warning: %u MIDI bytes dropped (serial FIFO full)\n", droppedBytes);
+  }
+  return 0;
+}
@@ -0,0 +1,431 @@
+// MIDI input fuzz and throughput test for the parser (parseMidiByte) and the
+// receive ring (MiniSynthMidiIn.*).
+//
+// 1. conformance: a random but well-formed stream (running status, real-time
+//    bytes injected inside messages, SysEx blocks with and without F7,
+//    system common messages, undefined status bytes) is parsed and every
+//    event is compared with the one the generator expected.
+// 2. garbage: random bytes, each burst followed by a complete Note On that
+//    must always be recovered; events are checked for range errors.
+// 3. ring: bytes pushed past the ring capacity are counted as overruns and
+//    the rest come out in order with their timestamps.
+// 4. overflow: with the voice event queue full, Note Ons that steal every
+//    voice are held back (steal before note on, in order) and all of them
+//    reach the queue on the next flushDeferredEvents(); none are dropped.
+// 5. channel mode: CC123 (All Notes Off) starts the release of every voice,
+//    CC120 (All Sound Off) stops and frees them at once.
+// 6. throughput: parser alone, and ring + parser + handleMidiEvent() into the
+//    synth state, in MB/s and ns/byte against the 3125 byte/s MIDI wire rate.
+//
+//   build/midi_fuzz               # 8 MB streams, seed 1
+//   build/midi_fuzz 64 1234       # 64 MB streams, seed 1234
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "MiniSynthApp.h"
+#include "MiniSynthMidi.h"
+#include "MiniSynthMidiIn.h"
+#include "MiniSynthVoice.h"
+
+namespace {
+
+using mini_synth::MidiEvent;
+using mini_synth::MidiMessage;
+using mini_synth::MidiParser;
+
+struct Expected {
+  uint8_t type;
+  uint8_t channel;
+  uint8_t data1;
+  uint8_t data2;
+};
+
+constexpr double kWireBytesPerSecond = 31250.0 / 10.0;
+
+/**
+ * @brief Builds a well-formed stream and the events the parser must return.
+ */
+class StreamGenerator {
+ public:
+  StreamGenerator(uint32_t seed, std::vector<uint8_t> &bytes, std::vector<Expected> &events)
+      : rng_(seed), bytes_(bytes), events_(events) {}
+
+  void generate(size_t targetBytes) {
+    while (bytes_.size() < targetBytes) {
+      const uint32_t r = random(100);
+      if (r < 72) {
+        channelMessage();
+      } else if (r < 82) {
+        sysEx();
+      } else if (r < 92) {
+        systemCommon();
+      } else if (r < 94) {
+        // Undefined system common (F4/F5): no event, cancels running status.
+        emit(static_cast<uint8_t>(0xF4U + random(2)));
+        running_ = 0U;
+      } else {
+        // A stray real-time byte between messages.
+        realTime();
+      }
+    }
+  }
+
+ private:
+  uint32_t random(uint32_t n) { return static_cast<uint32_t>(rng_() % n); }
+
+  void expect(uint8_t type, uint8_t channel, uint8_t data1, uint8_t data2) { events_.push_back({type, channel, data1, data2}); }
+
+  void realTime() {
+    static const uint8_t kRealTime[] = {0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF};
+    const uint8_t data = kRealTime[random(sizeof(kRealTime))];
+    bytes_.push_back(data);
+    if (data != 0xF9U && data != 0xFDU) {
+      expect(data, 0U, 0U, 0U);
+    }
+  }
+
+  // Every byte may be preceded by a real-time byte, including inside messages and SysEx.
+  void emit(uint8_t data) {
+    if (random(100) < 5) {
+      realTime();
+    }
+    bytes_.push_back(data);
+  }
+
+  void channelMessage() {
+    static const uint8_t kTypes[] = {0x80, 0x90, 0xA0, 0xB0, 0xC0, 0xD0, 0xE0};
+    const uint8_t type = kTypes[random(sizeof(kTypes))];
+    const uint8_t channel = static_cast<uint8_t>(random(16));
+    const uint8_t status = static_cast<uint8_t>(type | channel);
+    const bool twoBytes = type != 0xC0U && type != 0xD0U;
+    const uint8_t data1 = static_cast<uint8_t>(random(128));
+    uint8_t data2 = twoBytes ? static_cast<uint8_t>(random(128)) : 0U;
+    if (type == 0x90U && random(10) == 0) {
+      data2 = 0U;
+    }
+    if (status != running_ || random(2) == 0) {
+      emit(status);
+    }
+    running_ = status;
+    emit(data1);
+    if (twoBytes) {
+      emit(data2);
+    }
+    expect((type == 0x90U && data2 == 0U) ? 0x80U : type, channel, data1, data2);
+  }
+
+  void sysEx() {
+    emit(0xF0U);
+    const uint32_t length = random(64);
+    for (uint32_t i = 0; i < length; ++i) {
+      emit(static_cast<uint8_t>(random(128)));
+    }
+    // Sometimes left open: the next status byte (never running status) ends it.
+    if (random(5) != 0) {
+      emit(0xF7U);
+    }
+    running_ = 0U;
+  }
+
+  void systemCommon() {
+    static const uint8_t kCommon[] = {0xF1, 0xF2, 0xF3, 0xF6};
+    const uint8_t status = kCommon[random(sizeof(kCommon))];
+    emit(status);
+    uint8_t data1 = 0U;
+    uint8_t data2 = 0U;
+    if (status != 0xF6U) {
+      data1 = static_cast<uint8_t>(random(128));
+      emit(data1);
+    }
+    if (status == 0xF2U) {
+      data2 = static_cast<uint8_t>(random(128));
+      emit(data2);
+    }
+    expect(status, 0U, data1, data2);
+    running_ = 0U;
+  }
+
+  std::mt19937 rng_;
+  std::vector<uint8_t> &bytes_;
+  std::vector<Expected> &events_;
+  uint8_t running_ = 0U;
+};
+
+bool sameEvent(const MidiEvent &event, const Expected &expected) {
+  return static_cast<uint8_t>(event.type) == expected.type && event.channel == expected.channel && event.data1 == expected.data1 &&
+         event.data2 == expected.data2;
+}
+
+bool inRange(const MidiEvent &event) {
+  return event.channel < 16U && event.data1 < 128U && event.data2 < 128U && static_cast<uint8_t>(event.type) >= 0x80U;
+}
+
+bool testConformance(const std::vector<uint8_t> &bytes, const std::vector<Expected> &expected) {
+  MidiParser parser;
+  MidiEvent event;
+  size_t next = 0U;
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    if (!mini_synth::parseMidiByte(parser, bytes[i], event)) {
+      continue;
+    }
+    if (next >= expected.size() || !sameEvent(event, expected[next])) {
+      std::fprintf(stderr, "conformance: mismatch at byte %zu (event %zu): got %02X ch%u %u %u\n", i, next,
+                   static_cast<unsigned>(event.type), event.channel, event.data1, event.data2);
+      return false;
+    }
+    ++next;
+  }
+  if (next != expected.size()) {
+    std::fprintf(stderr, "conformance: %zu of %zu events parsed\n", next, expected.size());
+    return false;
+  }
+  std::printf("conformance  %10zu bytes %10zu events, %u SysEx bytes skipped: ok\n", bytes.size(), next, parser.sysExBytes);
+  return true;
+}
+
+bool testGarbage(size_t targetBytes, uint32_t seed) {
+  std::mt19937 rng(seed ^ 0x5A5A5A5AU);
+  MidiParser parser;
+  MidiEvent event;
+  size_t bytes = 0U;
+  size_t bursts = 0U;
+  while (bytes < targetBytes) {
+    const uint32_t length = 1U + static_cast<uint32_t>(rng() % 256U);
+    for (uint32_t i = 0; i < length; ++i) {
+      if (mini_synth::parseMidiByte(parser, static_cast<uint8_t>(rng()), event) && !inRange(event)) {
+        std::fprintf(stderr, "garbage: out-of-range event %02X ch%u %u %u\n", static_cast<unsigned>(event.type), event.channel,
+                     event.data1, event.data2);
+        return false;
+      }
+    }
+    // A complete message with its status byte must always come through.
+    const uint8_t note = static_cast<uint8_t>(rng() % 128U);
+    const uint8_t sync[] = {0x93U, note, 0x40U};
+    bool found = false;
+    for (const uint8_t data : sync) {
+      if (mini_synth::parseMidiByte(parser, data, event)) {
+        found = event.type == MidiMessage::kNoteOn && event.channel == 3U && event.data1 == note && event.data2 == 0x40U;
+      }
+    }
+    if (!found) {
+      std::fprintf(stderr, "garbage: lost sync after burst %zu\n", bursts);
+      return false;
+    }
+    bytes += length + sizeof(sync);
+    ++bursts;
+  }
+  std::printf("garbage      %10zu bytes %10zu bursts resynchronized: ok\n", bytes, bursts);
+  return true;
+}
+
+bool testRing() {
+  mini_synth::midiInReset();
+  const uint32_t extra = 17U;
+  for (uint32_t i = 0; i < MIDI_RX_BUFFER_SIZE + extra; ++i) {
+    mini_synth::midiInReceive(static_cast<uint8_t>(i), i * 3U);
+  }
+  mini_synth::MidiInStats stats;
+  mini_synth::midiInGetStats(&stats);
+  mini_synth::MidiRxByte rx;
+  uint32_t count = 0U;
+  while (mini_synth::midiInRead(rx)) {
+    if (rx.data != static_cast<uint8_t>(count) || rx.time != count * 3U) {
+      std::fprintf(stderr, "ring: byte %u out of order\n", count);
+      return false;
+    }
+    ++count;
+  }
+  if (count != MIDI_RX_BUFFER_SIZE || stats.ringOverruns != extra || stats.maxFill != MIDI_RX_BUFFER_SIZE) {
+    std::fprintf(stderr, "ring: read %u, overruns %u, max fill %u\n", count, stats.ringOverruns, stats.maxFill);
+    return false;
+  }
+  mini_synth::midiInReset();
+  std::printf("ring         %10u bytes, %u overruns counted: ok\n", count, stats.ringOverruns);
+  return true;
+}
+
+bool testQueueOverflow() {
+  using mini_synth::VoiceEvent;
+  using mini_synth::VoiceEventType;
+  mini_synth::resetSynth();
+  mini_synth::SynthState &state = mini_synth::synthState();
+  const uint8_t voices = mini_synth::kMaxVoices;
+  for (uint8_t v = 0; v < voices; ++v) {
+    mini_synth::noteOn(state, 0U, static_cast<uint8_t>(36U + v), 100U);
+  }
+  while (state.events.peek() != nullptr) {
+    state.events.pop();
+  }
+  // Fill the queue with parameter events, as a burst of CCs would.
+  VoiceEvent param;
+  param.type = VoiceEventType::kParam;
+  param.voice = static_cast<uint8_t>(mini_synth::SynthParam::kVolume);
+  size_t queued = 0U;
+  while (mini_synth::postEvent(state, param)) {
+    ++queued;
+  }
+  // Every new note steals a voice: a steal and a note on per voice.
+  for (uint8_t v = 0; v < voices; ++v) {
+    mini_synth::noteOn(state, 0U, static_cast<uint8_t>(72U + v), 100U);
+  }
+  const uint8_t deferred = state.deferredCount;
+  // Next tick: the audio side has drained the queue, the held events go first.
+  while (state.events.peek() != nullptr) {
+    state.events.pop();
+  }
+  mini_synth::flushDeferredEvents(state);
+  uint32_t steals = 0U;
+  uint32_t noteOns = 0U;
+  bool ordered = true;
+  while (const VoiceEvent *event = state.events.peek()) {
+    if (event->type == VoiceEventType::kSteal) {
+      ++steals;
+    } else if (event->type == VoiceEventType::kNoteOn) {
+      ordered = ordered && event->note == 72U + noteOns && steals == noteOns + 1U;
+      ++noteOns;
+    }
+    state.events.pop();
+  }
+  const bool ok = deferred == 2U * voices && state.deferredCount == 0U && state.droppedEvents == 0U &&
+                  steals == voices && noteOns == voices && ordered;
+  if (!ok) {
+    std::fprintf(stderr, "overflow: %u deferred, %u left, %u dropped, %u steals, %u note ons%s\n", deferred,
+                 state.deferredCount, state.droppedEvents, steals, noteOns, ordered ? "" : ", out of order");
+  } else {
+    std::printf("overflow     %10zu queued, %u held and resent: ok\n", queued, deferred);
+  }
+  mini_synth::resetSynth();
+  return ok;
+}
+
+bool testChannelMode() {
+  using mini_synth::VoiceEvent;
+  using mini_synth::VoiceEventType;
+  mini_synth::resetSynth();
+  mini_synth::SynthState &state = mini_synth::synthState();
+  const uint8_t voices = mini_synth::kMaxVoices;
+  const auto playAll = [&]() {
+    for (uint8_t v = 0; v < voices; ++v) {
+      mini_synth::noteOn(state, 0U, static_cast<uint8_t>(48U + v), 100U);
+    }
+    while (state.events.peek() != nullptr) {
+      state.events.pop();
+    }
+  };
+  playAll();
+  const mini_synth::VoiceMask all = state.voices.allocatedMask;
+  mini_synth::controlChange(state, 0U, mini_synth::kMidiCcAllNotesOff, 0U);
+  const bool released = state.voices.allocatedMask == all && state.voices.releasingMask == all && state.events.peek() == nullptr;
+  // CC120 also cuts voices that are already releasing.
+  mini_synth::controlChange(state, 0U, mini_synth::kMidiCcAllSoundOff, 0U);
+  uint32_t stops = 0U;
+  while (const VoiceEvent *event = state.events.peek()) {
+    stops += (event->type == VoiceEventType::kNoteOff) ? 1U : 0U;
+    state.events.pop();
+  }
+  playAll();
+  mini_synth::controlChange(state, 0U, mini_synth::kMidiCcAllSoundOff, 0U);
+  while (const VoiceEvent *event = state.events.peek()) {
+    stops += (event->type == VoiceEventType::kNoteOff) ? 1U : 0U;
+    state.events.pop();
+  }
+  const bool stopped = state.voices.allocatedMask == 0U && state.voices.releasingMask == 0U &&
+                       mini_synth::findVoiceByNote(state, 48U) == mini_synth::kNoVoice && stops == 2U * voices &&
+                       state.voices.control[0].envelope == 0;
+  mini_synth::resetSynth();
+  if (!released || !stopped) {
+    std::fprintf(stderr, "channel mode: all notes off %s, all sound off %s (%u stops)\n", released ? "ok" : "wrong",
+                 stopped ? "ok" : "wrong", stops);
+    return false;
+  }
+  std::printf("channel mode %10u voices released by CC123, stopped by CC120: ok\n", voices);
+  return true;
+}
+
+void printThroughput(const char *name, size_t bytes, double seconds) {
+  const double rate = static_cast<double>(bytes) / seconds;
+  std::printf("%-12s %10.1f MB/s %8.2f ns/byte %12.0fx MIDI wire rate\n", name, rate / 1.0e6, 1.0e9 / rate, rate / kWireBytesPerSecond);
+}
+
+void benchParser(const std::vector<uint8_t> &bytes) {
+  MidiParser parser;
+  MidiEvent event;
+  uint32_t events = 0U;
+  const auto start = std::chrono::steady_clock::now();
+  for (const uint8_t data : bytes) {
+    events += mini_synth::parseMidiByte(parser, data, event) ? 1U : 0U;
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printThroughput("parse", bytes.size(), seconds);
+  if (events == 0U) {
+    std::printf("(no events)\n");
+  }
+}
+
+void benchDispatch(const std::vector<uint8_t> &bytes) {
+  mini_synth::resetSynth();
+  mini_synth::midiInReset();
+  mini_synth::SynthState &state = mini_synth::synthState();
+  MidiEvent event;
+  mini_synth::MidiRxByte rx;
+  const size_t chunk = MIDI_RX_BUFFER_SIZE / 2U;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t offset = 0; offset < bytes.size(); offset += chunk) {
+    const size_t end = (offset + chunk < bytes.size()) ? offset + chunk : bytes.size();
+    for (size_t i = offset; i < end; ++i) {
+      mini_synth::midiInReceive(bytes[i], static_cast<uint32_t>(i));
+    }
+    while (mini_synth::midiInRead(rx)) {
+      if (mini_synth::parseMidiByte(state.midi, rx.data, event)) {
+        event.time = rx.time;
+        mini_synth::handleMidiEvent(state, event);
+      }
+    }
+    // Stand in for the audio side: consume the voice events.
+    while (state.events.peek() != nullptr) {
+      state.events.pop();
+    }
+    mini_synth::flushDeferredEvents(state);
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printThroughput("dispatch", bytes.size(), seconds);
+  mini_synth::resetSynth();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 3) {
+    std::fprintf(stderr, "usage: %s [megabytes] [seed]\n", argv[0]);
+    return 2;
+  }
+  const size_t megabytes = (argc > 1) ? static_cast<size_t>(std::atoi(argv[1])) : 8U;
+  const uint32_t seed = (argc > 2) ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1U;
+  if (megabytes == 0U) {
+    std::fprintf(stderr, "%s: megabytes must be positive\n", argv[0]);
+    return 2;
+  }
+  const size_t targetBytes = megabytes << 20U;
+
+  std::vector<uint8_t> bytes;
+  std::vector<Expected> expected;
+  bytes.reserve(targetBytes + 256U);
+  StreamGenerator(seed, bytes, expected).generate(targetBytes);
+
+  bool ok = testConformance(bytes, expected);
+  ok = testGarbage(targetBytes, seed) && ok;
+  ok = testRing() && ok;
+  ok = testQueueOverflow() && ok;
+  ok = testChannelMode() && ok;
+  benchParser(bytes);
+  benchDispatch(bytes);
+  if (!ok) {
+    std::printf("FAILED\n");
+    return 1;
+  }
+  return 0;
+}
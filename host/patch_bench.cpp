@@ -0,0 +1,553 @@
+// Patch storage test and benchmark for the patch codec (MiniSynthPatch.*) and
+// the wear-levelled flash store (MiniSynthPatchStore.*, host flash simulation).
+//
+// 1. codec: random patches survive encode/decode; bad versions and
+//    out-of-range fields are rejected.
+// 2. recall: a patch stored with CC119 and recalled with Program Change is
+//    applied by a single handleControl() tick; a moved pot takes over again.
+//    The recall tick is timed against an ordinary tick and the control period.
+// 3. deferred store: a CC119 that arrives while another slot's store waits for
+//    the erase is kept (with the sound at the time of the CC119) and written
+//    once the voices are silent and patchStoreService() has run; a third
+//    store to yet another slot meanwhile is counted in droppedStores. MIDI
+//    channel messages keep postponing the erase (MIDI clock does not); it
+//    runs only after PATCH_ERASE_IDLE_MS without them.
+// 4. store: random stores into every slot for several bank sizes, checked
+//    against a shadow copy (and again after a simulated reboot). Reports
+//    host load/store latency, write amplification (bytes programmed per
+//    payload byte), erases per 1000 stores, the store count the busiest bank
+//    reaches at 10k erase cycles, and the programming time these stores
+//    would take on the device. Every erase must come from patchStoreService();
+//    stores that fill the bank before it ran are queued until it does.
+// 5. power loss: power is cut after a random number of flash operations
+//    during stores, transfers and erases; after each reboot every slot must
+//    hold either its old or its new patch (a queued store may be lost).
+//
+//   build/patch_bench               # 20000 stores per bank size, seed 1
+//   build/patch_bench 100000 1234   # 100000 stores, seed 1234
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <Arduino.h>
+
+#include "MiniSynthApp.h"
+#include "MiniSynthMidi.h"
+#include "MiniSynthPatch.h"
+#include "MiniSynthPatchStore.h"
+#include "MiniSynthPots.h"
+
+namespace {
+
+using mini_synth::SynthPatch;
+
+// Datasheet typical programming times (STM32F411: 32-bit parallelism at 2.7..3.6 V;
+// STM32F103: two 16-bit programs per word).
+constexpr double kF411WordProgramUs = 16.0;
+constexpr double kF103WordProgramUs = 2.0 * 52.5;
+// Rated erase cycles per sector/page.
+constexpr double kRatedEraseCycles = 10000.0;
+
+using Payload = std::vector<uint8_t>;
+
+SynthPatch randomPatch(std::mt19937 &rng) {
+  SynthPatch patch;
+  patch.waveform = static_cast<mini_synth::OscWaveform>(rng() % mini_synth::kOscWaveformCount);
+  patch.attackPot = static_cast<uint16_t>(rng() % (mini_synth::kAdcMax + 1U));
+  patch.releasePot = static_cast<uint16_t>(rng() % (mini_synth::kAdcMax + 1U));
+  patch.cutoffPot = static_cast<uint16_t>(rng() % (mini_synth::kAdcMax + 1U));
+  patch.resonancePot = static_cast<uint16_t>(rng() % (mini_synth::kAdcMax + 1U));
+  patch.decayRate = static_cast<uint16_t>(512U + rng() % (8192U - 512U + 1U));
+  patch.sustainLevel = static_cast<int16_t>(rng() % 32768U);
+  patch.volume = static_cast<uint16_t>(rng() % 32769U);
+  patch.unisonSpread = static_cast<uint16_t>(rng() % 32768U);
+  return patch;
+}
+
+bool samePatch(const SynthPatch &a, const SynthPatch &b) {
+  return a.waveform == b.waveform && a.attackPot == b.attackPot && a.releasePot == b.releasePot && a.cutoffPot == b.cutoffPot &&
+         a.resonancePot == b.resonancePot && a.decayRate == b.decayRate && a.sustainLevel == b.sustainLevel && a.volume == b.volume &&
+         a.unisonSpread == b.unisonSpread;
+}
+
+Payload randomPayload(std::mt19937 &rng) {
+  Payload payload(kPatchRecordBytes);
+  for (uint8_t &b : payload) {
+    b = static_cast<uint8_t>(rng());
+  }
+  return payload;
+}
+
+bool testCodec(uint32_t seed) {
+  std::mt19937 rng(seed);
+  const size_t kPatches = 100000U;
+  uint8_t data[kPatchRecordBytes];
+  for (size_t i = 0; i < kPatches; ++i) {
+    const SynthPatch patch = randomPatch(rng);
+    mini_synth::encodePatch(patch, data);
+    SynthPatch decoded;
+    if (!mini_synth::decodePatch(data, decoded) || !samePatch(patch, decoded)) {
+      std::fprintf(stderr, "codec: patch %zu did not round-trip\n", i);
+      return false;
+    }
+  }
+  // Corrupt fields must be rejected and leave the output untouched.
+  struct Corruption {
+    size_t offset;
+    uint8_t value;
+  };
+  static const Corruption kCorruptions[] = {
+      {0U, mini_synth::kPatchFormatVersion + 1U}, // version
+      {1U, mini_synth::kOscWaveformCount},         // waveform
+      {3U, 0x04U},                                 // attack pot > kAdcMax
+      {11U, 0x00U},                                // decay rate < 512
+      {13U, 0x80U},                                // negative sustain
+      {15U, 0x90U},                                // volume > 0 dB
+      {17U, 0x80U},                                // unison spread > Q15
+  };
+  SynthPatch patch = randomPatch(rng);
+  patch.decayRate = 1024U;
+  mini_synth::encodePatch(patch, data);
+  for (const Corruption &corruption : kCorruptions) {
+    uint8_t bad[kPatchRecordBytes];
+    std::memcpy(bad, data, sizeof(bad));
+    bad[corruption.offset] = corruption.value;
+    SynthPatch decoded;
+    decoded.attackPot = 77U;
+    if (mini_synth::decodePatch(bad, decoded) || decoded.attackPot != 77U) {
+      std::fprintf(stderr, "codec: corrupt byte %zu accepted\n", corruption.offset);
+      return false;
+    }
+  }
+  std::printf("codec        %10zu patches round-trip, %zu corruptions rejected: ok\n", kPatches,
+              sizeof(kCorruptions) / sizeof(kCorruptions[0]));
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Recall through the control loop
+// ---------------------------------------------------------------------------
+
+void sendMidi(mini_synth::MidiMessage type, uint8_t data1, uint8_t data2) {
+  mini_synth::MidiEvent event;
+  event.type = type;
+  event.data1 = data1;
+  event.data2 = data2;
+  mini_synth::handleMidiEvent(mini_synth::synthState(), event);
+}
+
+void setPots(int wave, int attack, int release, int cutoff, int resonance) {
+  hostSetAnalog(mini_synth::kOscSelectPin, wave);
+  hostSetAnalog(mini_synth::kAttackPin, attack);
+  hostSetAnalog(mini_synth::kReleasePin, release);
+  hostSetAnalog(mini_synth::kFilterPin, cutoff);
+  hostSetAnalog(mini_synth::kResonancePin, resonance);
+}
+
+// One control tick followed by the audio it covers (as midi2wav does).
+double tick() {
+  static int16_t block[mini_synth::kControlPeriod];
+  const auto start = std::chrono::steady_clock::now();
+  mini_synth::handleControl();
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  mini_synth::renderBlock(block, mini_synth::kControlPeriod);
+  return seconds;
+}
+
+void settle() {
+  for (int i = 0; i < 32; ++i) {
+    tick();
+  }
+}
+
+uint32_t attackRateFor(uint16_t pot) {
+  return static_cast<uint32_t>(map(pot, 0, mini_synth::kAdcMax, 512, 8192));
+}
+
+uint32_t releaseRateFor(uint16_t pot) {
+  return static_cast<uint32_t>(map(pot, 0, mini_synth::kAdcMax, 256, 4096));
+}
+
+// Control-side state after recalling `patch` (pots held at the patch values).
+bool matchesPatch(const SynthPatch &patch) {
+  const mini_synth::SynthState &state = mini_synth::synthState();
+  return state.waveform == patch.waveform && state.envelope.attackRate == attackRateFor(patch.attackPot) &&
+         state.envelope.releaseRate == releaseRateFor(patch.releasePot) && state.envelope.decayRate == patch.decayRate &&
+         state.envelope.sustainLevel == patch.sustainLevel && state.volume == patch.volume && state.unisonSpread == patch.unisonSpread;
+}
+
+bool testRecall() {
+  patchFlashSimFormat(PATCH_FLASH_SIM_BANK_SIZE);
+  mini_synth::initializeSynth();
+  mini_synth::synthState().voiceMask = mini_synth::kAllVoicesMask;
+
+  // Program 5: sawtooth-ish, slow attack, quiet, detuned.
+  setPots(600, 100, 900, 300, 700);
+  settle();
+  sendMidi(mini_synth::MidiMessage::kProgramChange, 5U, 0U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcVolume, 90U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcUnisonSpread, 40U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcDecayTime, 20U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcSustainLevel, 64U);
+  tick();
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcPatchStore, 127U);
+  tick();
+  SynthPatch stored;
+  if (!mini_synth::loadPatch(5U, stored) || stored.attackPot != mini_synth::readPot(mini_synth::PotId::kAttack) ||
+      stored.volume != mini_synth::synthState().volume || stored.decayRate != mini_synth::synthState().envelope.decayRate) {
+    std::fprintf(stderr, "recall: CC119 did not store program 5\n");
+    return false;
+  }
+  // Program 6: another sound.
+  setPots(0, 1000, 50, 1000, 0);
+  settle();
+  sendMidi(mini_synth::MidiMessage::kProgramChange, 6U, 0U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcVolume, 127U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcUnisonSpread, 0U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcDecayTime, 120U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcSustainLevel, 127U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcPatchStore, 127U);
+  tick();
+  SynthPatch other;
+  if (!mini_synth::loadPatch(6U, other)) {
+    std::fprintf(stderr, "recall: CC119 did not store program 6\n");
+    return false;
+  }
+
+  // An empty program keeps the current sound.
+  const uint32_t attackBefore = mini_synth::synthState().envelope.attackRate;
+  sendMidi(mini_synth::MidiMessage::kProgramChange, 9U, 0U);
+  tick();
+  if (mini_synth::synthState().envelope.attackRate != attackBefore || mini_synth::synthState().volume != other.volume) {
+    std::fprintf(stderr, "recall: an empty program changed the sound\n");
+    return false;
+  }
+
+  // Recall program 5 with the pots still at program 6's positions: one tick applies all of it.
+  sendMidi(mini_synth::MidiMessage::kProgramChange, 5U, 0U);
+  tick();
+  if (!matchesPatch(stored)) {
+    std::fprintf(stderr, "recall: program 5 not applied within one control tick\n");
+    return false;
+  }
+  // Nudging a pot within the pickup distance keeps the patch value; moving it takes over.
+  hostSetAnalog(mini_synth::kAttackPin, 1010);
+  settle();
+  if (!matchesPatch(stored)) {
+    std::fprintf(stderr, "recall: pot jitter overrode the recalled value\n");
+    return false;
+  }
+  hostSetAnalog(mini_synth::kAttackPin, 500);
+  settle();
+  const uint32_t expected = attackRateFor(mini_synth::readPot(mini_synth::PotId::kAttack));
+  if (mini_synth::synthState().envelope.attackRate != expected ||
+      mini_synth::synthState().envelope.releaseRate != releaseRateFor(stored.releasePot)) {
+    std::fprintf(stderr, "recall: moved pot did not take over (or an unmoved one did)\n");
+    return false;
+  }
+
+  // Time recall ticks (alternating programs) against ordinary ticks.
+  const int kTicks = 2000;
+  double recallWorst = 0.0;
+  double recallTotal = 0.0;
+  double plainTotal = 0.0;
+  for (int i = 0; i < kTicks; ++i) {
+    sendMidi(mini_synth::MidiMessage::kProgramChange, (i & 1) ? 5U : 6U, 0U);
+    const double seconds = tick();
+    recallTotal += seconds;
+    recallWorst = (seconds > recallWorst) ? seconds : recallWorst;
+    plainTotal += tick();
+  }
+  const double periodUs = 1.0e6 * mini_synth::kControlPeriod / mini_synth::kAudioRate;
+  std::printf("recall       applied in 1 tick, pot pickup ok: tick %.2f us (plain %.2f us, worst %.2f us) of %.0f us period\n",
+              1.0e6 * recallTotal / kTicks, 1.0e6 * plainTotal / kTicks, 1.0e6 * recallWorst, periodUs);
+  mini_synth::resetSynth();
+  return true;
+}
+
+bool testDeferredStore() {
+  patchFlashSimFormat(PATCH_FLASH_SIM_BANK_SIZE);
+  mini_synth::initializeSynth();
+  mini_synth::SynthState &state = mini_synth::synthState();
+  state.voiceMask = mini_synth::kAllVoicesMask;
+  setPots(600, 100, 1000, 300, 700);
+  settle();
+  // A held note keeps the erase from running while the bank fills.
+  sendMidi(mini_synth::MidiMessage::kNoteOn, 60U, 100U);
+  tick();
+  std::mt19937 rng(7U);
+  uint32_t stores = 0U;
+  while (!patchStoreWritePending() && stores < 10000U) {
+    const Payload payload = randomPayload(rng);
+    patchStoreWrite(static_cast<uint8_t>(1U + stores % (kPatchSlots - 3U)), payload.data());
+    ++stores;
+  }
+  if (!patchStoreWritePending()) {
+    std::fprintf(stderr, "deferred store: no store queued after %u stores\n", stores);
+    return false;
+  }
+  const uint8_t program = kPatchSlots - 2U;
+  const uint8_t dropped = kPatchSlots - 1U;
+  sendMidi(mini_synth::MidiMessage::kProgramChange, program, 0U);
+  tick();
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcPatchStore, 127U);
+  tick();
+  SynthPatch early;
+  const bool storedEarly = mini_synth::loadPatch(program, early);
+  // Moving a pot after the CC119 must not change what is stored.
+  const uint16_t attack = mini_synth::readPot(mini_synth::PotId::kAttack);
+  hostSetAnalog(mini_synth::kAttackPin, 900);
+  settle();
+  sendMidi(mini_synth::MidiMessage::kProgramChange, dropped, 0U);
+  sendMidi(mini_synth::MidiMessage::kControlChange, mini_synth::kMidiCcPatchStore, 127U);
+  tick();
+  // Release the note; a controller every half second (with MIDI clock in
+  // between, both through the UART like on the device) must hold the erase
+  // off well past the end of the release.
+  sendMidi(mini_synth::MidiMessage::kNoteOff, 60U, 0U);
+  SynthPatch stored;
+  const int busyTicks = 3 * static_cast<int>(mini_synth::kControlRate);
+  bool storedWhileBusy = false;
+  for (int i = 0; i < busyTicks; ++i) {
+    if (i % (mini_synth::kControlRate / 2U) == 0U) {
+      Serial1.feed(static_cast<uint8_t>(mini_synth::MidiMessage::kControlChange));
+      Serial1.feed(mini_synth::kMidiCcSustainLevel);
+      Serial1.feed(100U);
+    }
+    Serial1.feed(static_cast<uint8_t>(mini_synth::MidiMessage::kClock));
+    tick();
+    storedWhileBusy = storedWhileBusy || mini_synth::loadPatch(program, stored);
+  }
+  // Then wait for the idle window and the erase.
+  int ticks = 0;
+  for (; ticks < 10 * static_cast<int>(mini_synth::kControlRate) && !mini_synth::loadPatch(program, stored); ++ticks) {
+    tick();
+  }
+  const int lastActivity = static_cast<int>(mini_synth::kControlRate / 2U) - busyTicks % static_cast<int>(mini_synth::kControlRate / 2U);
+  const int idleTicks = static_cast<int>((PATCH_ERASE_IDLE_MS * mini_synth::kControlRate + 999U) / 1000U);
+  PatchStoreStats stats;
+  patchStoreGetStats(&stats);
+  const bool ok = !storedEarly && !storedWhileBusy && ticks + lastActivity >= idleTicks && mini_synth::loadPatch(program, stored) &&
+                  stored.attackPot == attack && state.droppedStores == 1U && !mini_synth::loadPatch(dropped, stored) &&
+                  stats.erases == 1U;
+  mini_synth::resetSynth();
+  hostSetAnalog(mini_synth::kAttackPin, 0);
+  if (!ok) {
+    std::fprintf(stderr, "deferred store: stored early %d, while busy %d, after %d idle ticks (need %d) attack %u (expected %u), %u dropped, %u erases\n",
+                 storedEarly ? 1 : 0, storedWhileBusy ? 1 : 0, ticks + lastActivity, idleTicks, stored.attackPot, attack,
+                 state.droppedStores, stats.erases);
+    return false;
+  }
+  std::printf("deferred     CC119 behind a queued store written %d ticks after the last MIDI message, 1 dropped: ok\n", ticks + lastActivity);
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Flash store
+// ---------------------------------------------------------------------------
+
+bool verifyAll(const std::vector<Payload> &shadow, const std::vector<bool> &written, const char *when) {
+  uint8_t out[kPatchRecordBytes];
+  for (uint8_t slot = 0; slot < kPatchSlots; ++slot) {
+    const bool found = patchStoreRead(slot, out);
+    if (found != written[slot] || (found && std::memcmp(out, shadow[slot].data(), kPatchRecordBytes) != 0)) {
+      std::fprintf(stderr, "store: slot %u wrong %s\n", slot, when);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool benchStore(uint32_t bankBytes, size_t stores, uint32_t seed) {
+  if (!patchFlashSimFormat(bankBytes) || !patchStoreInit()) {
+    std::printf("store %6u  bank too small for %u slots, skipped\n", bankBytes, kPatchSlots);
+    return true;
+  }
+  std::mt19937 rng(seed ^ bankBytes);
+  std::vector<Payload> shadow(kPatchSlots, Payload(kPatchRecordBytes));
+  std::vector<bool> written(kPatchSlots, false);
+  double storeSeconds = 0.0;
+  uint32_t serviceErases = 0U;
+  uint32_t refused = 0U;
+  for (size_t i = 0; i < stores; ++i) {
+    const uint8_t slot = static_cast<uint8_t>(rng() % kPatchSlots);
+    // Some stores repeat the stored patch (saving without editing).
+    const Payload payload = (written[slot] && rng() % 10U == 0U) ? shadow[slot] : randomPayload(rng);
+    const auto start = std::chrono::steady_clock::now();
+    bool ok = patchStoreWrite(slot, payload.data());
+    storeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    PatchStoreStats stats;
+    patchStoreGetStats(&stats);
+    if (!ok && stats.pendingWrites != 0U) {
+      // Another slot's store is waiting for the erase: save again after a silent moment.
+      ++refused;
+      serviceErases += patchStoreService() ? 1U : 0U;
+      ok = patchStoreWrite(slot, payload.data());
+    }
+    if (!ok) {
+      std::fprintf(stderr, "store %u: write %zu failed\n", bankBytes, i);
+      return false;
+    }
+    shadow[slot] = payload;
+    written[slot] = true;
+    // Silent moments between edits let the spare bank be erased ahead of time.
+    if (rng() % 16U == 0U && patchStoreService()) {
+      ++serviceErases;
+    }
+    if (i % 256U == 0U && !verifyAll(shadow, written, "during stores")) {
+      return false;
+    }
+  }
+  // Loads.
+  const size_t kLoads = 1000000U;
+  uint8_t out[kPatchRecordBytes];
+  uint32_t sum = 0U;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kLoads; ++i) {
+    if (patchStoreRead(static_cast<uint8_t>(i % kPatchSlots), out)) {
+      sum += out[0];
+    }
+  }
+  const double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  PatchStoreStats stats;
+  patchStoreGetStats(&stats);
+  if (stats.erases != serviceErases) {
+    std::fprintf(stderr, "store %u: %u of %u erases outside patchStoreService()\n", bankBytes, stats.erases - serviceErases,
+                 stats.erases);
+    return false;
+  }
+  if (!verifyAll(shadow, written, "after stores")) {
+    return false;
+  }
+  // A queued store only reaches the flash through the service (silence before power-off).
+  patchStoreService();
+  if (!patchStoreInit() || !verifyAll(shadow, written, "after reboot")) {
+    return false;
+  }
+  const uint32_t busiest = (patchFlashSimEraseCount(0U) > patchFlashSimEraseCount(1U)) ? patchFlashSimEraseCount(0U) : patchFlashSimEraseCount(1U);
+  const double amplification = static_cast<double>(stats.programmedBytes) / static_cast<double>(stats.payloadBytes);
+  const double wordsPerStore = static_cast<double>(stats.programmedBytes) / 4.0 / static_cast<double>(stores);
+  std::printf("store %6u  %8zu stores (%u unchanged): %6.0f ns/store %5.0f ns/load, amplification %.2fx, %.2f erases/1k stores "
+              "(%u stores queued for them, %u refused), %u compactions\n",
+              bankBytes, stores, stats.unchangedWrites, 1.0e9 * storeSeconds / stores, 1.0e9 * loadSeconds / kLoads,
+              amplification, 1000.0 * stats.erases / stores, stats.queuedWrites, refused, stats.compactions);
+  std::printf("             device: %.1f words/store = %.0f us F411, %.0f us F103; busiest bank %u erases", wordsPerStore,
+              wordsPerStore * kF411WordProgramUs, wordsPerStore * kF103WordProgramUs, busiest);
+  if (busiest != 0U) {
+    std::printf(", %.3g stores to %.0fk cycles", kRatedEraseCycles * static_cast<double>(stores) / busiest, kRatedEraseCycles / 1000.0);
+  }
+  std::printf("\n");
+  if (sum == 0U) {
+    std::printf("(no loads)\n");
+  }
+  return true;
+}
+
+bool testPowerLoss(size_t trials, uint32_t seed) {
+  // A bank that transfers often so cuts land in transfers and erases too.
+  const uint32_t bankBytes = 4096U;
+  if (!patchFlashSimFormat(bankBytes) || !patchStoreInit()) {
+    std::printf("power loss   bank too small for %u slots, skipped\n", kPatchSlots);
+    return true;
+  }
+  std::mt19937 rng(seed ^ 0xC0FFEEU);
+  std::vector<Payload> shadow(kPatchSlots, Payload(kPatchRecordBytes));
+  std::vector<bool> written(kPatchSlots, false);
+  uint32_t interrupted = 0U;
+  uint32_t corrupt = 0U;
+  uint8_t out[kPatchRecordBytes];
+  for (size_t i = 0; i < trials; ++i) {
+    // Up to about one transfer's worth of flash operations before the cut.
+    patchFlashSimCutPower(static_cast<uint32_t>(rng() % (kPatchSlots * 7U + 8U)));
+    // Keep saving sounds (with silent moments in between) until the power goes.
+    uint8_t slot = 0U;
+    Payload payload;
+    // A store queued for the erase is only in RAM until the service runs, so it may be lost too.
+    bool queued = false;
+    uint8_t queuedSlot = 0U;
+    Payload queuedPayload;
+    bool ok = true;
+    for (int n = 0; ok && n < 8; ++n) {
+      slot = static_cast<uint8_t>(rng() % kPatchSlots);
+      payload = randomPayload(rng);
+      ok = patchStoreWrite(slot, payload.data());
+      PatchStoreStats stats;
+      patchStoreGetStats(&stats);
+      if (!ok && stats.pendingWrites != 0U) {
+        patchStoreService();
+        ok = patchStoreWrite(slot, payload.data());
+        patchStoreGetStats(&stats);
+      }
+      if (ok && stats.pendingWrites != 0U) {
+        queued = true;
+        queuedSlot = slot;
+        queuedPayload = payload;
+      } else if (ok) {
+        shadow[slot] = payload;
+        written[slot] = true;
+      }
+      if (ok && rng() % 4U == 0U) {
+        patchStoreService();
+      }
+    }
+    patchFlashSimCutPower(kPatchFlashSimPowerOn);
+    interrupted += ok ? 0U : 1U;
+    if (!patchStoreInit()) {
+      std::fprintf(stderr, "power loss: trial %zu: store did not come back\n", i);
+      return false;
+    }
+    PatchStoreStats stats;
+    patchStoreGetStats(&stats);
+    corrupt += stats.corruptRecords;
+    // The interrupted (or queued) store may have landed or not; everything else must be intact.
+    if (queued && patchStoreRead(queuedSlot, out) && std::memcmp(out, queuedPayload.data(), kPatchRecordBytes) == 0) {
+      shadow[queuedSlot] = queuedPayload;
+      written[queuedSlot] = true;
+    }
+    const bool found = patchStoreRead(slot, out);
+    if (found && std::memcmp(out, payload.data(), kPatchRecordBytes) == 0) {
+      shadow[slot] = payload;
+      written[slot] = true;
+    }
+    if (!verifyAll(shadow, written, "after power loss")) {
+      std::fprintf(stderr, "power loss: trial %zu\n", i);
+      return false;
+    }
+  }
+  std::printf("power loss   %10zu cuts (%u mid-write), %u torn records skipped at boot, every slot old or new: ok\n", trials, interrupted, corrupt);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 3) {
+    std::fprintf(stderr, "usage: %s [stores] [seed]\n", argv[0]);
+    return 2;
+  }
+  const size_t stores = (argc > 1) ? static_cast<size_t>(std::atol(argv[1])) : 20000U;
+  const uint32_t seed = (argc > 2) ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1U;
+  if (stores == 0U) {
+    std::fprintf(stderr, "%s: stores must be positive\n", argv[0]);
+    return 2;
+  }
+
+  bool ok = testCodec(seed);
+  ok = testRecall() && ok;
+  ok = testDeferredStore() && ok;
+  static const uint32_t kBankSizes[] = {2048U, 4096U, 16384U, 131072U};
+  for (const uint32_t bankBytes : kBankSizes) {
+    ok = benchStore(bankBytes, stores, seed) && ok;
+  }
+  ok = testPowerLoss(2000U, seed) && ok;
+  if (!ok) {
+    std::printf("FAILED\n");
+    return 1;
+  }
+  return 0;
+}
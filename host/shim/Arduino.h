@@ -0,0 +1,90 @@
+#pragma once
+
+// Host (Linux/macOS) stand-in for the Arduino core: only what the synth uses.
+// Pots, keys and MIDI input are driven from the host program through the
+// host* helpers declared at the bottom of this file.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+enum : uint8_t { A0 = 14, A1, A2, A3, A4, A5, A6, A7 };
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define LOW 0x0
+#define HIGH 0x1
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+int analogRead(uint8_t pin);
+uint32_t millis();
+uint32_t micros();
+
+inline void delayMicroseconds(unsigned int us) {
+  (void)us;
+}
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/**
+ * @brief Serial port with a host-fed receive FIFO; printing is discarded.
+ */
+class HardwareSerial {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  int available() const { return static_cast<int>(rxHead_ - rxTail_); }
+  int read() { return (rxHead_ == rxTail_) ? -1 : rx_[rxTail_++ & (kRxSize - 1U)]; }
+  /**
+   * @brief Queue one received byte (host side). Returns false if the FIFO is full.
+   */
+  bool feed(uint8_t data) {
+    if (rxHead_ - rxTail_ >= kRxSize) {
+      return false;
+    }
+    rx_[rxHead_++ & (kRxSize - 1U)] = data;
+    return true;
+  }
+  template <class T> void print(const T &) {}
+  template <class T> void print(const T &, int) {}
+  template <class T> void println(const T &) {}
+  template <class T> void println(const T &, int) {}
+  void println() {}
+  explicit operator bool() const { return true; }
+
+ private:
+  static constexpr uint32_t kRxSize = 8192U;
+  uint8_t rx_[kRxSize] = {0U};
+  uint32_t rxHead_ = 0U;
+  uint32_t rxTail_ = 0U;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+// ---- host-side controls ----
+
+/**
+ * @brief Set the raw ADC value (0..1023) returned by analogRead(pin).
+ */
+void hostSetAnalog(uint8_t pin, int value);
+
+/**
+ * @brief Set the level returned by digitalRead(pin) (inputs idle HIGH, as with pull-ups).
+ */
+void hostSetDigital(uint8_t pin, int level);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Mono 16-bit stand-in for Mozzi's AudioOutput.
+ */
+struct AudioOutput {
+  AudioOutput(int32_t value = 0) : output(static_cast<int16_t>(value)) {}
+  int16_t output;
+};
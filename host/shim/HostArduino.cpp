@@ -0,0 +1,62 @@
+#include "Arduino.h"
+#include "tables/sin2048_int8.h"
+
+#include <chrono>
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+
+namespace {
+int g_analog[256];
+int g_digital[256];
+const auto g_startTime = std::chrono::steady_clock::now();
+
+struct HostInit {
+  HostInit() {
+    for (int &level : g_digital) {
+      level = HIGH;
+    }
+    for (int i = 0; i <= SIN2048_NUM_CELLS; ++i) {
+      const double angle = 2.0 * M_PI * static_cast<double>(i % SIN2048_NUM_CELLS) / SIN2048_NUM_CELLS;
+      SIN2048_DATA[i] = static_cast<int8_t>(lround(127.0 * sin(angle)));
+    }
+  }
+};
+}  // namespace
+
+int8_t SIN2048_DATA[SIN2048_NUM_CELLS + 1];
+static HostInit g_hostInit;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+int digitalRead(uint8_t pin) {
+  return g_digital[pin];
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  g_digital[pin] = level;
+}
+
+int analogRead(uint8_t pin) {
+  return g_analog[pin];
+}
+
+uint32_t micros() {
+  const auto elapsed = std::chrono::steady_clock::now() - g_startTime;
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+uint32_t millis() {
+  return micros() / 1000U;
+}
+
+void hostSetAnalog(uint8_t pin, int value) {
+  g_analog[pin] = value;
+}
+
+void hostSetDigital(uint8_t pin, int level) {
+  g_digital[pin] = level;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+// Mozzi configuration constants are not needed on the host.
@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in for Mozzi: there is no audio interrupt, the host program calls
+// handleControl() and renderBlock() itself.
+
+#include "Arduino.h"
+#include "AudioOutput.h"
+
+inline void startMozzi(int controlRate) { (void)controlRate; }
+inline void audioHook() {}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Some sources include the core header in lower case.
+#include "Arduino.h"
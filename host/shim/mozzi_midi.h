@@ -0,0 +1,11 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+/**
+ * @brief MIDI note to frequency in Hz (A4 = 69 = 440 Hz).
+ */
+inline float mtof(float note) {
+  return 440.0f * powf(2.0f, (note - 69.0f) / 12.0f);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Flash and RAM share one address space on the host.
+inline uint16_t hostReadWord(const void *address) {
+  uint16_t value;
+  memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+#define pgm_read_word_near(address) hostReadWord(address)
+#define pgm_read_byte_near(address) (*reinterpret_cast<const uint8_t *>(address))
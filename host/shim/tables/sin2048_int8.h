@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host version of Mozzi's 2048-cell int8 sine table. The data is generated at
+// start-up (round(127 * sin)); one guard cell keeps 16-bit reads in bounds.
+#define SIN2048_NUM_CELLS 2048
+
+extern int8_t SIN2048_DATA[SIN2048_NUM_CELLS + 1];
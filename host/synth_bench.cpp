@@ -0,0 +1,51 @@
+// Host runner for the firmware micro-benchmarks (MiniSynthBench.*).
+//
+// Runs the same benchRunAll() that -DSYNTH_BENCHMARK=1 runs on the device and
+// prints one line per measurement. On x86 the counter is the TSC, so the
+// numbers are reference cycles rather than F411 core cycles; use them to
+// compare revisions and build switches, and the on-target run for the budget.
+//
+//   build/synth_bench              # all benchmarks
+//   build/synth_bench render/      # only names starting with the prefix
+//
+// Entries with the unit "mismatches" are bit-exactness checks (e.g. the packed
+// SIMD unison kernel against its scalar reference); the exit status is 1 if
+// any of them is non-zero.
+
+#include <cstdio>
+#include <cstring>
+
+#include "MiniSynthBench.h"
+
+namespace {
+
+const char *g_prefix = "";
+int g_failures = 0;
+
+void printResult(const char *name, float value, const char *unit) {
+  // Verification entries report a mismatch count; anything but zero fails the run.
+  if (std::strcmp(unit, "mismatches") == 0 && value != 0.0f) {
+    std::fprintf(stderr, "FAILED: %s = %.0f\n", name, static_cast<double>(value));
+    ++g_failures;
+  }
+  if (std::strncmp(name, g_prefix, std::strlen(g_prefix)) != 0) {
+    return;
+  }
+  std::printf("%-32s %10.2f %s\n", name, static_cast<double>(value), unit);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 2) {
+    std::fprintf(stderr, "usage: %s [name-prefix]\n", argv[0]);
+    return 2;
+  }
+  if (argc == 2) {
+    g_prefix = argv[1];
+  }
+  std::printf("%-32s %10s %s\n", "Benchmark", "Value", "Unit");
+  std::printf("------------------------------------------------------------\n");
+  mini_synth::benchRunAll(printResult);
+  return (g_failures == 0) ? 0 : 1;
+}
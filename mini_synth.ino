@@ -3,18 +3,102 @@
 
 #include "MiniSynthApp.h"
 #include "MiniSynthI2S.h"
+#include "MiniSynthMidiIn.h"
 #include "MiniSynthCpuLoad.h"
+#include "MiniSynthProfiler.h"
 #include "MiniSynthScope.h"
 #include "MiniSynthDisplay.h"
+#include "MiniSynthBench.h"
+
+// サンプルレートは AUDIO_RATE だけで設定する（Mozzi 側の値はそこから求める）。
+static_assert(MOZZI_AUDIO_RATE == mini_synth::kAudioRate, "set the sample rate with AUDIO_RATE, not MOZZI_AUDIO_RATE");
+static_assert(MOZZI_CONTROL_RATE == mini_synth::kControlRate, "MOZZI_CONTROL_RATE must match kControlRate");
+
+#if defined(SYNTH_BENCHMARK) || defined(CPU_LOAD_DEBUG)
+/**
+ * @brief 起動時の自己診断（レンダリング余裕度）の結果をシリアルに出力する。
+ */
+static void printRenderHeadroom() {
+  const mini_synth::RenderHeadroom &headroom = mini_synth::renderHeadroom();
+  Serial.print("[HEADROOM] rate=");
+  Serial.print(mini_synth::kAudioRate);
+  Serial.print(" budget=");
+  Serial.print(headroom.budgetCycles);
+  Serial.print(" idle=");
+  Serial.print(headroom.idleCycles);
+  Serial.print(" full=");
+  Serial.print(headroom.fullCycles);
+  Serial.print(" voices=");
+  Serial.println(headroom.voiceLimit);
+  if (!headroom.meetsDeadline) {
+    Serial.println("[HEADROOM] warning: all voices exceed the render budget, polyphony limited");
+  }
+}
+#endif
+
+#if defined(SYNTH_BENCHMARK)
+/**
+ * @brief ベンチマーク結果をシリアルに出力する。
+ */
+static void printBenchResult(const char *name, float value, const char *unit) {
+  Serial.print("[BENCH] ");
+  Serial.print(name);
+  Serial.print(" ");
+  Serial.print(unit);
+  Serial.print("=");
+  Serial.println(value, 1);
+}
+#endif
+
+#ifdef USE_I2S
+/**
+ * @brief I2S DMA 割り込みから呼ばれ、ハーフバッファ分を直接レンダリングする。
+ */
+static void renderI2sBlock(int16_t *out, size_t frames) {
+  cpuLoadEnter();
+  mini_synth::renderBlock(out, frames);
+#if ENABLE_SCOPE
+  const uint32_t scopeStart = profileBegin();
+  for (size_t i = 0; i < frames; ++i) {
+    scopePushSample(out[i]);
+  }
+  profileEnd(ProfileZone::kScopePush, scopeStart);
+#endif
+  cpuLoadExit(frames);
+}
+
+/**
+ * @brief Mozzi（外部出力モード）の出力可否。I2S が消費したフレーム数だけ進める。
+ */
+bool canBufferAudioOutput() {
+  return i2sTakeFrameCredit();
+}
+
+/**
+ * @brief Mozzi（外部出力モード）の出力フック。音声は DMA 側で生成済みのため捨てる。
+ */
+void audioOutput(const AudioOutput f) {
+  (void)f;
+}
+#endif
 
 /**
  * @brief Arduino 初期化ルーチン。
  */
 void setup() {
+#if defined(SYNTH_BENCHMARK)
+  // Mozzi の割り込みが動き出す前に計測する
+  Serial.begin(115200);
+  mini_synth::benchRunAll(printBenchResult);
+#endif
   mini_synth::initializeSynth();
+#if defined(SYNTH_BENCHMARK) || defined(CPU_LOAD_DEBUG)
+  Serial.begin(115200);
+  printRenderHeadroom();
+#endif
 #ifdef USE_I2S
-  // Initialize I2S output at Mozzi audio rate
-  initI2SOutput(MOZZI_AUDIO_RATE);
+  // I2S の DMA 割り込みでブロック単位に直接レンダリングする
+  initI2SOutput(mini_synth::kAudioRate, renderI2sBlock);
   i2sStart();
 #endif
 }
@@ -31,20 +115,18 @@ void updateControl() {
  * @return モノラルオーディオ出力。
  */
 AudioOutput updateAudio() {
+#ifdef USE_I2S
+  // 音声は I2S DMA 割り込みが生成する。ここはコントロール周期の歩調合わせのみ。
+  return {0};
+#else
   cpuLoadEnter();
   auto out = mini_synth::generateAudio();
+#if ENABLE_SCOPE
   // push sample to scope buffer for visualization
+  const uint32_t scopeStart = profileBegin();
   scopePushSample(out.output);
-#ifdef USE_I2S
-  // push sample to I2S (if enabled). If push fails, fallback to Mozzi output
-  if (!i2sPushSample(out.output)) {
-    cpuLoadExit();
-    return out;
-  }
-  // Still return Mozzi's expected output for compatibility (unused when I2S driving external DAC)
-  cpuLoadExit();
-  return out;
-#else
+  profileEnd(ProfileZone::kScopePush, scopeStart);
+#endif
   cpuLoadExit();
   return out;
 #endif
@@ -54,6 +136,10 @@ AudioOutput updateAudio() {
  * @brief Arduino メインループ。
  */
 void loop() {
+  // ポーリング版の MIDI 入力は loop() の周期で受信時刻を記録する（割り込み版では何もしない）。
+  mini_synth::midiInPoll();
+  // ポーリング転送の表示はダーティなタイルを 1 区間ずつ送る（DMA 版では何もしない）。
+  displayService();
   audioHook();
 }
 